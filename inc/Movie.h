@@ -3,12 +3,43 @@
 #include <string>
 //#include <vector>
 
+class TiXmlElement;
+template <class T> class XmlBinding;
+
 class Movie
 {
 public:
    Movie();
    ~Movie();
+
+   // Sets the fields from a <movie> element of a TMDb response. Fields the
+   // element doesn't have keep their values.
+   void Load(const TiXmlElement* element);
+
+   double GetScore() const { return score; }
+   int GetPopularity() const { return popularity; }
+   bool IsTranslated() const { return translated; }
+   bool IsAdult() const { return adult; }
+   const std::string& GetLanguage() const { return language; }
+   const std::string& GetOriginalName() const { return originalName; }
+   const std::string& GetName() const { return name; }
+   const std::string& GetAlternativeName() const { return alternativeName; }
+   const std::string& GetType() const { return type; }
+   int GetId() const { return id; }
+   const std::string& GetImdbId() const { return imdb_id; }
+   const std::string& GetUrl() const { return url; }
+   int GetVotes() const { return votes; }
+   double GetRating() const { return rating; }
+   const std::string& GetCertification() const { return certification; }
+   const std::string& GetOverview() const { return overview; }
+   const std::string& GetReleased() const { return released; }
+   const std::string& GetLastModified() const { return lastModified; }
+   int GetVersion() const { return version; }
 private:
+   static bool Bind(XmlBinding<Movie>& binding);
+   static XmlBinding<Movie> binding;
+   static bool bound;
+
    double score;
    int popularity;
    bool translated;
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "sckt.h"
+#include "tinyxml.h"
+
+/*
+* A TiXmlSink that sends to a connected sckt socket, so a TiXmlWriter can
+* stream XML onto the network as it is written. Send() is virtual in
+* sckt::TCPSocket, so a SocketSink<sckt::TCPSocket> also sends over a sckt::TLSSocket,
+* but sckt::UnixSocket derives from sckt::Socket, which has no Send(), so the
+* socket type is a template parameter: sckt::TCPSocket or sckt::UnixSocket.
+*
+* Write() fails, and the writer stops, if the socket throws.
+*/
+template <class S>
+class SocketSink : public TiXmlSink
+{
+public:
+   SocketSink(S& s) : socket(s)
+   {
+   }
+
+   virtual bool Write(const char* data, size_t length)
+   {
+      try
+      {
+         while (length > 0)
+         {
+            sckt::uint chunk = length > 0x40000000 ? 0x40000000 : (sckt::uint) length;
+            sckt::uint sent = socket.Send((const sckt::byte*) data, chunk);
+            data += sent;
+            length -= sent;
+         }
+      }
+      catch (sckt::Exc&)
+      {
+         return false;
+      }
+      return true;
+   }
+
+private:
+   S& socket;
+};
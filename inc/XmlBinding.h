@@ -0,0 +1,191 @@
+#pragma once
+
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+#include "tinyxml.h"
+
+// Conversions from the text of an element or attribute to a field.
+inline void XmlConvert(const char* text, std::string& field) { field = text; }
+inline void XmlConvert(const char* text, int& field) { field = atoi(text); }
+inline void XmlConvert(const char* text, double& field) { field = strtod(text, 0); }
+inline void XmlConvert(const char* text, bool& field) { field = strcmp(text, "true") == 0 || strcmp(text, "1") == 0; }
+
+/*
+* Maps the child elements and attributes of an element to the members of a T.
+* The names are declared once:
+*
+*    XmlBinding<Movie> binding;
+*    binding.Element("name", &Movie::name).Element("id", &Movie::id);
+*
+* and Fill() then walks the element once, and dispatches each child on the
+* symbol of its name (see TiXmlNameTable) instead of searching for every field.
+*/
+template <class T>
+class XmlBinding
+{
+public:
+   XmlBinding() : elements(0), attributes(0)
+   {
+   }
+
+   ~XmlBinding()
+   {
+      Free(elements);
+      Free(attributes);
+   }
+
+   // Binds the text of the child element 'name' to 'member'.
+   template <class F>
+   XmlBinding& Element(const char* name, F T::*member)
+   {
+      Add(elements, name, new Field<F>(member));
+      return *this;
+   }
+
+   // Binds the value of the attribute 'name' to 'member'.
+   template <class F>
+   XmlBinding& Attribute(const char* name, F T::*member)
+   {
+      Add(attributes, name, new Field<F>(member));
+      return *this;
+   }
+
+   // Sets the members of 'object' from 'element'. Members with no child or
+   // attribute are left alone. Returns the number of members set.
+   int Fill(const TiXmlElement* element, T& object) const
+   {
+      int set = 0;
+      for (const TiXmlAttribute* attribute = element->FirstAttribute(); attribute; attribute = attribute->Next())
+      {
+         const FieldBase* field = Find(attributes, attribute->Symbol());
+         if (field)
+         {
+            field->Set(object, attribute->Value());
+            ++set;
+         }
+      }
+      for (const TiXmlElement* child = element->FirstChildElement(); child; child = child->NextSiblingElement())
+      {
+         const FieldBase* field = Find(elements, child->Symbol());
+         if (field)
+         {
+            const char* text = child->GetText();
+            field->Set(object, text ? text : "");
+            ++set;
+         }
+      }
+      return set;
+   }
+
+private:
+   XmlBinding(const XmlBinding&);
+   void operator=(const XmlBinding&);
+
+   class FieldBase
+   {
+   public:
+      virtual ~FieldBase() {}
+      virtual void Set(T& object, const char* text) const = 0;
+   };
+
+   template <class F>
+   class Field : public FieldBase
+   {
+   public:
+      Field(F T::*m) : member(m) {}
+      void Set(T& object, const char* text) const { XmlConvert(text, object.*member); }
+   private:
+      F T::*member;
+   };
+
+   // Fields by symbol: open addressing with linear probing, at most half full.
+   // Symbols are packed next to each other in the name table, so their
+   // addresses are spread well over the low bits.
+   struct Table
+   {
+      size_t mask;
+      size_t count;
+      const char** symbols;
+      FieldBase** fields;
+   };
+
+   static void Add(Table*& table, const char* name, FieldBase* field)
+   {
+      if (!table || (table->count + 1) * 2 > table->mask + 1)
+         Grow(table);
+      const char* symbol = TiXmlNameTable::Intern(name);
+      size_t i = (size_t) symbol & table->mask;
+      while (table->symbols[i] && table->symbols[i] != symbol)
+         i = (i + 1) & table->mask;
+      if (table->symbols[i])
+      {
+         // Bound twice: the last binding wins.
+         delete table->fields[i];
+      }
+      else
+      {
+         table->symbols[i] = symbol;
+         ++table->count;
+      }
+      table->fields[i] = field;
+   }
+
+   static const FieldBase* Find(const Table* table, const char* symbol)
+   {
+      if (!table || !symbol)
+         return 0;
+      for (size_t i = (size_t) symbol & table->mask; table->symbols[i]; i = (i + 1) & table->mask)
+      {
+         if (table->symbols[i] == symbol)
+            return table->fields[i];
+      }
+      return 0;
+   }
+
+   static void Grow(Table*& table)
+   {
+      Table* grown = new Table;
+      grown->mask = table ? table->mask * 2 + 1 : 15;
+      grown->count = 0;
+      grown->symbols = new const char*[grown->mask + 1];
+      grown->fields = new FieldBase*[grown->mask + 1];
+      for (size_t i = 0; i <= grown->mask; ++i)
+         grown->symbols[i] = 0;
+      if (table)
+      {
+         for (size_t j = 0; j <= table->mask; ++j)
+         {
+            if (!table->symbols[j])
+               continue;
+            size_t i = (size_t) table->symbols[j] & grown->mask;
+            while (grown->symbols[i])
+               i = (i + 1) & grown->mask;
+            grown->symbols[i] = table->symbols[j];
+            grown->fields[i] = table->fields[j];
+            ++grown->count;
+         }
+         delete [] table->symbols;
+         delete [] table->fields;
+         delete table;
+      }
+      table = grown;
+   }
+
+   static void Free(Table* table)
+   {
+      if (!table)
+         return;
+      for (size_t i = 0; i <= table->mask; ++i)
+      {
+         if (table->symbols[i])
+            delete table->fields[i];
+      }
+      delete [] table->symbols;
+      delete [] table->fields;
+      delete table;
+   }
+
+   Table* elements;
+   Table* attributes;
+};
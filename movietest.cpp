@@ -0,0 +1,93 @@
+/*
+* Test program for Movie::Load().
+*/
+#include <stdio.h>
+#include <string.h>
+#include "tinyxml.h"
+#include "Movie.h"
+
+static int gPass = 0;
+static int gFail = 0;
+
+static void MovieTest(const char* testString, bool okay)
+{
+   printf("[%s] %s\n", okay ? "pass" : "fail", testString);
+   if (okay)
+      ++gPass;
+   else
+      ++gFail;
+}
+
+static void MovieTest(const char* testString, const char* expected, const std::string& found)
+{
+   MovieTest(testString, found == expected);
+}
+
+int main()
+{
+   // A <movie> from a Movie.search response.
+   const char* movieXml =
+      "<movie>"
+      "<score>1.0</score>"
+      "<popularity>3</popularity>"
+      "<translated>true</translated>"
+      "<adult>false</adult>"
+      "<language>en</language>"
+      "<original_name>The Matrix</original_name>"
+      "<name>The Matrix</name>"
+      "<alternative_name>Matrix</alternative_name>"
+      "<type>movie</type>"
+      "<id>603</id>"
+      "<imdb_id>tt0133093</imdb_id>"
+      "<url>http://www.themoviedb.org/movie/603</url>"
+      "<votes>112</votes>"
+      "<rating>8.8</rating>"
+      "<certification>R</certification>"
+      "<overview>Thomas A. Anderson &amp; the Matrix.</overview>"
+      "<released>1999-03-31</released>"
+      "<images><image type=\"poster\" url=\"http://example.com/p.jpg\" size=\"original\" id=\"1\"/></images>"
+      "<last_modified_at>2010-08-27 18:23:24</last_modified_at>"
+      "<version>150</version>"
+      "</movie>";
+
+   TiXmlDocument doc;
+   doc.Parse(movieXml);
+   MovieTest("Movie parsed.", !doc.Error() && doc.RootElement());
+
+   Movie movie;
+   movie.Load(doc.RootElement());
+
+   MovieTest("Score.", movie.GetScore() == 1.0);
+   MovieTest("Popularity.", movie.GetPopularity() == 3);
+   MovieTest("Id.", movie.GetId() == 603);
+   MovieTest("Votes.", movie.GetVotes() == 112);
+   MovieTest("Rating.", movie.GetRating() == 8.8);
+   MovieTest("Version.", movie.GetVersion() == 150);
+
+   MovieTest("Translated.", movie.IsTranslated());
+   MovieTest("Adult.", !movie.IsAdult());
+
+   MovieTest("Language.", "en", movie.GetLanguage());
+   MovieTest("Original name.", "The Matrix", movie.GetOriginalName());
+   MovieTest("Name.", "The Matrix", movie.GetName());
+   MovieTest("Alternative name.", "Matrix", movie.GetAlternativeName());
+   MovieTest("Type.", "movie", movie.GetType());
+   MovieTest("IMDb id.", "tt0133093", movie.GetImdbId());
+   MovieTest("Url.", "http://www.themoviedb.org/movie/603", movie.GetUrl());
+   MovieTest("Certification.", "R", movie.GetCertification());
+   MovieTest("Overview entities.", "Thomas A. Anderson & the Matrix.", movie.GetOverview());
+   MovieTest("Released.", "1999-03-31", movie.GetReleased());
+   MovieTest("Last modified.", "2010-08-27 18:23:24", movie.GetLastModified());
+
+   // Fields the element doesn't have keep their values.
+   TiXmlDocument partial;
+   partial.Parse("<movie><adult>1</adult><name></name></movie>");
+   movie.Load(partial.RootElement());
+   MovieTest("Partial load, bool.", movie.IsAdult());
+   MovieTest("Partial load, empty name.", "", movie.GetName());
+   MovieTest("Partial load keeps id.", movie.GetId() == 603);
+   MovieTest("Partial load keeps language.", "en", movie.GetLanguage());
+
+   printf("\nPass %d, Fail %d\n", gPass, gFail);
+   return gFail;
+}
@@ -0,0 +1,358 @@
+/* The MIT License:
+
+Copyright (c) 2008 Ivan Gagis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE. */
+
+// Description:
+//          multi-threaded event loops for sckt sockets (Linux only, epoll based)
+//
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE //for pthread_setaffinity_np()
+#endif
+
+#include "reactor.h"
+
+#include <sched.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+using namespace sckt;
+
+//maximal number of events handled per one epoll_wait() call
+#define M_MAX_EVENTS 64
+
+inline static int SocketFD(const Socket::SystemIndependentSocketHandle& s){
+    return *reinterpret_cast<const int*>(&s);
+};
+
+struct Reactor::Registration{
+    Socket *socket;
+    SocketHandler *handler;
+    bool removed;
+    bool handled;//the handler was called in the current iteration of the event loop
+};
+
+class Reactor::AddSocketTask : public Task{
+    Socket *socket;
+    SocketHandler *handler;
+public:
+    AddSocketTask(Socket* socket, SocketHandler* handler) :
+            socket(socket),
+            handler(handler)
+    {};
+    
+    void Run(Reactor& reactor){
+        Registration *r = new Registration();
+        r->socket = this->socket;
+        r->handler = this->handler;
+        r->removed = false;
+        r->handled = false;
+        
+        epoll_event e;
+        e.events = EPOLLIN;
+        e.data.ptr = r;
+        if(epoll_ctl(reactor.epollFD, EPOLL_CTL_ADD, SocketFD(this->socket->socket), &e) != 0){
+            //invalid or already added socket, ignore it
+            delete r;
+            __sync_fetch_and_sub(&reactor.load, 1);
+        }else{
+            reactor.registrations[this->socket] = r;
+        }
+        delete this;
+    };
+};
+
+Reactor::Reactor(int cpu) throw(sckt::Exc) :
+        head(&this->stub),
+        tail(&this->stub),
+        wakeupPending(0),
+        quitFlag(0),
+        load(0)
+{
+    this->epollFD = epoll_create(M_MAX_EVENTS);
+    if(this->epollFD < 0)
+        throw sckt::Exc("Reactor::Reactor(): epoll_create() failed");
+    
+    this->eventFD = eventfd(0, EFD_NONBLOCK);
+    if(this->eventFD < 0){
+        close(this->epollFD);
+        throw sckt::Exc("Reactor::Reactor(): eventfd() failed");
+    }
+    
+    //eventfd is distinguished from sockets by null data pointer
+    epoll_event e;
+    e.events = EPOLLIN;
+    e.data.ptr = 0;
+    if(epoll_ctl(this->epollFD, EPOLL_CTL_ADD, this->eventFD, &e) != 0){
+        close(this->eventFD);
+        close(this->epollFD);
+        throw sckt::Exc("Reactor::Reactor(): epoll_ctl() failed");
+    }
+    
+    if(pthread_create(&this->thread, 0, &Reactor::ThreadFunc, this) != 0){
+        close(this->eventFD);
+        close(this->epollFD);
+        throw sckt::Exc("Reactor::Reactor(): pthread_create() failed");
+    }
+    
+    if(cpu >= 0){
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(cpu, &cpuSet);
+        //binding failure is not fatal, the reactor just runs unbound
+        pthread_setaffinity_np(this->thread, sizeof(cpuSet), &cpuSet);
+    }
+};
+
+Reactor::~Reactor(){
+    __atomic_store_n(&this->quitFlag, 1, __ATOMIC_RELEASE);
+    __sync_synchronize();
+    this->Wakeup();
+    pthread_join(this->thread, 0);
+    
+    close(this->eventFD);
+    close(this->epollFD);
+    
+    for(T_RegistrationMap::iterator i = this->registrations.begin(); i != this->registrations.end(); ++i)
+        delete i->second;
+    for(std::vector<Registration*>::iterator i = this->removedRegistrations.begin(); i != this->removedRegistrations.end(); ++i)
+        delete *i;
+    
+    //delete add socket tasks which were not executed
+    for(Task *t = this->Pop(); t; t = this->Pop()){
+        if(AddSocketTask *ast = dynamic_cast<AddSocketTask*>(t))
+            delete ast;
+    }
+};
+
+void Reactor::Push(Task* task){
+    //The links are loaded and stored atomically, the release store of the link publishes the task
+    //to the consumer, which loads the link with acquire semantics.
+    __atomic_store_n(&task->next, static_cast<Task*>(0), __ATOMIC_RELAXED);
+    Task *prev = __atomic_exchange_n(&this->head, task, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&prev->next, task, __ATOMIC_RELEASE);
+};
+
+//returns 0 if queue is empty or a producer is in the middle of Push()
+Task* Reactor::Pop(){
+    Task *t = this->tail;
+    Task *next = __atomic_load_n(&t->next, __ATOMIC_ACQUIRE);
+    if(t == &this->stub){
+        if(!next)
+            return 0;
+        this->tail = next;
+        t = next;
+        next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+    }
+    if(next){
+        this->tail = next;
+        return t;
+    }
+    if(t != __atomic_load_n(&this->head, __ATOMIC_ACQUIRE))
+        return 0;//producer has not finished Push() yet
+    this->Push(&this->stub);
+    next = __atomic_load_n(&t->next, __ATOMIC_ACQUIRE);
+    if(next){
+        this->tail = next;
+        return t;
+    }
+    return 0;
+};
+
+void Reactor::Wakeup(){
+    //signal eventfd only once until the reactor processes it, saves system calls under load
+    if(__sync_lock_test_and_set(&this->wakeupPending, 1) != 0)
+        return;
+    u64 one = 1;
+    while(write(this->eventFD, &one, sizeof(one)) < 0 && errno == EINTR){}
+};
+
+void Reactor::Submit(Task* task){
+    this->Push(task);
+    this->Wakeup();
+};
+
+void Reactor::AddSocket(Socket* socket, SocketHandler* handler) throw(sckt::Exc){
+    if(!socket || !handler)
+        throw sckt::Exc("Reactor::AddSocket(): null pointer passed as argument");
+    
+    __sync_fetch_and_add(&this->load, 1);
+    this->Submit(new AddSocketTask(socket, handler));
+};
+
+void Reactor::RemoveSocket(Socket* socket){
+    T_RegistrationMap::iterator i = this->registrations.find(socket);
+    if(i == this->registrations.end())
+        return;
+    
+    epoll_ctl(this->epollFD, EPOLL_CTL_DEL, SocketFD(socket->socket), 0);
+    
+    //events of this batch may still refer to the registration, so delete it later
+    i->second->removed = true;
+    this->removedRegistrations.push_back(i->second);
+    this->registrations.erase(i);
+    __sync_fetch_and_sub(&this->load, 1);
+};
+
+void Reactor::ProcessTasks(){
+    //Reset the flag before taking tasks from the queue, so the tasks submitted
+    //after this point will either be taken now or signal eventfd again.
+    u64 value;
+    while(read(this->eventFD, &value, sizeof(value)) < 0 && errno == EINTR){}
+    __sync_lock_release(&this->wakeupPending);
+    __sync_synchronize();
+    
+    for(;;){
+        Task *t = this->Pop();
+        if(t){
+            t->Run(*this);
+            continue;
+        }
+        if(this->tail == __atomic_load_n(&this->head, __ATOMIC_ACQUIRE))
+            break;//queue is empty
+        sched_yield();//some producer is in the middle of Push(), wait for it
+    }
+};
+
+//static
+void* Reactor::ThreadFunc(void* reactor){
+    reinterpret_cast<Reactor*>(reactor)->Run();
+    return 0;
+};
+
+void Reactor::HandleReady(Registration* r){
+    r->handled = true;
+    r->socket->isReady = true;
+    r->handler->OnReady(*this, *r->socket);
+    
+    //Data buffered in user space (TLS) is not reported by epoll, see Socket::HasBufferedData().
+    //Such data can only appear as a result of reading from the socket, i.e. in the handler.
+    if(!r->removed && r->socket->HasBufferedData())
+        this->buffered.push_back(r);
+};
+
+void Reactor::Run(){
+    epoll_event events[M_MAX_EVENTS];
+    std::vector<Registration*> wasBuffered;
+    
+    while(!__atomic_load_n(&this->quitFlag, __ATOMIC_ACQUIRE)){
+        int n = epoll_wait(this->epollFD, events, M_MAX_EVENTS, this->buffered.empty() ? -1 : 0);
+        if(n < 0){
+            if(errno == EINTR)
+                continue;
+            break;//should not happen
+        }
+        
+        wasBuffered.swap(this->buffered);
+        
+        for(int i = 0; i < n; ++i){
+            Registration *r = reinterpret_cast<Registration*>(events[i].data.ptr);
+            if(!r){
+                this->ProcessTasks();
+                continue;
+            }
+            if(r->removed)
+                continue;
+            this->HandleReady(r);
+        }
+        
+        for(std::vector<Registration*>::iterator i = wasBuffered.begin(); i != wasBuffered.end(); ++i){
+            if((*i)->removed || (*i)->handled)
+                continue;//removed or already handled in this iteration
+            if((*i)->socket->HasBufferedData())
+                this->HandleReady(*i);
+        }
+        
+        //clear the flags for the next iteration
+        for(int i = 0; i < n; ++i){
+            Registration *r = reinterpret_cast<Registration*>(events[i].data.ptr);
+            if(r)
+                r->handled = false;
+        }
+        for(std::vector<Registration*>::iterator i = wasBuffered.begin(); i != wasBuffered.end(); ++i)
+            (*i)->handled = false;
+        wasBuffered.clear();
+        
+        //a socket left with buffered data may have been removed later in this iteration
+        if(!this->removedRegistrations.empty()){
+            std::vector<Registration*>::iterator end = this->buffered.begin();
+            for(std::vector<Registration*>::iterator i = this->buffered.begin(); i != this->buffered.end(); ++i){
+                if(!(*i)->removed)
+                    *end++ = *i;
+            }
+            this->buffered.erase(end, this->buffered.end());
+        }
+        
+        for(std::vector<Registration*>::iterator i = this->removedRegistrations.begin(); i != this->removedRegistrations.end(); ++i)
+            delete *i;
+        this->removedRegistrations.clear();
+    }
+};
+
+ReactorPool::ReactorPool(uint numReactors, bool pinToCores, E_Assignment assignment) throw(sckt::Exc) :
+        assignment(assignment),
+        nextReactor(0)
+{
+    long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    if(numCores < 1)
+        numCores = 1;
+    
+    if(numReactors == 0)
+        numReactors = uint(numCores);
+    
+    this->reactors = new Reactor*[numReactors];
+    this->numReactors = 0;
+    try{
+        for(; this->numReactors < numReactors; ++this->numReactors){
+            int cpu = pinToCores ? int(this->numReactors % uint(numCores)) : -1;
+            this->reactors[this->numReactors] = new Reactor(cpu);
+        }
+    }catch(...){
+        for(uint i = 0; i < this->numReactors; ++i)
+            delete this->reactors[i];
+        delete[] this->reactors;
+        throw;
+    }
+};
+
+ReactorPool::~ReactorPool(){
+    for(uint i = 0; i < this->numReactors; ++i)
+        delete this->reactors[i];
+    delete[] this->reactors;
+};
+
+Reactor& ReactorPool::Pick(){
+    if(this->assignment == LEAST_LOADED){
+        //start from different reactors, so equally loaded reactors are picked in turn
+        uint start = __sync_fetch_and_add(&this->nextReactor, 1);
+        Reactor *best = 0;
+        for(uint i = 0; i < this->numReactors; ++i){
+            Reactor *r = this->reactors[(start + i) % this->numReactors];
+            if(!best || r->Load() < best->Load())
+                best = r;
+        }
+        return *best;
+    }
+    
+    return *this->reactors[__sync_fetch_and_add(&this->nextReactor, 1) % this->numReactors];
+};
@@ -0,0 +1,284 @@
+/* The MIT License:
+
+Copyright (c) 2008 Ivan Gagis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE. */
+
+// Description:
+//          multi-threaded event loops for sckt sockets (Linux only, epoll based)
+//
+
+/**
+@file reactor.h
+@brief Event loop threads.
+A reactor is a thread running an event loop which waits for activity on its sockets
+and executes tasks submitted to it by other threads.
+The reactor pool runs several reactors, normally one per CPU core, and distributes
+the sockets and tasks between them.
+*/
+
+#ifndef M_SCKT_REACTOR_HPP
+#define M_SCKT_REACTOR_HPP
+
+#ifndef __linux__
+#error "sckt reactor requires Linux (epoll, eventfd)"
+#endif
+
+#include <pthread.h>
+#include <map>
+#include <vector>
+
+#include "sckt.h"
+
+namespace sckt{
+
+class Reactor;
+
+/**
+@brief Task which can be submitted to a reactor.
+The task is executed in the reactor thread. The reactor does not take ownership of the task,
+the task may delete itself at the end of its Run() method if it was allocated with new.
+The same task object must not be submitted again until its Run() method is called.
+*/
+class M_DECLSPEC Task{
+    friend class Reactor;
+    
+    Task* volatile next;//intrusive link of the submission queue
+public:
+    Task() :
+            next(0)
+    {};
+    
+    virtual ~Task(){};
+    
+    /**
+    @brief Executes the task.
+    Called from the reactor thread.
+    @param reactor - reactor which executes the task.
+    */
+    virtual void Run(Reactor& reactor) = 0;
+};
+
+/**
+@brief Handler of socket activity.
+*/
+class M_DECLSPEC SocketHandler{
+public:
+    virtual ~SocketHandler(){};
+    
+    /**
+    @brief Called when there is activity on the socket.
+    Called from the reactor thread when there is data to read on the socket or
+    the remote socket has disconnected (then subsequent Recv() returns 0).
+    The socket is marked as ready, see sckt::Socket::IsReady().
+    The handler may remove the socket from the reactor and close it.
+    @param reactor - reactor the socket belongs to.
+    @param socket - the socket.
+    */
+    virtual void OnReady(Reactor& reactor, Socket& socket) = 0;
+};
+
+/**
+@brief Event loop thread.
+The reactor starts its thread on construction and stops it on destruction.
+Sockets are watched with epoll, tasks are submitted through a lock-free multiple producer
+single consumer queue and the thread is woken up with eventfd.
+The reactor does not own the sockets, handlers and tasks.
+*/
+class M_DECLSPEC Reactor{
+    friend class ReactorPool;
+    
+    pthread_t thread;
+    int epollFD;
+    int eventFD;
+    
+    //submission queue, see http://www.1024cores.net/home/lock-free-algorithms/queues/intrusive-mpsc-node-based-queue
+    Task* volatile head;//producers push here
+    Task* tail;//consumer pops here
+    
+    struct StubTask : public Task{
+        void Run(Reactor&){};
+    } stub;
+    
+    volatile int wakeupPending;//1 if eventfd was already signalled and the reactor has not processed it yet
+    volatile int quitFlag;
+    volatile uint load;
+    
+    struct Registration;
+    typedef std::map<Socket*, Registration*> T_RegistrationMap;
+    T_RegistrationMap registrations;
+    std::vector<Registration*> removedRegistrations;//deleted after the current batch of events is handled
+    std::vector<Registration*> buffered;//sockets which have data buffered in user space
+    
+    BufferPool pool;
+    
+    void Push(Task* task);
+    Task* Pop();
+    void ProcessTasks();
+    void Wakeup();
+    
+    static void* ThreadFunc(void* reactor);
+    void Run();
+    void HandleReady(Registration* r);
+    
+    class AddSocketTask;
+    
+    //not copyable
+    Reactor(const Reactor&);
+    Reactor& operator=(const Reactor&);
+
+public:
+    /**
+    @brief Creates a reactor and starts its thread.
+    @param cpu - index of CPU core to bind the reactor thread to, negative value means no binding.
+    */
+    Reactor(int cpu = -1) throw(sckt::Exc);
+    
+    /**
+    @brief Stops the reactor thread and destroys the reactor.
+    Tasks which are still in the queue are not executed.
+    */
+    ~Reactor();
+    
+    /**
+    @brief Submits a task for execution in the reactor thread.
+    This method is thread safe and lock-free, it can be called from any thread.
+    @param task - task to execute.
+    */
+    void Submit(Task* task);
+    
+    /**
+    @brief Adds the socket to the reactor.
+    This method is thread safe, the socket is actually added by the reactor thread.
+    Once added, the socket must only be used from the reactor thread.
+    @param socket - socket to watch for activity.
+    @param handler - handler to call when there is activity on the socket.
+    */
+    void AddSocket(Socket* socket, SocketHandler* handler) throw(sckt::Exc);
+    
+    /**
+    @brief Removes the socket from the reactor.
+    Must be called from the reactor thread, e.g. from the socket handler.
+    The socket must be removed before it is closed or destroyed.
+    @param socket - socket to remove.
+    */
+    void RemoveSocket(Socket* socket);
+    
+    /**
+    @brief Returns the current load of the reactor.
+    @return the number of sockets which are added or being added to the reactor.
+    */
+    uint Load()const{
+        return __atomic_load_n(&this->load, __ATOMIC_RELAXED);
+    };
+    
+    /**
+    @brief Returns the buffer pool of the reactor.
+    The pool must only be used from the reactor thread, see sckt::TCPSocket::Recv(BufferPool&).
+    */
+    BufferPool& Pool(){
+        return this->pool;
+    };
+};
+
+/**
+@brief Set of reactors.
+Runs several reactors and assigns new sockets and tasks to them.
+*/
+class M_DECLSPEC ReactorPool{
+public:
+    /**
+    @brief Policy of assigning sockets and tasks to reactors.
+    */
+    enum E_Assignment{
+        ROUND_ROBIN,///< reactors are taken in turn
+        LEAST_LOADED///< reactor with the smallest number of sockets is taken
+    };
+
+private:
+    Reactor** reactors;
+    uint numReactors;
+    E_Assignment assignment;
+    volatile uint nextReactor;
+    
+    //not copyable
+    ReactorPool(const ReactorPool&);
+    ReactorPool& operator=(const ReactorPool&);
+
+public:
+    /**
+    @brief Creates the reactors.
+    @param numReactors - number of reactors, 0 means one reactor per online CPU core.
+    @param pinToCores - if true, i-th reactor thread is bound to i-th CPU core.
+    @param assignment - policy of assigning sockets and tasks to reactors.
+    */
+    ReactorPool(uint numReactors = 0, bool pinToCores = false, E_Assignment assignment = ROUND_ROBIN) throw(sckt::Exc);
+    
+    /**
+    @brief Stops all the reactors.
+    */
+    ~ReactorPool();
+    
+    /**
+    @brief Returns the number of reactors.
+    */
+    uint NumReactors()const{
+        return this->numReactors;
+    };
+    
+    /**
+    @brief Returns the reactor by index.
+    @param i - reactor index, must be less than NumReactors().
+    */
+    Reactor& operator[](uint i){
+        return *this->reactors[i];
+    };
+    
+    /**
+    @brief Picks a reactor according to the assignment policy.
+    This method is thread safe.
+    */
+    Reactor& Pick();
+    
+    /**
+    @brief Submits the task to a reactor picked according to the assignment policy.
+    This method is thread safe.
+    @return the reactor the task was submitted to.
+    */
+    Reactor& Submit(Task* task){
+        Reactor& r = this->Pick();
+        r.Submit(task);
+        return r;
+    };
+    
+    /**
+    @brief Adds the socket to a reactor picked according to the assignment policy.
+    This method is thread safe.
+    @return the reactor the socket was added to.
+    */
+    Reactor& AddSocket(Socket* socket, SocketHandler* handler) throw(sckt::Exc){
+        Reactor& r = this->Pick();
+        r.AddSocket(socket, handler);
+        return r;
+    };
+};
+
+}//~namespace sckt
+
+#endif//~once
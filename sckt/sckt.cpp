@@ -39,6 +39,9 @@ typedef SOCKET T_Socket;
 #define M_SOCKET_ERROR SOCKET_ERROR
 #define M_EINTR WSAEINTR
 #define M_FD_SETSIZE FD_SETSIZE
+#define M_THREAD_LOCAL __declspec(thread)
+#define M_COMPARE_AND_SWAP_POINTER(ptr, oldVal, newVal) \
+        (InterlockedCompareExchangePointer(reinterpret_cast<void* volatile*>(ptr), (newVal), (oldVal)) == (oldVal))
 
 #else //assume linux/unix
 
@@ -53,14 +56,53 @@ typedef SOCKET T_Socket;
 #include <signal.h>
 #include <errno.h>
 #include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/un.h>
+#include <stddef.h>
 typedef int T_Socket;
 #define M_INVALID_SOCKET (-1)
 #define M_SOCKET_ERROR (-1)
 #define M_EINTR EINTR
 #define M_FD_SETSIZE FD_SETSIZE
+#define M_THREAD_LOCAL __thread
+#define M_COMPARE_AND_SWAP_POINTER(ptr, oldVal, newVal) __sync_bool_compare_and_swap((ptr), (oldVal), (newVal))
 
 #endif
 
+#ifdef M_SCKT_WITH_TLS
+#include <string>
+#include <map>
+#ifndef __WIN32__
+#include <pthread.h>
+#endif
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#endif
+
+//statements which are compiled only if statistics is enabled
+#ifdef M_SCKT_WITH_STATS
+#define M_SCKT_STATS(x) x
+#else
+#define M_SCKT_STATS(x)
+#endif
+
+#ifdef M_SCKT_WITH_STATS
+//Statistics counters are written by one thread and read by others (see sckt::Stats::Scrape()),
+//so they are loaded and stored atomically. There is only one writer, so they are not incremented atomically.
+#if defined(__GNUC__)
+#define M_LOAD_RELAXED(ptr) __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define M_STORE_RELAXED(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELAXED)
+#define M_LOAD_ACQUIRE(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#elif defined(__WIN32__)
+#define M_LOAD_RELAXED(ptr) u64(InterlockedCompareExchange64((volatile LONGLONG*)(ptr), 0, 0))
+#define M_STORE_RELAXED(ptr, val) InterlockedExchange64((volatile LONGLONG*)(ptr), LONGLONG(val))
+#define M_LOAD_ACQUIRE(ptr) (*(ptr))//volatile reads have acquire semantics in MSVC
+#else
+#error do not know how to load and store statistics counters atomically
+#endif
+#endif//~M_SCKT_WITH_STATS
+
 using namespace sckt;
 
 Library* Library::instance = 0;
@@ -153,8 +195,217 @@ Library::~Library(){
     this->instance = 0;
 };
 
+#ifdef M_SCKT_WITH_STATS
+
+//monotonic time in microseconds
+static u64 GetTimeMicros(){
+#ifdef __WIN32__
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    u64 f = u64(freq.QuadPart);
+    u64 c = u64(counter.QuadPart);
+    return c / f * 1000000 + c % f * 1000000 / f;
+#else //assume linux/unix
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return u64(ts.tv_sec) * 1000000 + u64(ts.tv_nsec / 1000);
+#endif
+};
+
+namespace{
+//statistics block of one thread
+struct ThreadStats{
+    Stats stats;
+    ThreadStats *next;
+};
+}
+
+//list of statistics blocks of all threads, blocks are never removed from the list,
+//so statistics of finished threads is not lost.
+static ThreadStats* volatile threadStatsList = 0;
+
+static M_THREAD_LOCAL ThreadStats* threadStats = 0;
+
+//returns the statistics block of the calling thread
+static Stats& LocalStats(){
+    if(!threadStats){
+        ThreadStats *ts = new(std::nothrow) ThreadStats();
+        if(!ts){
+            //out of memory, statistics of this call is discarded
+            static ThreadStats discarded;
+            return discarded.stats;
+        }
+        
+        do{
+            ts->next = M_LOAD_ACQUIRE(&threadStatsList);
+        }while(!M_COMPARE_AND_SWAP_POINTER(&threadStatsList, ts->next, ts));
+        
+        threadStats = ts;
+    }
+    return threadStats->stats;
+};
+
+//adds to a counter of the calling thread's statistics block, other threads may be reading it
+inline static void AddRelaxed(u64* counter, u64 value){
+    M_STORE_RELAXED(counter, M_LOAD_RELAXED(counter) + value);
+};
+
+//updates the counter of the socket and the global one
+inline static void CountIO(IOCounters& socketCounters, u64 IOCounters::* counter, u64 value){
+    socketCounters.*counter += value;
+    AddRelaxed(&(LocalStats().counters.*counter), value);
+};
+
+void Histogram::Record(u64 value){
+    AddRelaxed(&this->counts[Histogram::BucketIndex(value)], 1);
+    AddRelaxed(&this->totalCount, 1);
+    AddRelaxed(&this->sum, value);
+    if(value > this->max)
+        M_STORE_RELAXED(&this->max, value);
+};
+
+void Histogram::Reset(){
+    memset(this->counts, 0, sizeof(this->counts));
+    this->totalCount = 0;
+    this->sum = 0;
+    this->max = 0;
+};
+
+Histogram& Histogram::operator+=(const Histogram& h){
+    //h may be the statistics block of another thread, which keeps recording to it
+    for(uint i = 0; i < NUM_BUCKETS; ++i)
+        this->counts[i] += M_LOAD_RELAXED(&h.counts[i]);
+    this->totalCount += M_LOAD_RELAXED(&h.totalCount);
+    this->sum += M_LOAD_RELAXED(&h.sum);
+    u64 hMax = M_LOAD_RELAXED(&h.max);
+    if(hMax > this->max)
+        this->max = hMax;
+    return *this;
+};
+
+//static
+u64 Histogram::BucketHighestValue(uint index){
+    if(index < uint(SUB_BUCKET_COUNT))
+        return index;
+    
+    uint magnitude = index / SUB_BUCKET_COUNT + SUB_BUCKET_BITS - 1;
+    u64 subBucket = index % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT;
+    return ((subBucket + 1) << (magnitude - SUB_BUCKET_BITS)) - 1;
+};
+
+u64 Histogram::ValueAtPercentile(double percentile)const{
+    if(this->totalCount == 0)
+        return 0;
+    
+    if(percentile > 100)
+        percentile = 100;
+    
+    u64 countAtPercentile = u64(percentile / 100 * double(this->totalCount) + 0.5);
+    if(countAtPercentile == 0)
+        countAtPercentile = 1;
+    
+    u64 count = 0;
+    for(uint i = 0; i < NUM_BUCKETS; ++i){
+        count += this->counts[i];
+        if(count >= countAtPercentile){
+            u64 v = Histogram::BucketHighestValue(i);
+            return v < this->max ? v : this->max;
+        }
+    }
+    return this->max;
+};
+
+void IOCounters::Reset(){
+    this->bytesSent = 0;
+    this->bytesReceived = 0;
+    this->sendCalls = 0;
+    this->recvCalls = 0;
+    this->connectCalls = 0;
+    this->acceptCalls = 0;
+    this->selectCalls = 0;
+    this->eintrRetries = 0;
+    this->partialWrites = 0;
+};
+
+IOCounters& IOCounters::operator+=(const IOCounters& c){
+    //c may be the statistics block of another thread, which keeps counting
+    this->bytesSent += M_LOAD_RELAXED(&c.bytesSent);
+    this->bytesReceived += M_LOAD_RELAXED(&c.bytesReceived);
+    this->sendCalls += M_LOAD_RELAXED(&c.sendCalls);
+    this->recvCalls += M_LOAD_RELAXED(&c.recvCalls);
+    this->connectCalls += M_LOAD_RELAXED(&c.connectCalls);
+    this->acceptCalls += M_LOAD_RELAXED(&c.acceptCalls);
+    this->selectCalls += M_LOAD_RELAXED(&c.selectCalls);
+    this->eintrRetries += M_LOAD_RELAXED(&c.eintrRetries);
+    this->partialWrites += M_LOAD_RELAXED(&c.partialWrites);
+    return *this;
+};
+
+void Stats::Reset(){
+    this->counters.Reset();
+    this->connectLatency.Reset();
+    this->firstByteLatency.Reset();
+    this->responseLatency.Reset();
+};
+
+Stats& Stats::operator+=(const Stats& s){
+    this->counters += s.counters;
+    this->connectLatency += s.connectLatency;
+    this->firstByteLatency += s.firstByteLatency;
+    this->responseLatency += s.responseLatency;
+    return *this;
+};
+
+//static
+void Stats::Scrape(Stats& out_Stats){
+    out_Stats.Reset();
+    for(ThreadStats *ts = M_LOAD_ACQUIRE(&threadStatsList); ts; ts = ts->next)
+        out_Stats += ts->stats;
+};
+
+void Socket::StatsOnSend(){
+    if(this->requestStartTime != 0 && !this->firstByteReceived)
+        return;//request is still being sent
+    
+    //the response to previous request is complete, start a new request
+    this->StatsFinishResponse();
+    this->requestStartTime = GetTimeMicros();
+};
+
+void Socket::StatsOnRecv(uint numBytes){
+    if(numBytes == 0){//disconnected
+        this->StatsFinishResponse();
+        return;
+    }
+    
+    if(this->requestStartTime == 0)
+        return;//data was not requested
+    
+    this->lastRecvTime = GetTimeMicros();
+    if(!this->firstByteReceived){
+        LocalStats().firstByteLatency.Record(this->lastRecvTime - this->requestStartTime);
+        this->firstByteReceived = true;
+    }
+};
+
+void Socket::StatsFinishResponse(){
+    if(this->requestStartTime != 0 && this->firstByteReceived)
+        LocalStats().responseLatency.Record(this->lastRecvTime - this->requestStartTime);
+    
+    this->requestStartTime = 0;
+    this->firstByteReceived = false;
+};
+
+#endif//~M_SCKT_WITH_STATS
+
 Socket::Socket() :
         isReady(false)
+#ifdef M_SCKT_WITH_STATS
+        ,requestStartTime(0),
+        lastRecvTime(0),
+        firstByteReceived(false)
+#endif
 {
     CastToSocket(this->socket) = M_INVALID_SOCKET;
 };
@@ -164,9 +415,17 @@ bool Socket::IsValid()const{
 };
 
 Socket& Socket::operator=(const Socket& s){
-    this->~Socket();
+    //Close() and not the destructor, calling the destructor would reset the virtual table pointer of this object
+    this->Close();
     CastToSocket(this->socket) = CastToSocket(s.socket);
     this->isReady = s.isReady;
+#ifdef M_SCKT_WITH_STATS
+    this->counters = s.counters;
+    this->requestStartTime = s.requestStartTime;
+    this->lastRecvTime = s.lastRecvTime;
+    this->firstByteReceived = s.firstByteReceived;
+    const_cast<Socket&>(s).requestStartTime = 0;
+#endif
     CastToSocket( const_cast<Socket&>(s).socket ) = M_INVALID_SOCKET;//same as std::auto_ptr
     return *this;
 };
@@ -237,6 +496,8 @@ void TCPServerSocket::Open(u16 port, bool disableNaggle) throw(sckt::Exc){
     
     this->disableNaggle = disableNaggle;
     
+    M_SCKT_STATS( this->counters.Reset(); )
+    
     CastToSocket(this->socket) = ::socket(AF_INET, SOCK_STREAM, 0);
     if(CastToSocket(this->socket) == M_INVALID_SOCKET)
         throw sckt::Exc("TCPServerSocket::Open(): Couldn't create socket");
@@ -297,6 +558,8 @@ void TCPSocket::Open(const IPAddress& ip, bool disableNaggle) throw(sckt::Exc){
     if(this->IsValid())
         throw sckt::Exc("TCPSocket::Open(): socket already opened");
     
+    M_SCKT_STATS( this->counters.Reset(); )
+    
     CastToSocket(this->socket) = ::socket(AF_INET, SOCK_STREAM, 0);
     if(CastToSocket(this->socket) == M_INVALID_SOCKET)
         throw sckt::Exc("TCPSocket::Open(): Couldn't create socket");
@@ -310,10 +573,13 @@ void TCPSocket::Open(const IPAddress& ip, bool disableNaggle) throw(sckt::Exc){
     sockAddr.sin_port = htons(ip.port);
 
     // Connect to the remote host
+    M_SCKT_STATS( u64 connectStartTime = GetTimeMicros(); )
+    M_SCKT_STATS( CountIO(this->counters, &IOCounters::connectCalls, 1); )
     if( connect(CastToSocket(this->socket), reinterpret_cast<sockaddr *>(&sockAddr), sizeof(sockAddr)) == M_SOCKET_ERROR ){
         this->Close();
         throw sckt::Exc("TCPSocket::Open(): Couldn't connect to remote host");
     }
+    M_SCKT_STATS( LocalStats().connectLatency.Record(GetTimeMicros() - connectStartTime); )
     
     //Disable Naggle algorithm if required
     if(disableNaggle)
@@ -332,6 +598,7 @@ void TCPSocket::DisableNaggle() throw(sckt::Exc){
 
 void Socket::Close(){
     if(this->IsValid()){
+        M_SCKT_STATS( this->StatsFinishResponse(); )
 #ifdef __WIN32__
         //Closing socket in Win32.
         //refer to http://tangentsoft.net/wskfaq/newbie.html#howclose for details
@@ -362,6 +629,7 @@ TCPSocket TCPServerSocket::Accept() throw(sckt::Exc){
     
     TCPSocket sock;//allocate a new socket object
     
+    M_SCKT_STATS( CountIO(this->counters, &IOCounters::acceptCalls, 1); )
     CastToSocket(sock.socket) = accept(CastToSocket(this->socket), reinterpret_cast<sockaddr*>(&sockAddr),
 #ifdef USE_GUSI_SOCKETS
                 (unsigned int *)&sock_alen);
@@ -396,8 +664,18 @@ TCPSocket TCPServerSocket::Accept() throw(sckt::Exc){
 
 
 sckt::uint TCPSocket::Send(const sckt::byte* data, uint size) throw(sckt::Exc){
+    return this->SendStream(data, size);
+};
+
+
+sckt::uint TCPSocket::Recv(sckt::byte* buf, uint maxSize) throw(sckt::Exc){
+    return this->RecvStream(buf, maxSize);
+};
+
+
+sckt::uint Socket::SendStream(const sckt::byte* data, uint size) throw(sckt::Exc){
     if(!this->IsValid())
-        throw sckt::Exc("TCPSocket::Send(): socket is not opened");
+        throw sckt::Exc("Socket::Send(): socket is not opened");
     
     int sent = 0,
         left = int(size);
@@ -405,16 +683,22 @@ sckt::uint TCPSocket::Send(const sckt::byte* data, uint size) throw(sckt::Exc){
     //Keep sending data until it's sent or an error occurs
     int errorCode = 0;
 
+    M_SCKT_STATS( this->StatsOnSend(); )
+    
     int res;
     do{
         res = send(CastToSocket(this->socket), reinterpret_cast<const char*>(data), left, 0);
+        M_SCKT_STATS( CountIO(this->counters, &IOCounters::sendCalls, 1); )
         if(res == M_SOCKET_ERROR){
 #ifdef __WIN32__
             errorCode = WSAGetLastError();
 #else //linux/unix
             errorCode = errno;
 #endif
+            M_SCKT_STATS( if(errorCode == M_EINTR) CountIO(this->counters, &IOCounters::eintrRetries, 1); )
         }else{
+            M_SCKT_STATS( CountIO(this->counters, &IOCounters::bytesSent, u64(res)); )
+            M_SCKT_STATS( if(res < left) CountIO(this->counters, &IOCounters::partialWrites, 1); )
             sent += res;
             left -= res;
             data += res;
@@ -422,45 +706,166 @@ sckt::uint TCPSocket::Send(const sckt::byte* data, uint size) throw(sckt::Exc){
     }while( (left > 0) && ((res != M_SOCKET_ERROR) || (errorCode == M_EINTR)) );
     
     if(res == M_SOCKET_ERROR)
-        throw sckt::Exc("TCPSocket::Send(): send() failed");
+        throw sckt::Exc("Socket::Send(): send() failed");
     
     return uint(sent);
 };
 
 
-sckt::uint TCPSocket::Recv(sckt::byte* buf, uint maxSize) throw(sckt::Exc){
+sckt::uint Socket::RecvStream(sckt::byte* buf, uint maxSize) throw(sckt::Exc){
     //this flag shall be cleared even if this function fails to avoid subsequent
     //calls to Recv() because it indicates that there's activity.
     //So, do it at the beginning of the function.
     this->isReady = false;
     
     if(!this->IsValid())
-        throw sckt::Exc("TCPSocket::Send(): socket is not opened");
+        throw sckt::Exc("Socket::Recv(): socket is not opened");
     
     int len;
-    int errorCode = 0;
+    int errorCode;
     
     do{
+        errorCode = 0;
         len = recv(CastToSocket(this->socket), reinterpret_cast<char *>(buf), maxSize, 0);
+        M_SCKT_STATS( CountIO(this->counters, &IOCounters::recvCalls, 1); )
         if(len == M_SOCKET_ERROR){
 #ifdef __WIN32__
             errorCode = WSAGetLastError();
 #else //linux/unix
             errorCode = errno;
 #endif
+            M_SCKT_STATS( if(errorCode == M_EINTR) CountIO(this->counters, &IOCounters::eintrRetries, 1); )
         }
     }while(errorCode == M_EINTR);
     
     if(len == M_SOCKET_ERROR)
-        throw sckt::Exc("TCPSocket::Recv(): recv() failed");
+        throw sckt::Exc("Socket::Recv(): recv() failed");
+    
+    M_SCKT_STATS( CountIO(this->counters, &IOCounters::bytesReceived, u64(len)); )
+    M_SCKT_STATS( this->StatsOnRecv(uint(len)); )
     
     return uint(len);
 };
 
+BufferPool::Buffer Socket::RecvToPool(BufferPool& pool) throw(sckt::Exc){
+    BufferPool::Buffer buf = pool.Borrow();
+    buf.SetSize(this->RecvAvailable(buf.Data(), buf.Capacity()));
+    if(buf.Size() == 0)
+        buf.Release();//disconnected, do not hold the memory
+    return buf;
+};
+
+#ifndef __WIN32__
+
+//fills the Unix domain socket address, returns the address length
+static socklen_t MakeUnixAddress(sockaddr_un& addr, const char* path, bool abstractNamespace) throw(sckt::Exc){
+    if(!path)
+        throw sckt::Exc("MakeUnixAddress(): pointer passed as argument is 0");
+    
+    size_t len = strlen(path);
+    
+    //abstract namespace addresses start with null byte and are not null-terminated
+    size_t offset = abstractNamespace ? 1 : 0;
+    if(len + offset >= sizeof(addr.sun_path) || (len == 0 && !abstractNamespace))
+        throw sckt::Exc("MakeUnixAddress(): socket path is too long or empty");
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path + offset, path, len);
+    
+    if(abstractNamespace)
+        return socklen_t(offsetof(sockaddr_un, sun_path) + 1 + len);
+    return socklen_t(sizeof(addr));
+};
+
+void UnixSocket::Open(const char* path, bool abstractNamespace) throw(sckt::Exc){
+    if(this->IsValid())
+        throw sckt::Exc("UnixSocket::Open(): socket already opened");
+    
+    sockaddr_un addr;
+    socklen_t addrLen = MakeUnixAddress(addr, path, abstractNamespace);
+    
+    M_SCKT_STATS( this->counters.Reset(); )
+    
+    CastToSocket(this->socket) = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(CastToSocket(this->socket) == M_INVALID_SOCKET)
+        throw sckt::Exc("UnixSocket::Open(): Couldn't create socket");
+    
+    M_SCKT_STATS( u64 connectStartTime = GetTimeMicros(); )
+    M_SCKT_STATS( CountIO(this->counters, &IOCounters::connectCalls, 1); )
+    if( connect(CastToSocket(this->socket), reinterpret_cast<sockaddr*>(&addr), addrLen) == M_SOCKET_ERROR ){
+        this->Close();
+        throw sckt::Exc("UnixSocket::Open(): Couldn't connect to the socket");
+    }
+    M_SCKT_STATS( LocalStats().connectLatency.Record(GetTimeMicros() - connectStartTime); )
+    
+    this->isReady = false;
+};
+
+sckt::uint UnixSocket::Send(const sckt::byte* data, uint size) throw(sckt::Exc){
+    return this->SendStream(data, size);
+};
+
+sckt::uint UnixSocket::Recv(sckt::byte* buf, uint maxSize) throw(sckt::Exc){
+    return this->RecvStream(buf, maxSize);
+};
+
+void UnixServerSocket::Open(const char* path, bool abstractNamespace) throw(sckt::Exc){
+    if(this->IsValid())
+        throw sckt::Exc("UnixServerSocket::Open(): socket already opened");
+    
+    sockaddr_un addr;
+    socklen_t addrLen = MakeUnixAddress(addr, path, abstractNamespace);
+    
+    M_SCKT_STATS( this->counters.Reset(); )
+    
+    CastToSocket(this->socket) = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(CastToSocket(this->socket) == M_INVALID_SOCKET)
+        throw sckt::Exc("UnixServerSocket::Open(): Couldn't create socket");
+    
+    if( bind(CastToSocket(this->socket), reinterpret_cast<sockaddr*>(&addr), addrLen) == M_SOCKET_ERROR ){
+        this->Close();
+        throw sckt::Exc("UnixServerSocket::Open(): Couldn't bind to the socket path");
+    }
+    
+    if( listen(CastToSocket(this->socket), SOMAXCONN) == M_SOCKET_ERROR ){
+        this->Close();
+        throw sckt::Exc("UnixServerSocket::Open(): Couldn't listen on the socket");
+    }
+    
+    //Set the socket to non-blocking mode for accept()
+    fcntl(CastToSocket(this->socket), F_SETFL, O_NONBLOCK);
+};
+
+UnixSocket UnixServerSocket::Accept() throw(sckt::Exc){
+    if(!this->IsValid())
+        throw sckt::Exc("UnixServerSocket::Accept(): the socket is not opened");
+    
+    this->isReady = false;
+    
+    UnixSocket sock;//allocate a new socket object
+    
+    M_SCKT_STATS( CountIO(this->counters, &IOCounters::acceptCalls, 1); )
+    CastToSocket(sock.socket) = accept(CastToSocket(this->socket), 0, 0);
+    
+    if(CastToSocket(sock.socket) == M_INVALID_SOCKET)
+        return sock;//no connections to be accepted, return invalid socket
+    
+    //set blocking mode
+    int flags = fcntl(CastToSocket(sock.socket), F_GETFL, 0);
+    fcntl(CastToSocket(sock.socket), F_SETFL, flags & ~O_NONBLOCK);
+    
+    return sock;//return a newly created socket
+};
+
+#endif//~__WIN32__
+
 void UDPSocket::Open(u16 port) throw(sckt::Exc){
     if(this->IsValid())
         throw sckt::Exc("UDPSocket::Open(): the socket is already opened");
     
+    M_SCKT_STATS( this->counters.Reset(); )
+    
     CastToSocket(this->socket) = ::socket(AF_INET, SOCK_DGRAM, 0);
     if(CastToSocket(this->socket) == M_INVALID_SOCKET)
 	throw sckt::Exc("UDPSocket::Open(): ::socket() failed");
@@ -498,10 +903,13 @@ sckt::uint UDPSocket::Send(const sckt::byte* buf, u16 size, IPAddress destinatio
     sockAddr.sin_port = htons(destinationIP.port);
     sockAddr.sin_family = AF_INET;
     int res = sendto(CastToSocket(this->socket), reinterpret_cast<const char*>(buf), size, 0, reinterpret_cast<struct sockaddr*>(&sockAddr), sockLen);
+    M_SCKT_STATS( CountIO(this->counters, &IOCounters::sendCalls, 1); )
     
     if(res == M_SOCKET_ERROR)
         throw sckt::Exc("UDPSocket::Send(): sendto() failed");
     
+    M_SCKT_STATS( CountIO(this->counters, &IOCounters::bytesSent, u64(res)); )
+    
     return res;
 };
 
@@ -515,15 +923,151 @@ sckt::uint UDPSocket::Recv(sckt::byte* buf, u16 maxSize, IPAddress &out_SenderIP
 #endif
     
     int res = recvfrom(CastToSocket(this->socket), reinterpret_cast<char*>(buf), maxSize, 0, reinterpret_cast<sockaddr*>(&sockAddr), &sockLen);
+    M_SCKT_STATS( CountIO(this->counters, &IOCounters::recvCalls, 1); )
     
     if(res == M_SOCKET_ERROR)
         throw sckt::Exc("UDPSocket::Recv(): recvfrom() failed");
     
+    M_SCKT_STATS( CountIO(this->counters, &IOCounters::bytesReceived, u64(res)); )
+    
     out_SenderIP.host = ntohl(sockAddr.sin_addr.s_addr);
     out_SenderIP.port = ntohs(sockAddr.sin_port);
     return res;
 };
 
+//granularity of slab sizes, cache line size
+#define M_SLAB_ALIGNMENT 64
+
+#ifndef __WIN32__
+#define M_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#endif
+
+struct BufferPool::Chunk{
+    void *memory;
+    size_t size;
+    Chunk *next;
+};
+
+BufferPool::BufferPool(uint slabSize, uint slabsPerChunk) throw(sckt::Exc) :
+        chunks(0),
+        freeSlabs(0),
+        freshSlabs(0),
+        numFreshSlabs(0),
+        numSlabs(0),
+        numFreeSlabs(0),
+        hugePages(false)
+{
+    if(slabSize == 0 || slabsPerChunk == 0)
+        throw sckt::Exc("BufferPool::BufferPool(): slab size and number of slabs per chunk must be greater than 0");
+    
+    this->slabSize = (slabSize + M_SLAB_ALIGNMENT - 1) / M_SLAB_ALIGNMENT * M_SLAB_ALIGNMENT;
+    this->slabsPerChunk = slabsPerChunk;
+};
+
+BufferPool::~BufferPool(){
+    //all buffers should be returned at this point
+    while(this->chunks){
+        Chunk *c = this->chunks;
+        this->chunks = c->next;
+#ifdef __WIN32__
+        VirtualFree(c->memory, 0, MEM_RELEASE);
+#else //assume linux/unix
+        munmap(c->memory, c->size);
+#endif
+        delete c;
+    }
+};
+
+void BufferPool::AllocateChunk() throw(sckt::Exc){
+    size_t size = size_t(this->slabSize) * size_t(this->slabsPerChunk);
+    
+    Chunk *c = new(std::nothrow) Chunk();
+    if(!c)
+        throw sckt::Exc("BufferPool::AllocateChunk(): out of memory");
+    
+#ifdef __WIN32__
+    void *mem = VirtualAlloc(0, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if(!mem){
+        delete c;
+        throw sckt::Exc("BufferPool::AllocateChunk(): VirtualAlloc() failed");
+    }
+#else //assume linux/unix
+    void *mem = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    //try huge pages first, this will fail if there are no huge pages reserved in the system
+    if(size % M_HUGE_PAGE_SIZE == 0){
+        mem = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(mem != MAP_FAILED)
+            this->hugePages = true;
+    }
+#endif
+    if(mem == MAP_FAILED){
+        mem = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(mem == MAP_FAILED){
+            delete c;
+            throw sckt::Exc("BufferPool::AllocateChunk(): mmap() failed");
+        }
+#ifdef MADV_HUGEPAGE
+        //let the kernel use transparent huge pages if possible
+        if(size % M_HUGE_PAGE_SIZE == 0)
+            madvise(mem, size, MADV_HUGEPAGE);
+#endif
+    }
+#endif
+    
+    c->memory = mem;
+    c->size = size;
+    c->next = this->chunks;
+    this->chunks = c;
+    
+    //The slabs are handed out in the order of addresses by advancing a pointer, nothing is written
+    //to them here, so the pages of a slab are not touched until the slab is used for the first time.
+    this->freshSlabs = reinterpret_cast<byte*>(mem);
+    this->numFreshSlabs = this->slabsPerChunk;
+    
+    this->numSlabs += this->slabsPerChunk;
+    this->numFreeSlabs += this->slabsPerChunk;
+};
+
+BufferPool::Buffer BufferPool::Borrow() throw(sckt::Exc){
+    //reuse returned slabs first, their pages are already resident
+    if(!this->freeSlabs){
+        if(this->numFreshSlabs == 0)
+            this->AllocateChunk();
+        
+        byte *slab = this->freshSlabs;
+        this->freshSlabs += this->slabSize;
+        --this->numFreshSlabs;
+        --this->numFreeSlabs;
+        return Buffer(this, slab);
+    }
+    
+    FreeSlab *fs = this->freeSlabs;
+    this->freeSlabs = fs->next;
+    --this->numFreeSlabs;
+    return Buffer(this, reinterpret_cast<byte*>(fs));
+};
+
+void BufferPool::Buffer::Release(){
+    if(!this->data)
+        return;
+    this->pool->Return(this->data);
+    this->data = 0;
+    this->size = 0;
+};
+
+BufferPool::Buffer& BufferPool::Buffer::operator=(const Buffer& b){
+    if(this == &b)
+        return *this;
+    this->Release();
+    this->pool = b.pool;
+    this->data = b.data;
+    this->size = b.size;
+    const_cast<Buffer&>(b).data = 0;//same as std::auto_ptr
+    const_cast<Buffer&>(b).size = 0;
+    return *this;
+};
+
 SocketSet::SocketSet(uint maxNumSocks) throw(sckt::Exc, std::bad_alloc):
         maxSockets(maxNumSocks),
         numSockets(0)
@@ -574,12 +1118,20 @@ bool SocketSet::CheckSockets(uint timeoutMillis){
     
     T_Socket maxfd = 0;
     
-    //Find the largest file descriptor
+    //Find the largest file descriptor.
+    //Also count sockets which have some data buffered in user space, select() does not know about such data.
+    uint numBuffered = 0;
     for(uint i = 0; i<this->numSockets; ++i){
         if(CastToSocket(this->set[i]->socket) > maxfd)
             maxfd = CastToSocket(this->set[i]->socket);
+        if(this->set[i]->HasBufferedData())
+            ++numBuffered;
     }
     
+    //do not wait if there is some data to read already
+    if(numBuffered > 0)
+        timeoutMillis = 0;
+    
     int retval;
     fd_set readMask;
     
@@ -600,32 +1152,375 @@ bool SocketSet::CheckSockets(uint timeoutMillis){
         tv.tv_usec = (timeoutMillis%1000)*1000;
         
         retval = select(maxfd+1, &readMask, NULL, NULL, &tv);
+        M_SCKT_STATS( AddRelaxed(&LocalStats().counters.selectCalls, 1); )
         if(retval == M_SOCKET_ERROR){
 #ifdef __WIN32__
             errorCode = WSAGetLastError();
 #else
             errorCode = errno;
 #endif
+            M_SCKT_STATS( if(errorCode == M_EINTR) AddRelaxed(&LocalStats().counters.eintrRetries, 1); )
         }
     }while(errorCode == M_EINTR);
     
-    // Mark all file descriptors ready that have data available
-    if(retval != 0 && retval != M_SOCKET_ERROR){
-        int numSocketsReady = 0;
-        for(uint i=0; i<this->numSockets; ++i){
-            T_Socket socketHnd = CastToSocket(this->set[i]->socket);
-            if( (FD_ISSET(socketHnd, &readMask)) ){
-                this->set[i]->isReady = true;
-                ++numSocketsReady;
-            }
+    // Mark all file descriptors ready that have data available,
+    // sockets with buffered data are ready regardless of what select() says.
+    bool selected = (retval != 0 && retval != M_SOCKET_ERROR);
+    int numSocketsReady = 0;
+    for(uint i=0; i<this->numSockets; ++i){
+        T_Socket socketHnd = CastToSocket(this->set[i]->socket);
+        if( (selected && FD_ISSET(socketHnd, &readMask)) || (numBuffered > 0 && this->set[i]->HasBufferedData()) ){
+            this->set[i]->isReady = true;
+            ++numSocketsReady;
+        }
+    }
+    
+    //on Win32 when compiling with mingw there are some strange things,
+    //sometimes retval is not zero but there is no any sockets marked as ready in readMask.
+    //I do not know why this happens on win32 and mingw. The workaround is to calculate number
+    //of active sockets mnually, ignoring the retval value.
+    return numSocketsReady > 0;
+};
+
+#ifdef M_SCKT_WITH_TLS
+
+//Sessions are cached per "serverName:port" key.
+//The SSL object of the connection being established holds a pointer to its key as application data,
+//so that the new session callback knows where to put the session.
+//The cache is shared by sockets which can be used from different threads (e.g. by different reactors of
+//the same pool), and with TLS 1.3 the new sessions arrive from whichever thread reads the socket,
+//so all accesses to the map are done under the mutex.
+struct TLSContext::SessionCache{
+    typedef std::map<std::string, SSL_SESSION*> T_SessionMap;
+    T_SessionMap map;
+    
+#ifdef __WIN32__
+    CRITICAL_SECTION mutex;
+#else
+    pthread_mutex_t mutex;
+#endif
+    
+    //locks the mutex for the lifetime of the object
+    class Guard{
+        SessionCache& c;
+    public:
+        Guard(SessionCache& c) :
+                c(c)
+        {
+#ifdef __WIN32__
+            EnterCriticalSection(&this->c.mutex);
+#else
+            pthread_mutex_lock(&this->c.mutex);
+#endif
+        };
+        
+        ~Guard(){
+#ifdef __WIN32__
+            LeaveCriticalSection(&this->c.mutex);
+#else
+            pthread_mutex_unlock(&this->c.mutex);
+#endif
+        };
+    };
+    
+    SessionCache()throw(sckt::Exc){
+#ifdef __WIN32__
+        InitializeCriticalSection(&this->mutex);
+#else
+        if(pthread_mutex_init(&this->mutex, 0) != 0)
+            throw sckt::Exc("TLSContext::SessionCache::SessionCache(): pthread_mutex_init() failed");
+#endif
+    };
+    
+    ~SessionCache(){
+        this->Clear();
+#ifdef __WIN32__
+        DeleteCriticalSection(&this->mutex);
+#else
+        pthread_mutex_destroy(&this->mutex);
+#endif
+    };
+    
+    void Clear(){
+        Guard guard(*this);
+        for(T_SessionMap::iterator i = this->map.begin(); i != this->map.end(); ++i)
+            SSL_SESSION_free(i->second);
+        this->map.clear();
+    };
+    
+    uint Size(){
+        Guard guard(*this);
+        return uint(this->map.size());
+    };
+    
+    //Sets the cached session, if any, to the connection to be established.
+    //It is done under the mutex, because other thread could free the session by replacing it.
+    //SSL_set_session() takes its own reference to the session.
+    //Returns true if there was a cached session.
+    bool Resume(const std::string& key, SSL* ssl){
+        Guard guard(*this);
+        T_SessionMap::iterator i = this->map.find(key);
+        if(i == this->map.end())
+            return false;
+        SSL_set_session(ssl, i->second);
+        return true;
+    };
+    
+    //takes ownership of the session
+    void Put(const std::string& key, SSL_SESSION* session){
+        Guard guard(*this);
+        std::pair<T_SessionMap::iterator, bool> res = this->map.insert(std::make_pair(key, session));
+        if(!res.second){
+            SSL_SESSION_free(res.first->second);
+            res.first->second = session;
+        }
+    };
+    
+    void Remove(const std::string& key){
+        Guard guard(*this);
+        T_SessionMap::iterator i = this->map.find(key);
+        if(i == this->map.end())
+            return;
+        SSL_SESSION_free(i->second);
+        this->map.erase(i);
+    };
+};
+
+//Called by OpenSSL when the server issues a new session (or session ticket).
+//With TLS 1.3 the tickets arrive after the handshake, so the callback is the only reliable way to get them.
+int TLSContext::NewSessionCallback(SSL* ssl, SSL_SESSION* session){
+    TLSContext::SessionCache* cache = reinterpret_cast<TLSContext::SessionCache*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+    std::string* key = reinterpret_cast<std::string*>(SSL_get_app_data(ssl));
+    if(!cache || !key)
+        return 0;//we did not take the session
+    
+    if(!SSL_SESSION_is_resumable(session))
+        return 0;
+    
+    cache->Put(*key, session);
+    return 1;//we took ownership of the session
+};
+
+TLSContext::TLSContext(bool verifyPeer) throw(sckt::Exc) :
+        sessions(new SessionCache()),//allocate it first, so that nothing is leaked if it throws
+        verifyPeer(verifyPeer)
+{
+    this->ctx = SSL_CTX_new(TLS_client_method());
+    if(!this->ctx){
+        delete this->sessions;
+        throw sckt::Exc("TLSContext::TLSContext(): SSL_CTX_new() failed");
+    }
+    
+    //peer closing the TCP connection without sending close notification is treated as ordinary disconnection
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+    SSL_CTX_set_options(this->ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+    SSL_CTX_set_mode(this->ctx, SSL_MODE_AUTO_RETRY);
+    
+    if(verifyPeer){
+        SSL_CTX_set_verify(this->ctx, SSL_VERIFY_PEER, 0);
+        if(SSL_CTX_set_default_verify_paths(this->ctx) != 1){
+            SSL_CTX_free(this->ctx);
+            delete this->sessions;
+            throw sckt::Exc("TLSContext::TLSContext(): could not load default trusted certificates");
         }
+    }else{
+        SSL_CTX_set_verify(this->ctx, SSL_VERIFY_NONE, 0);
+    }
+    
+    //Client side caching, sessions are stored in our own cache only, not in OpenSSL internal one,
+    //because OpenSSL does not look up client sessions by itself.
+    SSL_CTX_set_session_cache_mode(this->ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(this->ctx, &TLSContext::NewSessionCallback);
+    SSL_CTX_set_app_data(this->ctx, this->sessions);
+};
+
+TLSContext::~TLSContext(){
+    SSL_CTX_free(this->ctx);
+    delete this->sessions;
+};
+
+void TLSContext::LoadVerifyLocations(const char* caFile) throw(sckt::Exc){
+    if(!caFile)
+        throw sckt::Exc("TLSContext::LoadVerifyLocations(): pointer passed as argument is 0");
+    
+    if(SSL_CTX_load_verify_locations(this->ctx, caFile, 0) != 1)
+        throw sckt::Exc("TLSContext::LoadVerifyLocations(): could not load certificates");
+};
+
+sckt::uint TLSContext::NumCachedSessions()const{
+    return this->sessions->Size();
+};
+
+void TLSContext::ClearSessionCache(){
+    this->sessions->Clear();
+};
+
+TLSSocket& TLSSocket::operator=(const TLSSocket& s){
+    if(this == &s)
+        return *this;
+    
+    this->Close();
+    
+    //Do not use Socket::operator=() here, it calls destructor and thus
+    //resets the virtual table pointer of this object.
+    TLSSocket& src = const_cast<TLSSocket&>(s);
+    CastToSocket(this->socket) = CastToSocket(src.socket);
+    this->isReady = src.isReady;
+    this->ssl = src.ssl;
+#ifdef M_SCKT_WITH_STATS
+    this->counters = src.counters;
+    this->requestStartTime = src.requestStartTime;
+    this->lastRecvTime = src.lastRecvTime;
+    this->firstByteReceived = src.firstByteReceived;
+    src.requestStartTime = 0;
+#endif
+    
+    //same as std::auto_ptr
+    CastToSocket(src.socket) = M_INVALID_SOCKET;
+    src.isReady = false;
+    src.ssl = 0;
+    return *this;
+};
+
+void TLSSocket::Open(TLSContext& context, const IPAddress& ip, const char* serverName, bool disableNaggle) throw(sckt::Exc){
+    if(!serverName)
+        throw sckt::Exc("TLSSocket::Open(): pointer passed as argument is 0");
+    
+    if(this->IsValid())
+        throw sckt::Exc("TLSSocket::Open(): socket already opened");
+    
+    this->TCPSocket::Open(ip, disableNaggle);
+    
+    this->ssl = SSL_new(context.ctx);
+    if(!this->ssl){
+        this->Close();
+        throw sckt::Exc("TLSSocket::Open(): SSL_new() failed");
+    }
+    
+    if(SSL_set_fd(this->ssl, int(CastToSocket(this->socket))) != 1){
+        this->Close();
+        throw sckt::Exc("TLSSocket::Open(): SSL_set_fd() failed");
+    }
+    
+    //SNI
+    SSL_set_tlsext_host_name(this->ssl, serverName);
+    
+    if(context.verifyPeer){
+        SSL_set_hostflags(this->ssl, X509_CHECK_FLAG_NO_PARTIAL_WILDCARDS);
+        if(SSL_set1_host(this->ssl, serverName) != 1){
+            this->Close();
+            throw sckt::Exc("TLSSocket::Open(): SSL_set1_host() failed");
+        }
+    }
+    
+    //session cache key
+    std::string* key = new std::string(serverName);
+    {
+        char port[8];
+        sprintf(port, ":%u", uint(ip.port));
+        key->append(port);
+    }
+    SSL_set_app_data(this->ssl, key);
+    
+    bool cached = context.sessions->Resume(*key, this->ssl);
+    
+    int res;
+    do{
+        res = SSL_connect(this->ssl);
+    }while(res != 1 && SSL_get_error(this->ssl, res) == SSL_ERROR_SYSCALL && errno == M_EINTR);
+    
+    if(res != 1){
+        //the cached session could be the reason of failure, do not try it again
+        if(cached)
+            context.sessions->Remove(*key);
+        this->Close();
+        throw sckt::Exc("TLSSocket::Open(): TLS handshake failed");
+    }
+};
+
+bool TLSSocket::IsSessionReused()const{
+    if(!this->ssl)
+        return false;
+    return SSL_session_reused(this->ssl) == 1;
+};
+
+bool TLSSocket::HasBufferedData()const{
+    if(!this->ssl)
+        return false;
+    return SSL_pending(this->ssl) > 0;
+};
+
+sckt::uint TLSSocket::Send(const sckt::byte* data, uint size) throw(sckt::Exc){
+    if(!this->ssl)
+        throw sckt::Exc("TLSSocket::Send(): socket is not opened");
+    
+    if(size == 0)
+        return 0;
+    
+    M_SCKT_STATS( this->StatsOnSend(); )
+    
+    int res;
+    int errorCode;
+    do{
+        res = SSL_write(this->ssl, data, int(size));
+        M_SCKT_STATS( CountIO(this->counters, &IOCounters::sendCalls, 1); )
+        errorCode = res > 0 ? SSL_ERROR_NONE : SSL_get_error(this->ssl, res);
+    }while( errorCode == SSL_ERROR_WANT_WRITE || errorCode == SSL_ERROR_WANT_READ
+            || (errorCode == SSL_ERROR_SYSCALL && errno == M_EINTR) );
+    
+    if(res <= 0)
+        throw sckt::Exc("TLSSocket::Send(): SSL_write() failed");
+    
+    M_SCKT_STATS( CountIO(this->counters, &IOCounters::bytesSent, u64(res)); )
+    
+    return uint(res);
+};
+
+sckt::uint TLSSocket::Recv(sckt::byte* buf, uint maxSize) throw(sckt::Exc){
+    //this flag shall be cleared even if this function fails to avoid subsequent
+    //calls to Recv() because it indicates that there's activity.
+    //So, do it at the beginning of the function.
+    this->isReady = false;
+    
+    if(!this->ssl)
+        throw sckt::Exc("TLSSocket::Recv(): socket is not opened");
+    
+    int res;
+    int errorCode;
+    do{
+        res = SSL_read(this->ssl, buf, int(maxSize));
+        M_SCKT_STATS( CountIO(this->counters, &IOCounters::recvCalls, 1); )
+        errorCode = res > 0 ? SSL_ERROR_NONE : SSL_get_error(this->ssl, res);
+    }while( errorCode == SSL_ERROR_WANT_READ || errorCode == SSL_ERROR_WANT_WRITE
+            || (errorCode == SSL_ERROR_SYSCALL && errno == M_EINTR) );
+    
+    if(res > 0){
+        M_SCKT_STATS( CountIO(this->counters, &IOCounters::bytesReceived, u64(res)); )
+        M_SCKT_STATS( this->StatsOnRecv(uint(res)); )
+        return uint(res);
+    }
+    
+    //graceful close with close notification or the TCP connection was closed
+    if(errorCode == SSL_ERROR_ZERO_RETURN || (errorCode == SSL_ERROR_SYSCALL && res == 0)){
+        M_SCKT_STATS( this->StatsOnRecv(0); )
+        return 0;
+    }
+    
+    throw sckt::Exc("TLSSocket::Recv(): SSL_read() failed");
+};
+
+void TLSSocket::Close(){
+    if(this->ssl){
+        //send close notification, do not wait for the peer's one
+        if(SSL_is_init_finished(this->ssl))
+            SSL_shutdown(this->ssl);
         
-        //on Win32 when compiling with mingw there are some strange things,
-        //sometimes retval is not zero but there is no any sockets marked as ready in readMask.
-        //I do not know why this happens on win32 and mingw. The workaround is to calculate number
-        //of active sockets mnually, ignoring the retval value.
-        if(numSocketsReady > 0)
-            return true;
+        delete reinterpret_cast<std::string*>(SSL_get_app_data(this->ssl));
+        SSL_free(this->ssl);
+        this->ssl = 0;
     }
-    return false;
+    this->Socket::Close();
 };
+
+#endif//~M_SCKT_WITH_TLS
@@ -51,6 +51,13 @@ This is the main header file of sckt. You need to include it to use sckt library
 #include <exception>
 #include <new>
 
+#ifdef M_SCKT_WITH_TLS
+//OpenSSL types, forward declared so that sckt.h does not depend on OpenSSL headers.
+struct ssl_st;
+struct ssl_ctx_st;
+struct ssl_session_st;
+#endif
+
 /**
 @brief the main namespace of sckt library.
 All the declarations of sckt library are made inside this namespace.
@@ -87,6 +94,7 @@ M_SCKT_STATIC_ASSERT( sizeof(byte)==1 )
 
 //forward declarations
 class SocketSet;
+class Reactor;
 class IPAddress;
 
 /**
@@ -119,6 +127,189 @@ private:
     };
 };
 
+#ifdef M_SCKT_WITH_STATS
+/**
+@brief Latency histogram.
+Log-linear histogram in the spirit of HdrHistogram. Values (microseconds) are grouped by
+their magnitude (power of 2) and each magnitude is split into sckt::Histogram::SUB_BUCKET_COUNT
+linear sub-buckets, so the relative error of any recorded value is below 1/SUB_BUCKET_COUNT.
+Values which do not fit into the histogram are recorded into the last bucket.
+The histogram has fixed size and never allocates memory, recording is a few arithmetic operations.
+*/
+class M_DECLSPEC Histogram{
+public:
+    enum{
+        SUB_BUCKET_BITS = 4,
+        SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS,
+        MAX_MAGNITUDE = 40,///< values up to 2^40 microseconds (about 12 days) are tracked precisely
+        NUM_BUCKETS = (MAX_MAGNITUDE - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT
+    };
+    
+private:
+    u64 counts[NUM_BUCKETS];
+    u64 totalCount;
+    u64 sum;
+    u64 max;
+    
+public:
+    Histogram(){
+        this->Reset();
+    };
+    
+    /**
+    @brief Clears all recorded values.
+    */
+    void Reset();
+    
+    /**
+    @brief Records a value.
+    @param value - value to record, normally latency in microseconds.
+    */
+    void Record(u64 value);
+    
+    /**
+    @brief Adds all values recorded in other histogram to this one.
+    @param h - histogram to add.
+    @return reference to this histogram.
+    */
+    Histogram& operator+=(const Histogram& h);
+    
+    /**
+    @brief Returns the number of recorded values.
+    */
+    u64 TotalCount()const{
+        return this->totalCount;
+    };
+    
+    /**
+    @brief Returns the exact maximal recorded value.
+    */
+    u64 Max()const{
+        return this->max;
+    };
+    
+    /**
+    @brief Returns the exact mean of the recorded values.
+    @return mean value, or 0 if there are no recorded values.
+    */
+    u64 Mean()const{
+        return this->totalCount == 0 ? 0 : this->sum / this->totalCount;
+    };
+    
+    /**
+    @brief Returns the value at given percentile.
+    @param percentile - percentile, from 0 to 100.
+    @return the highest value equivalent (within histogram precision) to the value at given percentile,
+        or 0 if there are no recorded values.
+    */
+    u64 ValueAtPercentile(double percentile)const;
+    
+    /**
+    @brief Returns the number of values recorded in the bucket.
+    @param index - bucket index, must be less than sckt::Histogram::NUM_BUCKETS.
+    */
+    u64 CountAt(uint index)const{
+        return this->counts[index];
+    };
+    
+    /**
+    @brief Returns the highest value which goes to the bucket.
+    @param index - bucket index, must be less than sckt::Histogram::NUM_BUCKETS.
+    */
+    static u64 BucketHighestValue(uint index);
+    
+    /**
+    @brief Returns the index of the bucket the value goes to.
+    */
+    static uint BucketIndex(u64 value){
+        if(value < u64(SUB_BUCKET_COUNT))
+            return uint(value);
+        
+        //find the magnitude, i.e. the index of the most significant bit
+        uint magnitude = SUB_BUCKET_BITS;
+        while((value >> (magnitude + 1)) != 0){
+            ++magnitude;
+            if(magnitude == MAX_MAGNITUDE)
+                return NUM_BUCKETS - 1;
+        }
+        
+        return (magnitude - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT
+                + uint(value >> (magnitude - SUB_BUCKET_BITS)) - SUB_BUCKET_COUNT;
+    };
+};
+
+/**
+@brief Socket I/O counters.
+*/
+struct M_DECLSPEC IOCounters{
+    u64 bytesSent;///< number of bytes sent
+    u64 bytesReceived;///< number of bytes received
+    u64 sendCalls;///< number of send system calls (or TLS writes)
+    u64 recvCalls;///< number of receive system calls (or TLS reads)
+    u64 connectCalls;///< number of connect system calls
+    u64 acceptCalls;///< number of accept system calls, including ones which did not accept a connection
+    u64 selectCalls;///< number of select system calls
+    u64 eintrRetries;///< number of system calls retried because they were interrupted by a signal
+    u64 partialWrites;///< number of send system calls which did not send all the data passed to it
+    
+    IOCounters(){
+        this->Reset();
+    };
+    
+    /**
+    @brief Sets all the counters to 0.
+    */
+    void Reset();
+    
+    /**
+    @brief Adds other counters to this ones.
+    */
+    IOCounters& operator+=(const IOCounters& c);
+};
+
+/**
+@brief Global I/O statistics.
+Statistics is collected per thread, every thread updates its own block of counters without any locking
+or atomic read-modify-write operations (the counters are only loaded and stored atomically, which are plain
+moves on common platforms). When statistics is scraped with sckt::Stats::Scrape() the blocks of all threads
+(including finished ones) are summed up. Since the threads keep updating their counters while they are
+being scraped, the scraped values may be slightly behind the real ones.
+
+Latencies are recorded in microseconds:
+    - connectLatency - time taken by connect() system call.
+    - firstByteLatency - time from the first sending of a request to the first received byte of the response.
+    - responseLatency - time from the first sending of a request to the last received byte of the response.
+The request/response exchange is tracked per sckt::TCPSocket: the first Send() after the response
+has been received (or after the socket was opened) starts a new request, the response is considered
+complete when next request is started, the remote socket disconnects or the socket is closed.
+
+Statistics is compiled in only if M_SCKT_WITH_STATS macro is defined.
+*/
+struct M_DECLSPEC Stats{
+    IOCounters counters;
+    Histogram connectLatency;
+    Histogram firstByteLatency;
+    Histogram responseLatency;
+    
+    /**
+    @brief Clears all counters and histograms of this object.
+    */
+    void Reset();
+    
+    /**
+    @brief Adds other statistics to this one.
+    */
+    Stats& operator+=(const Stats& s);
+    
+    /**
+    @brief Collects global statistics.
+    Sums up the statistics of all threads.
+    @param out_Stats - object to store the result to, its previous contents are discarded.
+    */
+    static void Scrape(Stats& out_Stats);
+};
+#endif//~M_SCKT_WITH_STATS
+
 /**
 @brief a structure which holds IP address
 */
@@ -220,12 +411,198 @@ private:
     static void DeinitSockets();
 };
 
+/**
+@brief Pool of fixed size receive buffers.
+Instead of keeping a receive buffer per connection, sockets can borrow a buffer (slab) from the pool
+at the moment when there is data to read, see sckt::TCPSocket::Recv(BufferPool&), and return it
+to the pool as soon as the received data is processed. Thus, idle connections do not hold any buffer memory.
+Slabs are allocated in chunks, each chunk is a single memory mapping which is backed by huge pages
+if the system allows it (in that case the chunk size should be a multiple of the huge page size,
+which is the case for the default parameters). Memory of the chunks is only freed when the pool is destroyed.
+Note, that the pool is not thread safe, use separate pool for each thread.
+*/
+class M_DECLSPEC BufferPool{
+public:
+    /**
+    @brief Buffer borrowed from the pool.
+    The buffer returns its memory to the pool when it is destroyed or released.
+    The buffer objects have the std::auto_ptr like copying semantics.
+    The pool must not be destroyed before all its buffers are returned.
+    */
+    class M_DECLSPEC Buffer{
+        friend class BufferPool;
+        
+        BufferPool *pool;
+        byte *data;
+        uint size;
+        
+        Buffer(BufferPool* pool, byte* data) :
+                pool(pool),
+                data(data),
+                size(0)
+        {};
+    public:
+        /**
+        @brief Creates an invalid buffer which does not refer to any memory.
+        */
+        Buffer() :
+                pool(0),
+                data(0),
+                size(0)
+        {};
+        
+        /**
+        @brief A copy constructor, works similar to std::auto_ptr copy constructor.
+        After the constructor completes b becomes invalid.
+        */
+        Buffer(const Buffer& b) :
+                pool(b.pool),
+                data(b.data),
+                size(b.size)
+        {
+            const_cast<Buffer&>(b).data = 0;
+            const_cast<Buffer&>(b).size = 0;
+        };
+        
+        /**
+        @brief Assignment operator, works similar to std::auto_ptr::operator=().
+        */
+        Buffer& operator=(const Buffer& b);
+        
+        ~Buffer(){
+            this->Release();
+        };
+        
+        /**
+        @brief Returns the memory to the pool, the buffer becomes invalid.
+        */
+        void Release();
+        
+        /**
+        @brief Tells whether the buffer refers to some memory.
+        */
+        bool IsValid()const{
+            return this->data != 0;
+        };
+        
+        /**
+        @brief Returns pointer to the buffer memory.
+        */
+        byte* Data()const{
+            return this->data;
+        };
+        
+        /**
+        @brief Returns the number of bytes of data held by the buffer.
+        */
+        uint Size()const{
+            return this->size;
+        };
+        
+        /**
+        @brief Sets the number of bytes of data held by the buffer.
+        @param size - new size, must not be greater than buffer capacity.
+        */
+        void SetSize(uint size){
+            this->size = size;
+        };
+        
+        /**
+        @brief Returns the size of the buffer memory.
+        */
+        uint Capacity()const{
+            return this->IsValid() ? this->pool->SlabSize() : 0;
+        };
+    };
+    
+private:
+    struct Chunk;
+    Chunk *chunks;//list of allocated chunks
+    
+    //returned slabs, the link to the next one is kept in the first bytes of the slab
+    struct FreeSlab{
+        FreeSlab *next;
+    };
+    FreeSlab *freeSlabs;
+    
+    //slabs of the last allocated chunk which were never borrowed, they are not touched
+    //until then, so that their pages are not faulted in
+    byte *freshSlabs;
+    uint numFreshSlabs;
+    
+    uint slabSize;
+    uint slabsPerChunk;
+    uint numSlabs;
+    uint numFreeSlabs;
+    bool hugePages;
+    
+    void AllocateChunk() throw(sckt::Exc);
+    
+    void Return(byte* slab){
+        FreeSlab *fs = reinterpret_cast<FreeSlab*>(slab);
+        fs->next = this->freeSlabs;
+        this->freeSlabs = fs;
+        ++this->numFreeSlabs;
+    };
+    
+    //not copyable
+    BufferPool(const BufferPool&);
+    BufferPool& operator=(const BufferPool&);
+    
+public:
+    /**
+    @brief Creates a buffer pool.
+    The memory is not allocated until the first buffer is borrowed.
+    @param slabSize - size of one buffer in bytes, it is rounded up to a multiple of 64 bytes.
+    @param slabsPerChunk - number of slabs allocated at once when the pool runs out of free slabs.
+    */
+    BufferPool(uint slabSize = 16384, uint slabsPerChunk = 128) throw(sckt::Exc);
+    
+    ~BufferPool();
+    
+    /**
+    @brief Borrows a buffer from the pool.
+    Allocates a new chunk of slabs if there are no free slabs.
+    @return a valid buffer with the size of 0.
+    */
+    Buffer Borrow() throw(sckt::Exc);
+    
+    /**
+    @brief Returns the size of a single buffer in bytes.
+    */
+    uint SlabSize()const{
+        return this->slabSize;
+    };
+    
+    /**
+    @brief Returns the total number of slabs allocated by the pool.
+    */
+    uint NumSlabs()const{
+        return this->numSlabs;
+    };
+    
+    /**
+    @brief Returns the number of slabs which are not borrowed.
+    */
+    uint NumFreeSlabs()const{
+        return this->numFreeSlabs;
+    };
+    
+    /**
+    @brief Tells whether at least one chunk of memory is backed by huge pages.
+    */
+    bool UsesHugePages()const{
+        return this->hugePages;
+    };
+};
+
 /**
 @brief Basic socket class.
 This is a base class for all socket types such as TCP sockets or UDP sockets.
 */
 class M_DECLSPEC Socket{
     friend class SocketSet;
+    friend class Reactor;
     
 public:
     //this type will hold system specific socket handle.
@@ -242,10 +619,43 @@ protected:
     
     SystemIndependentSocketHandle socket;
     
+#ifdef M_SCKT_WITH_STATS
+    IOCounters counters;
+    
+    //request/response exchange tracking, see sckt::Stats
+    u64 requestStartTime;//0 if there is no request in progress
+    u64 lastRecvTime;
+    bool firstByteReceived;
+    
+    void StatsOnSend();
+    void StatsOnRecv(uint numBytes);
+    void StatsFinishResponse();
+#endif
+    
     Socket();
     
-    Socket& operator=(const Socket& s);
+    //send and receive on stream sockets (TCP and Unix domain)
+    uint SendStream(const byte* data, uint size) throw(sckt::Exc);
+    uint RecvStream(byte* buf, uint maxSize) throw(sckt::Exc);
+    
+    //Receives the data available on a stream socket, RecvToPool() is built on it.
+    //Sockets which do not receive directly from the system socket (e.g. TLS) override it.
+    virtual uint RecvAvailable(byte* buf, uint maxSize) throw(sckt::Exc){
+        return this->RecvStream(buf, maxSize);
+    };
     
+    //see sckt::TCPSocket::Recv(BufferPool&)
+    BufferPool::Buffer RecvToPool(BufferPool& pool) throw(sckt::Exc);
+    
+    Socket& operator=(const Socket& s);
+
+    //Returns true if some data was already read from the system socket and is buffered
+    //in user space (e.g. decrypted TLS records). select() does not see such data,
+    //so sckt::SocketSet checks this separately.
+    virtual bool HasBufferedData()const{
+        return false;
+    };
+
 public:
     virtual ~Socket(){
         this->Close();
@@ -273,7 +683,19 @@ public:
     /**
     @brief Closes the socket disconnecting it if necessary.
     */
-    void Close();
+    virtual void Close();
+    
+#ifdef M_SCKT_WITH_STATS
+    /**
+    @brief Returns I/O counters of the socket.
+    The counters are reset when the socket is opened, so they describe the current connection only.
+    The counters are also added to global statistics, see sckt::Stats.
+    @return reference to the socket's counters.
+    */
+    const IOCounters& Counters()const{
+        return this->counters;
+    };
+#endif
 };
 
 /**
@@ -296,7 +718,8 @@ public:
     */
     //copy constructor
     TCPSocket(const TCPSocket& s){
-        //NOTE: that operator= calls destructor, so this->socket should be invalid, base class constructor takes care about it.
+        //NOTE: operator= closes this socket before taking the other one, this->socket is still invalid here,
+        //base class constructor takes care about it, so nothing is closed.
         this->operator=(s);//same as auto_ptr
     };
     
@@ -337,7 +760,7 @@ public:
     @param size - number of bytes to send.
     @return the number of bytes sent. Note that this value should normally be equal to the size argument value.
     */
-    uint Send(const byte* data, uint size) throw(sckt::Exc);
+    virtual uint Send(const byte* data, uint size) throw(sckt::Exc);
     
     /**
     @brief Receive data from connected socket.
@@ -349,7 +772,22 @@ public:
     @return 0 returned value indicates disconnection of remote socket.
     */
     //returns 0 if connection was closed by peer
-    uint Recv(byte* buf, uint maxSize) throw(sckt::Exc);
+    virtual uint Recv(byte* buf, uint maxSize) throw(sckt::Exc);
+    
+    /**
+    @brief Receive data from connected socket into a buffer borrowed from the pool.
+    Borrows a buffer from the pool and receives the data available on the socket into it.
+    The buffer is borrowed only for the time the data is actually being processed,
+    so call this method when the socket is ready (see sckt::SocketSet), otherwise it blocks holding the buffer.
+    Release the returned buffer (or let it be destroyed) as soon as the data is processed.
+    @param pool - pool to borrow the buffer from.
+    @return buffer holding the received data.
+    @return invalid buffer (with the size of 0) indicates disconnection of remote socket,
+        no pool memory is held in that case.
+    */
+    BufferPool::Buffer Recv(BufferPool& pool) throw(sckt::Exc){
+        return this->RecvToPool(pool);
+    };
     
 private:
     void DisableNaggle() throw(sckt::Exc);
@@ -381,7 +819,8 @@ public:
     TCPServerSocket(const TCPServerSocket& s) :
             disableNaggle(s.disableNaggle)
     {
-        //NOTE: that operator= calls destructor, so this->socket should be invalid, base class constructor takes care about it.
+        //NOTE: operator= closes this socket before taking the other one, this->socket is still invalid here,
+        //base class constructor takes care about it, so nothing is closed.
         this->operator=(s);//same as auto_ptr
     };
     
@@ -429,6 +868,135 @@ public:
     TCPSocket Accept() throw(sckt::Exc);
 };
 
+#ifndef __WIN32__
+/**
+@brief a class which represents a Unix domain stream socket.
+Unix domain sockets connect processes running on the same host without going through the TCP/IP stack.
+The sockets are addressed by file system path or, on Linux, by a name in the abstract namespace
+which does not create any file system objects.
+*/
+class M_DECLSPEC UnixSocket : public Socket{
+    friend class UnixServerSocket;
+public:
+    /**
+    @brief Constructs an invalid Unix domain socket object.
+    */
+    UnixSocket(){};
+    
+    /**
+    @brief A copy constructor.
+    Works similar to std::auto_ptr, see sckt::TCPSocket::TCPSocket(const TCPSocket&).
+    @param s - other Unix domain socket to make a copy from.
+    */
+    UnixSocket(const UnixSocket& s){
+        //NOTE: operator= closes this socket before taking the other one, this->socket is still invalid here,
+        //base class constructor takes care about it, so nothing is closed.
+        this->operator=(s);//same as auto_ptr
+    };
+    
+    /**
+    @brief A constructor which automatically calls sckt::UnixSocket::Open() method.
+    @param path - socket path or name in the abstract namespace.
+    @param abstractNamespace - if true, path is a name in the abstract namespace.
+    */
+    UnixSocket(const char* path, bool abstractNamespace = false) throw(sckt::Exc){
+        this->Open(path, abstractNamespace);
+    };
+    
+    /**
+    @brief Assignment operator, works similar to std::auto_ptr::operator=().
+    @param s - socket to assign from.
+    */
+    UnixSocket& operator=(const UnixSocket& s){
+        this->Socket::operator=(s);
+        return *this;
+    };
+    
+    /**
+    @brief Connects the socket.
+    This method connects the socket to the Unix domain server socket.
+    @param path - socket path or name in the abstract namespace (Linux only).
+    @param abstractNamespace - if true, path is a name in the abstract namespace.
+    */
+    void Open(const char* path, bool abstractNamespace = false) throw(sckt::Exc);
+    
+    /**
+    @brief Send data to connected socket.
+    See sckt::TCPSocket::Send().
+    */
+    uint Send(const byte* data, uint size) throw(sckt::Exc);
+    
+    /**
+    @brief Receive data from connected socket.
+    See sckt::TCPSocket::Recv().
+    */
+    uint Recv(byte* buf, uint maxSize) throw(sckt::Exc);
+    
+    /**
+    @brief Receive data from connected socket into a buffer borrowed from the pool.
+    See sckt::TCPSocket::Recv(BufferPool&).
+    */
+    BufferPool::Buffer Recv(BufferPool& pool) throw(sckt::Exc){
+        return this->RecvToPool(pool);
+    };
+};
+
+/**
+@brief a class which represents a Unix domain server socket.
+Note, that the socket file created by the server socket (unless it is in the abstract namespace)
+is not removed when the socket is closed, remove it before opening the server socket again.
+*/
+class M_DECLSPEC UnixServerSocket : public Socket{
+public:
+    /**
+    @brief Creates an invalid (unopened) Unix domain server socket.
+    */
+    UnixServerSocket(){};
+    
+    /**
+    @brief A copy constructor, works similar to std::auto_ptr.
+    @param s - other server socket to make a copy from.
+    */
+    UnixServerSocket(const UnixServerSocket& s){
+        //NOTE: operator= closes this socket before taking the other one, this->socket is still invalid here,
+        //base class constructor takes care about it, so nothing is closed.
+        this->operator=(s);//same as auto_ptr
+    };
+    
+    /**
+    @brief Assignment operator, works similar to std::auto_ptr::operator=().
+    @param s - socket to assign from.
+    */
+    UnixServerSocket& operator=(const UnixServerSocket& s){
+        this->Socket::operator=(s);
+        return *this;
+    };
+    
+    /**
+    @brief A constructor which automatically calls sckt::UnixServerSocket::Open() method.
+    @param path - socket path or name in the abstract namespace.
+    @param abstractNamespace - if true, path is a name in the abstract namespace.
+    */
+    UnixServerSocket(const char* path, bool abstractNamespace = false) throw(sckt::Exc){
+        this->Open(path, abstractNamespace);
+    };
+    
+    /**
+    @brief Starts listening on the socket.
+    @param path - socket path or name in the abstract namespace (Linux only).
+    @param abstractNamespace - if true, path is a name in the abstract namespace.
+    */
+    void Open(const char* path, bool abstractNamespace = false) throw(sckt::Exc);
+    
+    /**
+    @brief Accepts one of the pending connections, non-blocking.
+    See sckt::TCPServerSocket::Accept().
+    @return sckt::UnixSocket object, invalid if there was no any connections pending.
+    */
+    UnixSocket Accept() throw(sckt::Exc);
+};
+#endif//~__WIN32__
+
 class M_DECLSPEC UDPSocket : public Socket{
 public:
     UDPSocket(){};
@@ -461,6 +1029,187 @@ public:
     uint Recv(byte* buf, u16 maxSize, IPAddress &out_SenderIP) throw(sckt::Exc);
 };
 
+#ifdef M_SCKT_WITH_TLS
+/**
+@brief TLS client context.
+Holds the OpenSSL configuration (trusted certificates, peer verification) shared by TLS sockets
+and the cache of TLS sessions used for session resumption.
+All sckt::TLSSocket objects opened with the same context share its session cache, so a socket
+connecting again to the same server (for example, a socket re-opened by a connection pool)
+resumes the previous session with an abbreviated 1-RTT handshake instead of doing a full one.
+The context must not be destroyed before all the sockets opened with it are closed.
+The session cache is protected by a mutex, so sockets opened with the same context can be
+opened and used from different threads, e.g. by different reactors of a sckt::ReactorPool.
+LoadVerifyLocations() is not thread safe, call it before opening sockets.
+*/
+class M_DECLSPEC TLSContext{
+    friend class TLSSocket;
+
+    ssl_ctx_st *ctx;
+
+    struct SessionCache;
+    SessionCache *sessions;
+
+    //called by OpenSSL when server issues a new session
+    static int NewSessionCallback(ssl_st* ssl, ssl_session_st* session);
+
+    bool verifyPeer;
+
+    //not copyable
+    TLSContext(const TLSContext&);
+    TLSContext& operator=(const TLSContext&);
+public:
+    /**
+    @brief Creates TLS client context.
+    @param verifyPeer - if true, the server certificate chain is verified against the trusted certificates
+        and the server host name passed to sckt::TLSSocket::Open() is checked against the certificate.
+        By default, system default trusted certificates are used, see also LoadVerifyLocations().
+    */
+    TLSContext(bool verifyPeer = true) throw(sckt::Exc);
+
+    ~TLSContext();
+
+    /**
+    @brief Adds trusted certificates.
+    @param caFile - name of the PEM file with trusted CA certificates, for example, a self-signed certificate of a test server.
+    */
+    void LoadVerifyLocations(const char* caFile) throw(sckt::Exc);
+
+    /**
+    @brief Returns number of sessions currently held in the session cache.
+    There is at most one session per server name and port pair.
+    */
+    uint NumCachedSessions()const;
+
+    /**
+    @brief Drops all cached sessions.
+    Subsequently opened sockets will perform a full handshake.
+    */
+    void ClearSessionCache();
+};
+
+/**
+@brief a class which represents a TLS client socket.
+The TLS socket is a TCP socket with a TLS session established on top of it.
+The socket uses the session cache of the sckt::TLSContext it was opened with,
+see sckt::TLSContext for details.
+TLS sockets can be added to sckt::SocketSet just like ordinary TCP sockets, the socket set
+takes into account the data which is already decrypted and buffered by the TLS layer.
+Send(), Recv() and Close() override the ones of sckt::TCPSocket, so a TLS socket can also be
+used through a sckt::TCPSocket or sckt::Socket reference, e.g. by a connection pool.
+*/
+class M_DECLSPEC TLSSocket : public TCPSocket{
+    ssl_st *ssl;
+
+protected:
+    //override
+    bool HasBufferedData()const;
+    
+    //override
+    uint RecvAvailable(byte* buf, uint maxSize) throw(sckt::Exc){
+        return this->Recv(buf, maxSize);
+    };
+
+public:
+    /**
+    @brief Constructs an invalid TLS socket object.
+    */
+    TLSSocket() :
+            ssl(0)
+    {};
+
+    /**
+    @brief A copy constructor.
+    Works similar to sckt::TCPSocket copy constructor, i.e. like std::auto_ptr.
+    After constructor completes the s becomes invalid.
+    @param s - other TLS socket to make a copy from.
+    */
+    TLSSocket(const TLSSocket& s) :
+            TCPSocket(),
+            ssl(0)
+    {
+        this->operator=(s);//same as auto_ptr
+    };
+
+    /**
+    @brief A constructor which automatically calls sckt::TLSSocket::Open() method.
+    @param context - TLS context to use.
+    @param ip - IP address to connect to.
+    @param serverName - server host name, see sckt::TLSSocket::Open().
+    @param disableNaggle - enable/disable Naggle algorithm.
+    */
+    TLSSocket(TLSContext& context, const IPAddress& ip, const char* serverName, bool disableNaggle = false) throw(sckt::Exc) :
+            ssl(0)
+    {
+        this->Open(context, ip, serverName, disableNaggle);
+    };
+
+    ~TLSSocket(){
+        this->Close();
+    };
+
+    /**
+    @brief Assignment operator, works similar to std::auto_ptr::operator=().
+    @param s - socket to assign from.
+    */
+    TLSSocket& operator=(const TLSSocket& s);
+
+    /**
+    @brief Connects the socket and performs TLS handshake.
+    If the session cache of the context holds a session for the same server name and port,
+    the handshake tries to resume that session.
+    @param context - TLS context to use.
+    @param ip - IP address to connect to.
+    @param serverName - server host name, it is sent to the server (SNI), used as a session cache key and,
+        if peer verification is enabled, checked against the server certificate.
+    @param disableNaggle - enable/disable Naggle algorithm.
+    */
+    void Open(TLSContext& context, const IPAddress& ip, const char* serverName, bool disableNaggle = false) throw(sckt::Exc);
+
+    /**
+    @brief Send data to connected socket.
+    Encrypts and sends data. This method blocks until all data is completely sent.
+    @param data - pointer to the buffer with data to send.
+    @param size - number of bytes to send.
+    @return the number of bytes sent.
+    */
+    //override
+    uint Send(const byte* data, uint size) throw(sckt::Exc);
+
+    /**
+    @brief Receive data from connected socket.
+    Receives and decrypts data. If there is no data available this function blocks until some data arrives.
+    @param buf - pointer to the buffer where to put received data.
+    @param maxSize - maximal number of bytes which can be put to the buffer.
+    @return if returned value is not 0 then it represents the number of bytes written to the buffer.
+    @return 0 returned value indicates disconnection of remote socket.
+    */
+    //override
+    uint Recv(byte* buf, uint maxSize) throw(sckt::Exc);
+
+    /**
+    @brief Receive decrypted data into a buffer borrowed from the pool.
+    See sckt::TCPSocket::Recv(BufferPool&).
+    */
+    BufferPool::Buffer Recv(BufferPool& pool) throw(sckt::Exc){
+        return this->RecvToPool(pool);
+    };
+
+    /**
+    @brief Tells whether the TLS session was resumed from the session cache.
+    @return true if the last handshake was an abbreviated one, i.e. the cached session was resumed.
+    */
+    bool IsSessionReused()const;
+
+    /**
+    @brief Closes the socket.
+    Sends TLS close notification if the session was established and closes the TCP connection.
+    */
+    //override
+    void Close();
+};
+#endif//~M_SCKT_WITH_TLS
+
 
 /**
 @brief Socket set class for checking multiple sockets for activity.
@@ -0,0 +1,648 @@
+// Test program for sckt.
+// Returns the number of failed tests.
+
+#include <stdio.h>
+#include <string.h>
+#ifndef __WIN32__
+#include <unistd.h>
+#endif
+
+#include "sckt.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include "reactor.h"
+#endif
+
+using namespace sckt;
+
+static int gPass = 0;
+static int gFail = 0;
+
+static void ScktTest(const char* testString, bool okay){
+    printf("[%s] %s\n", okay ? "pass" : "fail", testString);
+    if(okay)
+        ++gPass;
+    else
+        ++gFail;
+};
+
+static void TestBufferPool(){
+    printf("\n** Buffer pool **\n");
+
+    BufferPool pool(1000, 2);
+    ScktTest("Slab size rounded up.", pool.SlabSize() == 1024);
+    ScktTest("No memory before the first borrow.", pool.NumSlabs() == 0);
+
+    BufferPool::Buffer b1 = pool.Borrow();
+    ScktTest("Borrowed buffer is valid.", b1.IsValid() && b1.Size() == 0 && b1.Capacity() == 1024);
+    ScktTest("First chunk allocated.", pool.NumSlabs() == 2 && pool.NumFreeSlabs() == 1);
+
+    BufferPool::Buffer b2 = pool.Borrow();
+    ScktTest("Slabs borrowed in the order of addresses.", b2.Data() == b1.Data() + 1024);
+    ScktTest("Chunk used up.", pool.NumFreeSlabs() == 0);
+
+    //the whole slab is usable
+    memset(b1.Data(), 1, b1.Capacity());
+    memset(b2.Data(), 2, b2.Capacity());
+    ScktTest("Slabs do not overlap.", b1.Data()[1023] == 1 && b2.Data()[0] == 2);
+
+    BufferPool::Buffer b3 = pool.Borrow();
+    ScktTest("Second chunk allocated.", pool.NumSlabs() == 4 && pool.NumFreeSlabs() == 1);
+
+    byte* returned = b1.Data();
+    b1.Release();
+    ScktTest("Released buffer is invalid.", !b1.IsValid() && b1.Capacity() == 0);
+    ScktTest("Released slab is free.", pool.NumFreeSlabs() == 2);
+
+    BufferPool::Buffer b4 = pool.Borrow();
+    ScktTest("Returned slab borrowed first.", b4.Data() == returned);
+
+    {
+        BufferPool::Buffer copy(b4);
+        ScktTest("Copy takes the buffer.", !b4.IsValid() && copy.Data() == returned);
+    }
+    ScktTest("Destroyed buffer is returned.", pool.NumFreeSlabs() == 2);
+
+    b2 = b3;
+    ScktTest("Assignment returns the old buffer.", pool.NumFreeSlabs() == 3 && !b3.IsValid());
+    b2.Release();
+    ScktTest("All slabs returned.", pool.NumFreeSlabs() == pool.NumSlabs());
+};
+
+#ifndef __WIN32__
+//sends the data and receives it on the other socket, the sockets are blocking
+static bool RoundTrip(UnixSocket& from, UnixSocket& to, const char* data){
+    uint len = uint(strlen(data));
+    if(from.Send(reinterpret_cast<const byte*>(data), len) != len)
+        return false;
+    
+    char buf[64];
+    uint received = 0;
+    while(received < len){
+        uint n = to.Recv(reinterpret_cast<byte*>(buf) + received, sizeof(buf) - 1 - received);
+        if(n == 0)
+            return false;
+        received += n;
+    }
+    buf[received] = 0;
+    return strcmp(buf, data) == 0;
+};
+
+static void TestUnixSocket(){
+    printf("\n** Unix domain sockets **\n");
+    
+    //file system path
+    char path[64];
+    sprintf(path, "/tmp/sckttest-%d.sock", int(getpid()));
+    unlink(path);
+    {
+        UnixServerSocket server(path);
+        UnixSocket noConnection = server.Accept();
+        ScktTest("Accept without pending connection.", !noConnection.IsValid());
+        
+        UnixSocket client(path);
+        UnixSocket accepted = server.Accept();
+        ScktTest("Connection accepted.", client.IsValid() && accepted.IsValid());
+        ScktTest("Client to server.", RoundTrip(client, accepted, "request"));
+        ScktTest("Server to client.", RoundTrip(accepted, client, "response"));
+        
+        //copying passes the socket over, like std::auto_ptr
+        UnixSocket copy(accepted);
+        ScktTest("Copy takes the socket.", !accepted.IsValid() && copy.IsValid());
+        ScktTest("Copy is connected.", RoundTrip(client, copy, "again"));
+        
+        BufferPool pool(256, 4);
+        client.Send(reinterpret_cast<const byte*>("pooled"), 6);
+        BufferPool::Buffer buf = copy.Recv(pool);
+        ScktTest("Received into a pool buffer.", buf.Size() == 6 && memcmp(buf.Data(), "pooled", 6) == 0);
+        buf.Release();
+        
+        client.Close();
+        buf = copy.Recv(pool);
+        ScktTest("Disconnection gives an invalid buffer.", !buf.IsValid() && pool.NumFreeSlabs() == pool.NumSlabs());
+        
+        byte b;
+        ScktTest("Disconnection.", copy.Recv(&b, 1) == 0);
+    }
+    unlink(path);
+    
+#ifdef __linux__
+    //abstract namespace, no file is created
+    {
+        UnixServerSocket server("sckttest-abstract", true);
+        UnixSocket client("sckttest-abstract", true);
+        UnixSocket accepted = server.Accept();
+        ScktTest("Abstract namespace connection.", RoundTrip(client, accepted, "abstract"));
+    }
+#endif
+    
+    bool thrown = false;
+    try{
+        UnixSocket s("/nonexistent/sckttest.sock");
+    }catch(sckt::Exc&){
+        thrown = true;
+    }
+    ScktTest("Connecting to nothing throws.", thrown);
+};
+#endif//~__WIN32__
+
+#ifdef M_SCKT_WITH_STATS
+static void TestHistogram(){
+    printf("\n** Histogram **\n");
+    
+    Histogram h;
+    ScktTest("Empty histogram.", h.TotalCount() == 0 && h.Mean() == 0 && h.ValueAtPercentile(50) == 0);
+    
+    for(u64 v = 1; v <= 1000; ++v)
+        h.Record(v);
+    ScktTest("Count.", h.TotalCount() == 1000);
+    ScktTest("Max.", h.Max() == 1000);
+    ScktTest("Mean.", h.Mean() == 500);
+    
+    //within the precision of the histogram
+    u64 median = h.ValueAtPercentile(50);
+    ScktTest("Median.", median >= 500 && median <= 500 + 500 / Histogram::SUB_BUCKET_COUNT);
+    ScktTest("100th percentile is the max.", h.ValueAtPercentile(100) == 1000);
+    
+    bool bucketsOkay = true;
+    for(u64 v = 0; v < 100000; v = v * 3 / 2 + 1){
+        uint i = Histogram::BucketIndex(v);
+        if(Histogram::BucketHighestValue(i) < v || (i > 0 && Histogram::BucketHighestValue(i - 1) >= v))
+            bucketsOkay = false;
+    }
+    ScktTest("Value falls in its bucket.", bucketsOkay);
+    ScktTest("Huge value goes to the last bucket.", Histogram::BucketIndex(~u64(0)) == Histogram::NUM_BUCKETS - 1);
+    
+    Histogram h2;
+    h2.Record(5000);
+    h2 += h;
+    ScktTest("Sum of histograms.", h2.TotalCount() == 1001 && h2.Max() == 5000);
+};
+
+#ifndef __WIN32__
+static void* StatsThread(void*){
+    //a connection of its own, the thread finishes before the statistics is scraped
+    UnixServerSocket server("sckttest-stats-thread", true);
+    UnixSocket client("sckttest-stats-thread", true);
+    UnixSocket accepted = server.Accept();
+    client.Send(reinterpret_cast<const byte*>("0123456789"), 10);
+    byte buf[10];
+    uint received = 0;
+    while(received < 10)
+        received += accepted.Recv(buf + received, 10 - received);
+    return 0;
+};
+
+static void TestStats(){
+    printf("\n** Statistics **\n");
+    
+    Stats before;
+    Stats::Scrape(before);
+    {
+        UnixServerSocket server("sckttest-stats", true);
+        UnixSocket client("sckttest-stats", true);
+        UnixSocket accepted = server.Accept();
+        
+        RoundTrip(client, accepted, "request");
+        RoundTrip(accepted, client, "the response");
+        
+        ScktTest("Socket bytes sent.", client.Counters().bytesSent == 7);
+        ScktTest("Socket bytes received.", client.Counters().bytesReceived == 12);
+        ScktTest("Socket calls.", client.Counters().sendCalls == 1 && client.Counters().recvCalls >= 1);
+        ScktTest("Socket connect counted.", client.Counters().connectCalls == 1);
+        ScktTest("Server accept counted.", server.Counters().acceptCalls == 1);
+    }
+    Stats after;
+    Stats::Scrape(after);
+    
+    ScktTest("Bytes sent.", after.counters.bytesSent - before.counters.bytesSent == 19);
+    ScktTest("Bytes received.", after.counters.bytesReceived - before.counters.bytesReceived == 19);
+    ScktTest("Connect latency.", after.connectLatency.TotalCount() - before.connectLatency.TotalCount() == 1);
+    
+    //the client's request got its response, the server's "request" did not
+    ScktTest("First byte latency.", after.firstByteLatency.TotalCount() - before.firstByteLatency.TotalCount() == 1);
+    ScktTest("Response latency.", after.responseLatency.TotalCount() - before.responseLatency.TotalCount() == 1);
+    
+#ifdef __linux__
+    pthread_t thread;
+    pthread_create(&thread, 0, &StatsThread, 0);
+    pthread_join(thread, 0);
+    Stats::Scrape(before);
+    ScktTest("Finished thread is counted.", before.counters.bytesSent - after.counters.bytesSent == 10);
+#endif
+};
+#endif//~__WIN32__
+#endif//~M_SCKT_WITH_STATS
+
+#ifdef __linux__
+//set by one thread, waited for by another one
+class Event{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool isSet;
+public:
+    Event() :
+            isSet(false)
+    {
+        pthread_mutex_init(&this->mutex, 0);
+        pthread_cond_init(&this->cond, 0);
+    };
+    
+    ~Event(){
+        pthread_cond_destroy(&this->cond);
+        pthread_mutex_destroy(&this->mutex);
+    };
+    
+    void Set(){
+        pthread_mutex_lock(&this->mutex);
+        this->isSet = true;
+        pthread_cond_broadcast(&this->cond);
+        pthread_mutex_unlock(&this->mutex);
+    };
+    
+    //returns false if the event was not set within 5 seconds, resets the event
+    bool Wait(){
+        timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += 5;
+        pthread_mutex_lock(&this->mutex);
+        while(!this->isSet){
+            if(pthread_cond_timedwait(&this->cond, &this->mutex, &deadline) == ETIMEDOUT)
+                break;
+        }
+        bool res = this->isSet;
+        this->isSet = false;
+        pthread_mutex_unlock(&this->mutex);
+        return res;
+    };
+};
+
+//signals the event when run, after all the tasks submitted before it
+class SyncTask : public Task{
+public:
+    Event done;
+    
+    void Run(Reactor&){
+        this->done.Set();
+    };
+};
+
+//sockets are removed from the reactor thread
+class RemoveTask : public Task{
+    Socket* socket;
+public:
+    Event done;
+    
+    RemoveTask(Socket* socket) :
+            socket(socket)
+    {};
+    
+    void Run(Reactor& reactor){
+        reactor.RemoveSocket(this->socket);
+        this->done.Set();
+    };
+};
+
+//submitted by several threads at once, counted in the reactor thread
+class CountTask : public Task{
+public:
+    static uint numRun;
+    static Event allRun;
+    
+    enum{
+        NUM_THREADS = 4,
+        NUM_PER_THREAD = 1000
+    };
+    
+    void Run(Reactor&){
+        if(++numRun == NUM_THREADS * NUM_PER_THREAD)
+            allRun.Set();
+    };
+};
+
+uint CountTask::numRun = 0;
+Event CountTask::allRun;
+
+struct SubmitThreadArgs{
+    Reactor* reactor;
+    CountTask* tasks;
+};
+
+static void* SubmitThread(void* args){
+    SubmitThreadArgs* a = reinterpret_cast<SubmitThreadArgs*>(args);
+    for(uint i = 0; i < CountTask::NUM_PER_THREAD; ++i)
+        a->reactor->Submit(&a->tasks[i]);
+    return 0;
+};
+
+//Pretends that reading from the socket left some data buffered in user space,
+//as a TLS socket does when one read decrypts several records.
+class FakeBufferedSocket : public UnixSocket{
+public:
+    uint numBuffered;
+    
+    FakeBufferedSocket(const UnixSocket& s) :
+            UnixSocket(s),
+            numBuffered(0)
+    {};
+    
+protected:
+    //override
+    bool HasBufferedData()const{
+        return this->numBuffered > 0;
+    };
+};
+
+class BufferedHandler : public SocketHandler{
+public:
+    uint numCalls;
+    uint removeAt;//remove the socket when this much fake data is left, 0 means do not remove
+    Event drained;
+    
+    BufferedHandler(uint removeAt) :
+            numCalls(0),
+            removeAt(removeAt)
+    {};
+    
+    void OnReady(Reactor& reactor, Socket& socket){
+        FakeBufferedSocket& s = static_cast<FakeBufferedSocket&>(socket);
+        ++this->numCalls;
+        if(s.numBuffered == 0){
+            //the byte reported by epoll, reading it "decrypts" three more
+            byte b;
+            s.Recv(&b, 1);
+            s.numBuffered = 3;
+            return;
+        }
+        
+        --s.numBuffered;
+        if(this->removeAt != 0 && s.numBuffered == this->removeAt){
+            reactor.RemoveSocket(&s);
+            this->drained.Set();
+        }else if(s.numBuffered == 0){
+            this->drained.Set();
+        }
+    };
+};
+
+static void TestReactor(){
+    printf("\n** Reactor **\n");
+    
+    Reactor reactor;
+    
+    //the reactor sleeps in epoll_wait() until the submission wakes it up
+    SyncTask sync;
+    reactor.Submit(&sync);
+    ScktTest("Submitted task wakes the reactor.", sync.done.Wait());
+    
+    CountTask tasks[CountTask::NUM_THREADS][CountTask::NUM_PER_THREAD];
+    pthread_t threads[CountTask::NUM_THREADS];
+    SubmitThreadArgs args[CountTask::NUM_THREADS];
+    for(uint i = 0; i < CountTask::NUM_THREADS; ++i){
+        args[i].reactor = &reactor;
+        args[i].tasks = tasks[i];
+        pthread_create(&threads[i], 0, &SubmitThread, &args[i]);
+    }
+    for(uint i = 0; i < CountTask::NUM_THREADS; ++i)
+        pthread_join(threads[i], 0);
+    ScktTest("Tasks submitted from several threads all run.", CountTask::allRun.Wait());
+    reactor.Submit(&sync);
+    sync.done.Wait();
+    ScktTest("Each task runs once.", CountTask::numRun == CountTask::NUM_THREADS * CountTask::NUM_PER_THREAD);
+    
+    UnixServerSocket server("sckttest-reactor", true);
+    UnixSocket client1("sckttest-reactor", true);
+    UnixSocket client2("sckttest-reactor", true);
+    FakeBufferedSocket drainedSocket(server.Accept());
+    FakeBufferedSocket removedSocket(server.Accept());
+    ScktTest("Connections accepted.", drainedSocket.IsValid() && removedSocket.IsValid());
+    
+    BufferedHandler drainedHandler(0);
+    BufferedHandler removedHandler(2);
+    reactor.AddSocket(&drainedSocket, &drainedHandler);
+    reactor.AddSocket(&removedSocket, &removedHandler);
+    
+    byte b = 1;
+    client1.Send(&b, 1);
+    client2.Send(&b, 1);
+    ScktTest("Buffered data drained.", drainedHandler.drained.Wait());
+    ScktTest("Removed with buffered data left.", removedHandler.drained.Wait());
+    
+    //a couple more iterations of the reactor loop
+    reactor.Submit(&sync);
+    sync.done.Wait();
+    reactor.Submit(&sync);
+    sync.done.Wait();
+    
+    ScktTest("Handler called for epoll and for each buffered piece.", drainedHandler.numCalls == 4);
+    ScktTest("Removed socket not handled again.", removedHandler.numCalls == 2 && removedSocket.numBuffered == 2);
+    
+    ScktTest("Load.", reactor.Load() == 1);
+    RemoveTask remove(&drainedSocket);
+    reactor.Submit(&remove);
+    remove.done.Wait();
+    ScktTest("Load after removing.", reactor.Load() == 0);
+};
+#endif//~__linux__
+
+#if defined(M_SCKT_WITH_TLS) && defined(__linux__)
+//Makes a request to "openssl s_server -www" which responds with a status page and closes the connection.
+//The socket is used through TCPSocket reference, as a connection pool would do.
+static bool TLSRequest(TLSContext& context, u16 port, const char* serverName, bool* out_Reused = 0){
+    try{
+        TLSSocket tls(context, IPAddress("127.0.0.1", port), serverName);
+        TCPSocket& s = tls;
+        
+        const char* request = "GET / HTTP/1.0\r\n\r\n";
+        s.Send(reinterpret_cast<const byte*>(request), uint(strlen(request)));
+        
+        char response[13] = {0};//only the status line is checked, the rest is skipped
+        uint received = 0;
+        byte buf[1024];
+        for(uint n; (n = s.Recv(buf, sizeof(buf))) != 0;){
+            for(uint i = 0; i < n && received < sizeof(response) - 1; ++i)
+                response[received++] = char(buf[i]);
+        }
+        
+        if(out_Reused)
+            *out_Reused = tls.IsSessionReused();
+        return strcmp(response, "HTTP/1.0 200") == 0;
+    }catch(sckt::Exc&){
+        return false;
+    }
+};
+
+struct TLSThreadArgs{
+    TLSContext* context;
+    u16 port;
+    uint numSucceeded;
+    uint numReused;
+    
+    enum{
+        NUM_THREADS = 2,
+        NUM_REQUESTS = 5
+    };
+};
+
+static void* TLSThread(void* args){
+    TLSThreadArgs* a = reinterpret_cast<TLSThreadArgs*>(args);
+    for(uint i = 0; i < TLSThreadArgs::NUM_REQUESTS; ++i){
+        bool reused = false;
+        if(TLSRequest(*a->context, a->port, "localhost", &reused))
+            ++a->numSucceeded;
+        if(reused)
+            ++a->numReused;
+    }
+    return 0;
+};
+
+//Starts "openssl s_server" with a fresh self-signed certificate for "localhost" in the directory.
+//Returns the port the server listens on, 0 if the server could not be started.
+static u16 StartTLSServer(const char* dir, pid_t* out_Pid){
+    char cmd[512];
+    sprintf(cmd, "openssl req -x509 -newkey rsa:2048 -nodes -keyout %s/key.pem -out %s/cert.pem -days 1"
+            " -subj /CN=localhost -addext subjectAltName=DNS:localhost > /dev/null 2>&1", dir, dir);
+    if(system(cmd) != 0)
+        return 0;
+    
+    char cert[256], key[256], out[256];
+    sprintf(cert, "%s/cert.pem", dir);
+    sprintf(key, "%s/key.pem", dir);
+    sprintf(out, "%s/server.txt", dir);
+    
+    pid_t pid = fork();
+    if(pid < 0)
+        return 0;
+    if(pid == 0){
+        //the output goes to a file, the port the server listens on is read from there
+        int fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        int devNull = open("/dev/null", O_WRONLY);
+        if(fd < 0 || devNull < 0)
+            _exit(1);
+        dup2(fd, 1);
+        dup2(devNull, 2);
+        execlp("openssl", "openssl", "s_server", "-accept", "127.0.0.1:0", "-cert", cert, "-key", key, "-www", (char*)0);
+        _exit(1);
+    }
+    *out_Pid = pid;
+    
+    //wait for "ACCEPT 127.0.0.1:<port>" line
+    for(uint i = 0; i < 500; ++i){
+        if(waitpid(pid, 0, WNOHANG) == pid){//exited
+            *out_Pid = 0;
+            return 0;
+        }
+        FILE* f = fopen(out, "r");
+        if(f){
+            char line[128];
+            unsigned port = 0;
+            while(fgets(line, sizeof(line), f)){
+                if(sscanf(line, "ACCEPT 127.0.0.1:%u", &port) == 1)
+                    break;
+            }
+            fclose(f);
+            if(port != 0)
+                return u16(port);
+        }
+        usleep(10000);
+    }
+    return 0;
+};
+
+static void TestTLS(){
+    printf("\n** TLS **\n");
+    
+    char dir[64];
+    sprintf(dir, "/tmp/sckttest-tls-%d", int(getpid()));
+    char cmd[128];
+    sprintf(cmd, "mkdir -p %s", dir);
+    
+    pid_t server = 0;
+    u16 port = 0;
+    if(system("openssl version > /dev/null 2>&1") == 0 && system(cmd) == 0)
+        port = StartTLSServer(dir, &server);
+    
+    if(port == 0){
+        printf("[skip] openssl s_server is not available\n");
+    }else{
+        char cert[128];
+        sprintf(cert, "%s/cert.pem", dir);
+        TLSContext context;
+        context.LoadVerifyLocations(cert);
+        
+        bool reused = true;
+        ScktTest("Request.", TLSRequest(context, port, "localhost", &reused));
+        ScktTest("Full handshake first.", !reused);
+        ScktTest("Session cached.", context.NumCachedSessions() == 1);
+        
+        ScktTest("Request with the cached session.", TLSRequest(context, port, "localhost", &reused));
+        ScktTest("Session reused.", reused);
+        
+        //the new sessions are put to the shared cache from both threads
+        TLSThreadArgs args[TLSThreadArgs::NUM_THREADS];
+        pthread_t threads[TLSThreadArgs::NUM_THREADS];
+        for(uint i = 0; i < TLSThreadArgs::NUM_THREADS; ++i){
+            args[i].context = &context;
+            args[i].port = port;
+            args[i].numSucceeded = 0;
+            args[i].numReused = 0;
+            pthread_create(&threads[i], 0, &TLSThread, &args[i]);
+        }
+        uint numSucceeded = 0, numReused = 0;
+        for(uint i = 0; i < TLSThreadArgs::NUM_THREADS; ++i){
+            pthread_join(threads[i], 0);
+            numSucceeded += args[i].numSucceeded;
+            numReused += args[i].numReused;
+        }
+        ScktTest("Requests from two threads sharing the context.",
+                numSucceeded == TLSThreadArgs::NUM_THREADS * TLSThreadArgs::NUM_REQUESTS);
+        ScktTest("Sessions reused by both threads.", numReused == numSucceeded);
+        ScktTest("One session per server.", context.NumCachedSessions() == 1);
+        
+        context.ClearSessionCache();
+        ScktTest("Cache cleared.", context.NumCachedSessions() == 0);
+        ScktTest("Full handshake after clearing.", TLSRequest(context, port, "localhost", &reused) && !reused);
+        
+        ScktTest("Wrong server name fails.", !TLSRequest(context, port, "otherhost"));
+        ScktTest("Failed handshake not cached.", context.NumCachedSessions() == 1);
+    }
+    
+    if(server != 0){
+        kill(server, SIGTERM);
+        waitpid(server, 0, 0);
+    }
+    sprintf(cmd, "rm -rf %s", dir);
+    system(cmd);
+};
+#endif
+
+int main(){
+    sckt::Library socketsLibrary;
+
+    TestBufferPool();
+#ifndef __WIN32__
+    TestUnixSocket();
+#endif
+#ifdef M_SCKT_WITH_STATS
+    TestHistogram();
+#ifndef __WIN32__
+    TestStats();
+#endif
+#endif
+#ifdef __linux__
+    TestReactor();
+#endif
+#if defined(M_SCKT_WITH_TLS) && defined(__linux__)
+    TestTLS();
+#endif
+
+    printf("\nPass %d, Fail %d\n", gPass, gFail);
+    return gFail;
+};
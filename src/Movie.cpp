@@ -1,12 +1,51 @@
-#include "movie.h"
+#include "Movie.h"
+#include "XmlBinding.h"
 #include <string>
 
 using namespace std;
 
 Movie::Movie()
+   : score(0), popularity(0), translated(false), adult(false),
+     id(0), votes(0), rating(0), version(0)
 {
 }
 
 Movie::~Movie()
 {
 }
+
+// The binding is built during static initialisation, before any thread can
+// call Load(). A function-local static would not be: C++98 doesn't make its
+// first-use initialisation thread safe.
+XmlBinding<Movie> Movie::binding;
+bool Movie::bound = Movie::Bind(Movie::binding);
+
+// The element names of the TMDb movie format.
+bool Movie::Bind(XmlBinding<Movie>& binding)
+{
+   binding.Element("score", &Movie::score)
+          .Element("popularity", &Movie::popularity)
+          .Element("translated", &Movie::translated)
+          .Element("adult", &Movie::adult)
+          .Element("language", &Movie::language)
+          .Element("original_name", &Movie::originalName)
+          .Element("name", &Movie::name)
+          .Element("alternative_name", &Movie::alternativeName)
+          .Element("type", &Movie::type)
+          .Element("id", &Movie::id)
+          .Element("imdb_id", &Movie::imdb_id)
+          .Element("url", &Movie::url)
+          .Element("votes", &Movie::votes)
+          .Element("rating", &Movie::rating)
+          .Element("certification", &Movie::certification)
+          .Element("overview", &Movie::overview)
+          .Element("released", &Movie::released)
+          .Element("last_modified_at", &Movie::lastModified)
+          .Element("version", &Movie::version);
+   return true;
+}
+
+void Movie::Load(const TiXmlElement* element)
+{
+   binding.Fill(element, *this);
+}
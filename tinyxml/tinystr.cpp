@@ -35,9 +35,6 @@ distribution.
 const TiXmlString::size_type TiXmlString::npos = static_cast< TiXmlString::size_type >(-1);
 
 
-// Null rep.
-TiXmlString::Rep TiXmlString::nullrep_ = { 0, 0, { '\0' } };
-
 
 void TiXmlString::reserve (size_type cap)
 {
@@ -54,7 +51,7 @@ void TiXmlString::reserve (size_type cap)
 TiXmlString& TiXmlString::assign(const char* str, size_type len)
 {
 	size_type cap = capacity();
-	if (len > cap || cap > 3*(len + 8))
+	if (cap == 0 || len > cap || cap > 3*(len + 8))
 	{
 		TiXmlString tmp;
 		tmp.init(len);
@@ -70,13 +67,10 @@ TiXmlString& TiXmlString::assign(const char* str, size_type len)
 }
 
 
-TiXmlString& TiXmlString::append(const char* str, size_type len)
+TiXmlString& TiXmlString::append_grow(const char* str, size_type len)
 {
 	size_type newsize = length() + len;
-	if (newsize > capacity())
-	{
-		reserve (newsize + capacity());
-	}
+	reserve (newsize + capacity());
 	memmove(finish(), str, len);
 	set_size(newsize);
 	return *this;
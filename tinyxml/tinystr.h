@@ -27,6 +27,11 @@ distribution.
  *
  * - completely rewritten. compact, clean, and fast implementation.
  * - sizeof(TiXmlString) = pointer size (4 bytes on 32-bit systems)
+ *   (no longer true: with the inline buffer for short strings, added later,
+ *   it is 2 * sizeof(size_t) + 16, i.e. 32 bytes on 64-bit systems. That is
+ *   the size of std::string in libstdc++, so nodes take the same memory as
+ *   in the TIXML_USE_STL build, 24 bytes more per string than before: each
+ *   element, text or comment has one, each attribute two.)
  * - fixed reserve() to work as per specification.
  * - fixed buggy compares operator==(), operator<(), and operator>()
  * - fixed operator+=() to take a const ref argument, following spec.
@@ -56,6 +61,13 @@ distribution.
 	#define TIXML_EXPLICIT
 #endif
 
+/*	Move construction and assignment need rvalue references, which came with C++11.
+	Older compilers get the copying versions only.
+*/
+#if __cplusplus >= 201103L || ( defined(_MSC_VER) && (_MSC_VER >= 1600 ) )
+	#define TIXML_RVALUE_REFS
+#endif
+
 
 /*
    TiXmlString is an emulation of a subset of the std::string template.
@@ -63,6 +75,10 @@ distribution.
    Only the member functions relevant to the TinyXML project have been implemented.
    The buffer allocation is made by a simplistic power of 2 like mechanism : if we increase
    a string and there's no more room, we allocate a buffer twice as big as we need.
+   A string can also refer to characters it doesn't own (see assign_external() and borrow()),
+   so it keeps a pointer to its characters rather than to a header in front of them.
+   Strings of up to 15 characters (element names, short values) are kept in the string
+   itself, and don't allocate at all.
 */
 class TiXmlString
 {
@@ -75,31 +91,40 @@ class TiXmlString
 
 
 	// TiXmlString empty constructor
-	TiXmlString () : rep_(&nullrep_)
+	TiXmlString () : start_(local_), size_(0)
 	{
+		local_[0] = '\0';
 	}
 
 	// TiXmlString copy constructor
-	TiXmlString ( const TiXmlString & copy) : rep_(0)
+	TiXmlString ( const TiXmlString & copy)
 	{
 		init(copy.length());
 		memcpy(start(), copy.data(), length());
 	}
 
 	// TiXmlString constructor, based on a string
-	TIXML_EXPLICIT TiXmlString ( const char * copy) : rep_(0)
+	TIXML_EXPLICIT TiXmlString ( const char * copy)
 	{
 		init( static_cast<size_type>( strlen(copy) ));
 		memcpy(start(), copy, length());
 	}
 
 	// TiXmlString constructor, based on a string
-	TIXML_EXPLICIT TiXmlString ( const char * str, size_type len) : rep_(0)
+	TIXML_EXPLICIT TiXmlString ( const char * str, size_type len)
 	{
 		init(len);
 		memcpy(start(), str, len);
 	}
 
+	#ifdef TIXML_RVALUE_REFS
+	// TiXmlString move constructor: takes the buffer, and leaves 'other' empty.
+	TiXmlString ( TiXmlString && other )
+	{
+		take(other);
+	}
+	#endif
+
 	// TiXmlString destructor
 	~TiXmlString ()
 	{
@@ -118,6 +143,19 @@ class TiXmlString
 		return assign(copy.start(), copy.length());
 	}
 
+	#ifdef TIXML_RVALUE_REFS
+	// = operator, moving
+	TiXmlString& operator = (TiXmlString && other)
+	{
+		if (this != &other)
+		{
+			quit();
+			take(other);
+		}
+		return *this;
+	}
+	#endif
+
 
 	// += operator. Maps to append
 	TiXmlString& operator += (const char * suffix)
@@ -139,36 +177,39 @@ class TiXmlString
 
 
 	// Convert a TiXmlString into a null-terminated char *
-	const char * c_str () const { return rep_->str; }
+	const char * c_str () const { return start_; }
 
 	// Convert a TiXmlString into a char * (need not be null terminated).
-	const char * data () const { return rep_->str; }
+	const char * data () const { return start_; }
 
 	// Return the length of a TiXmlString
-	size_type length () const { return rep_->size; }
+	size_type length () const { return size_; }
 
 	// Alias for length()
-	size_type size () const { return rep_->size; }
+	size_type size () const { return size_; }
 
 	// Checks if a TiXmlString is empty
-	bool empty () const { return rep_->size == 0; }
+	bool empty () const { return size_ == 0; }
 
-	// Return capacity of string
-	size_type capacity () const { return rep_->capacity; }
+	// Return capacity of string. A string that doesn't own its characters has none.
+	size_type capacity () const { return is_local() ? size_type(LOCAL_CAPACITY) : capacity_; }
+
+	// The longest string that is kept in the string itself, rather than on the heap.
+	static size_type local_capacity () { return LOCAL_CAPACITY; }
 
 
 	// single char extraction
 	const char& at (size_type index) const
 	{
 		assert( index < length() );
-		return rep_->str[ index ];
+		return start_[ index ];
 	}
 
 	// [] operator
 	char& operator [] (size_type index) const
 	{
 		assert( index < length() );
-		return rep_->str[ index ];
+		return start_[ index ];
 	}
 
 	// find a char in a string. Return TiXmlString::npos if not found
@@ -189,6 +230,16 @@ class TiXmlString
 		return npos;
 	}
 
+	// Make the string empty, but keep the buffer for reuse (as std::string::erase() does.)
+	TiXmlString& erase ()
+	{
+		if (capacity())
+			set_size(0);
+		else
+			clear();
+		return *this;
+	}
+
 	void clear ()
 	{
 		//Lee:
@@ -206,62 +257,115 @@ class TiXmlString
 
 	TiXmlString& assign (const char* str, size_type len);
 
-	TiXmlString& append (const char* str, size_type len);
+	// Inline: printing appends many short pieces, and most fit.
+	TiXmlString& append (const char* str, size_type len)
+	{
+		size_type newsize = length() + len;
+		if (newsize > capacity())
+			return append_grow(str, len);
+		memmove(finish(), str, len);
+		set_size(newsize);
+		return *this;
+	}
 
 	void swap (TiXmlString& other)
 	{
-		Rep* r = rep_;
-		rep_ = other.rep_;
-		other.rep_ = r;
+		if (this == &other)
+			return;
+		TiXmlString tmp;
+		tmp.take(*this);
+		take(other);
+		other.take(tmp);
+	}
+
+	/*	Set the string to a copy of 'str', kept in memory the string doesn't own (used for
+		strings allocated in a TiXmlArena.) 'mem' must be at least external_size(len) bytes,
+		and must outlive the string. Such a string has a capacity of 0, so it moves itself
+		to the heap as soon as it grows, and never frees 'mem'.
+	*/
+	static size_type external_size (size_type len) { return len + 1; }
+	void assign_external (void* mem, const char* str, size_type len)
+	{
+		quit();
+		start_ = static_cast<char*>(mem);
+		capacity_ = 0;
+		memcpy(start_, str, len);
+		set_size(len);
+	}
+
+	/*	Make the string refer to the 'len' characters at 'str', without copying them (used by
+		the in-situ parse of TiXmlDocument.) str[len] must be (or become, before c_str() is used)
+		a null character. As with assign_external(), the string has no capacity.
+	*/
+	void borrow (char* str, size_type len)
+	{
+		quit();
+		start_ = str;
+		size_ = len;
+		capacity_ = 0;
 	}
 
   private:
 
-	void init(size_type sz) { init(sz, sz); }
-	void set_size(size_type sz) { rep_->str[ rep_->size = sz ] = '\0'; }
-	char* start() const { return rep_->str; }
-	char* finish() const { return rep_->str + rep_->size; }
+	enum { LOCAL_CAPACITY = 15 };
 
-	struct Rep
-	{
-		size_type size, capacity;
-		char str[1];
-	};
+	void init(size_type sz) { init(sz, sz); }
+	void set_size(size_type sz) { start_[ size_ = sz ] = '\0'; }
+	char* start() const { return start_; }
+	char* finish() const { return start_ + size_; }
+	bool is_local() const { return start_ == local_; }
+	TiXmlString& append_grow(const char* str, size_type len);
 
 	void init(size_type sz, size_type cap)
 	{
-		if (cap)
+		if (cap > LOCAL_CAPACITY)
 		{
-			// Lee: the original form:
-			//	rep_ = static_cast<Rep*>(operator new(sizeof(Rep) + cap));
-			// doesn't work in some cases of new being overloaded. Switching
-			// to the normal allocation, although use an 'int' for systems
-			// that are overly picky about structure alignment.
-			const size_type bytesNeeded = sizeof(Rep) + cap;
-			const size_type intsNeeded = ( bytesNeeded + sizeof(int) - 1 ) / sizeof( int ); 
-			rep_ = reinterpret_cast<Rep*>( new int[ intsNeeded ] );
-
-			rep_->str[ rep_->size = sz ] = '\0';
-			rep_->capacity = cap;
+			start_ = new char[ cap + 1 ];
+			capacity_ = cap;
 		}
 		else
 		{
-			rep_ = &nullrep_;
+			start_ = local_;
 		}
+		set_size(sz);
 	}
 
 	void quit()
 	{
-		if (rep_ != &nullrep_)
+		// Only the buffers from init() have a capacity. The local buffer, and
+		// characters from assign_external() or borrow() aren't ours to delete.
+		if (!is_local() && capacity_)
 		{
-			// The rep_ is really an array of ints. (see the allocator, above).
-			// Cast it back before delete, so the compiler won't incorrectly call destructors.
-			delete [] ( reinterpret_cast<int*>( rep_ ) );
+			delete [] start_;
 		}
 	}
 
-	Rep * rep_;
-	static Rep nullrep_;
+	// Take over the characters of 'from', which is left empty. Whatever this
+	// string held must have been released (or never set) already.
+	void take(TiXmlString& from)
+	{
+		if (from.is_local())
+		{
+			memcpy(local_, from.local_, from.size_ + 1);
+			start_ = local_;
+		}
+		else
+		{
+			start_ = from.start_;
+			capacity_ = from.capacity_;
+		}
+		size_ = from.size_;
+		from.start_ = from.local_;
+		from.set_size(0);
+	}
+
+	char* start_;
+	size_type size_;
+	union
+	{
+		size_type capacity_;				// of the heap buffer, or 0 if the characters aren't ours
+		char local_[ LOCAL_CAPACITY + 1 ];	// the characters, if start_ points here
+	};
 
 } ;
 
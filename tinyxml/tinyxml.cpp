@@ -31,9 +31,38 @@ distribution.
 
 #include "tinyxml.h"
 
+#if !defined( TIXML_NO_MMAP ) && ( defined( __unix__ ) || defined( __APPLE__ ) )
+#	define TIXML_MMAP
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#	if !defined( MAP_ANONYMOUS ) && defined( MAP_ANON )
+#		define MAP_ANONYMOUS MAP_ANON
+#	endif
+#endif
+
+#if defined( _WIN32 )
+#	include <io.h>
+#else
+#	include <unistd.h>
+#endif
+#include <errno.h>
+
+#if defined( _WIN32 )
+#	define TIXML_WIN32_LOCK
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	include <windows.h>
+#elif defined( __unix__ ) || defined( __APPLE__ )
+#	define TIXML_PTHREAD_LOCK
+#	include <pthread.h>
+#endif
+
 FILE* TiXmlFOpen( const char* filename, const char* mode );
 
 bool TiXmlBase::condenseWhiteSpace = true;
+bool TiXmlNode::indexChildren = false;
 
 // Microsoft compiler security
 FILE* TiXmlFOpen( const char* filename, const char* mode )
@@ -51,85 +80,405 @@ FILE* TiXmlFOpen( const char* filename, const char* mode )
 
 void TiXmlBase::EncodeString( const TIXML_STRING& str, TIXML_STRING* outString )
 {
-	int i=0;
+	const char* p = str.c_str();
+	const char* end = p + str.length();
+	char scratch[ 8 ];
 
-	while( i<(int)str.length() )
+	while ( p < end )
 	{
-		unsigned char c = (unsigned char) str[i];
+		const char* replacement = 0;
+		size_t replacementLength = 0;
+		const char* run = EncodeRun( p, end, &replacement, &replacementLength, scratch );
 
-		if (    c == '&' 
-		     && i < ( (int)str.length() - 2 )
-			 && str[i+1] == '#'
-			 && str[i+2] == 'x' )
-		{
-			// Hexadecimal character reference.
-			// Pass through unchanged.
-			// &#xA9;	-- copyright symbol, for example.
-			//
-			// The -1 is a bug fix from Rob Laveaux. It keeps
-			// an overflow from happening if there is no ';'.
-			// There are actually 2 ways to exit this loop -
-			// while fails (error case) and break (semicolon found).
-			// However, there is no mechanism (currently) for
-			// this function to return an error.
-			while ( i<(int)str.length()-1 )
-			{
-				outString->append( str.c_str() + i, 1 );
-				++i;
-				if ( str[i] == ';' )
-					break;
-			}
-		}
-		else if ( c == '&' )
+		outString->append( p, run - p );
+		if ( run == end )
+			break;
+		outString->append( replacement, replacementLength );
+		p = run + 1;
+	}
+}
+
+
+/*static*/ const char* TiXmlBase::EncodeRun( const char* p, const char* end, const char** replacement, size_t* replacementLength, char* scratch )
+{
+	while ( p < end )
+	{
+		unsigned char c = (unsigned char) *p;
+		int e;
+
+		switch ( c )
 		{
-			outString->append( entity[0].str, entity[0].strLength );
-			++i;
+			case '&':
+				if ( p + 2 < end && p[1] == '#' && p[2] == 'x' )
+				{
+					// Hexadecimal character reference.
+					// Pass through unchanged, up to the ';'.
+					// &#xA9;	-- copyright symbol, for example.
+					//
+					// The end - 1 is a bug fix from Rob Laveaux. It keeps
+					// an overflow from happening if there is no ';'. The
+					// ';' itself, or the last character, is looked at again.
+					++p;
+					while ( p < end - 1 && *p != ';' )
+						++p;
+					continue;
+				}
+				e = 0;
+				break;
+			case '<':	e = 1;	break;
+			case '>':	e = 2;	break;
+			case '\"':	e = 3;	break;
+			case '\'':	e = 4;	break;
+			default:
+				if ( c >= 32 )
+				{
+					// Most text has nothing to replace: skip to the next that does.
+					p = ScanEscape( p + 1, end );
+					continue;
+				}
+				// Easy pass at non-alpha/numeric/symbol
+				// Below 32 is symbolic.
+				e = -1;
+				break;
 		}
-		else if ( c == '<' )
+
+		if ( e >= 0 )
 		{
-			outString->append( entity[1].str, entity[1].strLength );
-			++i;
+			*replacement = entity[e].str;
+			*replacementLength = entity[e].strLength;
 		}
-		else if ( c == '>' )
+		else
 		{
-			outString->append( entity[2].str, entity[2].strLength );
-			++i;
+			static const char hex[] = "0123456789ABCDEF";
+			scratch[0] = '&';
+			scratch[1] = '#';
+			scratch[2] = 'x';
+			scratch[3] = hex[ c >> 4 ];
+			scratch[4] = hex[ c & 0xf ];
+			scratch[5] = ';';
+			*replacement = scratch;
+			*replacementLength = 6;
 		}
-		else if ( c == '\"' )
+		return p;
+	}
+	return p;
+}
+
+
+/*static*/ const char* TiXmlBase::InternName( TIXML_STRING* target, const TIXML_STRING& name )
+{
+	const char* symbol = TiXmlNameTable::Intern( name.data(), name.length() );
+	#ifndef TIXML_USE_STL
+	// The table never changes or frees a name, so the string can refer to it.
+	target->borrow( const_cast<char*>( symbol ), name.length() );
+	#else
+	if ( target != &name )
+		*target = name;
+	#endif
+	return symbol;
+}
+
+
+TiXmlArena::TiXmlArena( size_t _blockSize )
+{
+	blocks = 0;
+	top = end = 0;
+	blockSize = _blockSize;
+	bytesUsed = 0;
+}
+
+
+TiXmlArena::~TiXmlArena()
+{
+	while ( blocks )
+	{
+		Block* block = blocks;
+		blocks = blocks->next;
+		delete [] reinterpret_cast<char*>( block );
+	}
+}
+
+
+void* TiXmlArena::Alloc( size_t size )
+{
+	size = ( size + ALIGNMENT - 1 ) & ~( (size_t) ALIGNMENT - 1 );
+	bytesUsed += size;
+
+	if ( size <= (size_t)( end - top ) )
+	{
+		void* mem = top;
+		top += size;
+		return mem;
+	}
+
+	// Big requests get a block of their own, behind the current one, so
+	// the rest of the current block is still used.
+	bool own = size > blockSize / 2;
+	size_t dataSize = own ? size : blockSize;
+	Block* block = reinterpret_cast<Block*>( new char[ sizeof( Block ) + dataSize ] );
+	block->size = dataSize;
+	char* data = reinterpret_cast<char*>( block + 1 );
+
+	if ( own && blocks )
+	{
+		block->next = blocks->next;
+		blocks->next = block;
+		return data;
+	}
+	block->next = blocks;
+	blocks = block;
+	if ( own )
+		return data;
+
+	top = data + size;
+	end = data + dataSize;
+	return data;
+}
+
+
+void TiXmlArena::Reset()
+{
+	Block* keep = 0;
+	while ( blocks )
+	{
+		Block* block = blocks;
+		blocks = blocks->next;
+		if ( !keep && block->size == blockSize )
+			keep = block;
+		else
+			delete [] reinterpret_cast<char*>( block );
+	}
+
+	top = end = 0;
+	if ( keep )
+	{
+		keep->next = 0;
+		blocks = keep;
+		top = reinterpret_cast<char*>( keep + 1 );
+		end = top + keep->size;
+	}
+	bytesUsed = 0;
+}
+
+
+TiXmlNameTable::Table* TiXmlNameTable::table = 0;
+size_t TiXmlNameTable::count = 0;
+char* TiXmlNameTable::top = 0;
+char* TiXmlNameTable::end = 0;
+
+namespace {
+
+// Holds the lock of the name table while in scope. Without a known thread
+// library, the table isn't locked, and can only be used from one thread.
+class TiXmlNameLock
+{
+public:
+	#if defined( TIXML_WIN32_LOCK )
+	TiXmlNameLock()		{ AcquireSRWLockExclusive( &lock ); }
+	~TiXmlNameLock()	{ ReleaseSRWLockExclusive( &lock ); }
+	#elif defined( TIXML_PTHREAD_LOCK )
+	TiXmlNameLock()		{ pthread_mutex_lock( &lock ); }
+	~TiXmlNameLock()	{ pthread_mutex_unlock( &lock ); }
+	#endif
+
+private:
+	#if defined( TIXML_WIN32_LOCK )
+	static SRWLOCK lock;
+	#elif defined( TIXML_PTHREAD_LOCK )
+	static pthread_mutex_t lock;
+	#endif
+};
+
+#if defined( TIXML_WIN32_LOCK )
+SRWLOCK TiXmlNameLock::lock = SRWLOCK_INIT;
+#elif defined( TIXML_PTHREAD_LOCK )
+pthread_mutex_t TiXmlNameLock::lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+// A name, or a table, is published with a release store once it is complete,
+// so a reader that sees it with an acquire load can use it without the lock.
+// GCC 4.7 and clang, which have the __atomic builtins, define __ATOMIC_ACQUIRE.
+#if defined( __ATOMIC_ACQUIRE )
+#	define TIXML_ATOMIC_LOAD( p )		__atomic_load_n( &( p ), __ATOMIC_ACQUIRE )
+#	define TIXML_ATOMIC_STORE( p, v )	__atomic_store_n( &( p ), ( v ), __ATOMIC_RELEASE )
+#else
+#	define TIXML_READ_LOCK
+#	define TIXML_ATOMIC_LOAD( p )		( p )
+#	define TIXML_ATOMIC_STORE( p, v )	( ( p ) = ( v ) )
+#endif
+
+}
+
+
+/*static*/ unsigned TiXmlNameTable::Hash( const char* name, size_t length )
+{
+	// FNV-1a: cheap, and good enough for names.
+	unsigned hash = 2166136261u;
+	for( size_t i=0; i<length; ++i )
+	{
+		hash ^= (unsigned char) name[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+
+/*static*/ const char* TiXmlNameTable::Lookup( const Table* t, unsigned hash, const char* name, size_t length )
+{
+	if ( !t )
+		return 0;
+	const Entry* entries = t->entries;
+	for( size_t i = hash & t->mask; ; i = ( i + 1 ) & t->mask )
+	{
+		const char* candidate = TIXML_ATOMIC_LOAD( entries[i].name );
+		if ( !candidate )
+			return 0;
+		if (    entries[i].hash == hash
+			 && entries[i].length == length
+			 && memcmp( candidate, name, length ) == 0 )
 		{
-			outString->append( entity[3].str, entity[3].strLength );
-			++i;
+			return candidate;
 		}
-		else if ( c == '\'' )
+	}
+}
+
+
+/*static*/ const char* TiXmlNameTable::Find( const char* name, size_t length )
+{
+	unsigned hash = Hash( name, length );
+	#ifdef TIXML_READ_LOCK
+	TiXmlNameLock lock;
+	#endif
+	return Lookup( TIXML_ATOMIC_LOAD( table ), hash, name, length );
+}
+
+
+/*static*/ const char* TiXmlNameTable::Intern( const char* name, size_t length )
+{
+	unsigned hash = Hash( name, length );
+	#ifndef TIXML_READ_LOCK
+	const char* found = Lookup( TIXML_ATOMIC_LOAD( table ), hash, name, length );
+	if ( found )
+		return found;
+	#endif
+
+	// Look again under the lock: another thread may have added it meanwhile.
+	TiXmlNameLock lock;
+	const char* symbol = Lookup( table, hash, name, length );
+	if ( symbol )
+		return symbol;
+
+	// Keep the table at most half full, so probe runs stay short.
+	if ( !table || ( count + 1 ) * 2 > table->mask + 1 )
+		Rehash( table ? ( table->mask + 1 ) * 2 : 256 );
+
+	// Names are packed into blocks that are never freed, as symbols have
+	// to stay valid. A long name gets a block of its own.
+	char* copy;
+	if ( length + 1 > (size_t)( end - top ) )
+	{
+		if ( length + 1 > BLOCK_SIZE / 4 )
 		{
-			outString->append( entity[4].str, entity[4].strLength );
-			++i;
+			copy = new char[ length + 1 ];
 		}
-		else if ( c < 32 )
+		else
 		{
-			// Easy pass at non-alpha/numeric/symbol
-			// Below 32 is symbolic.
-			char buf[ 32 ];
-			
-			#if defined(TIXML_SNPRINTF)		
-				TIXML_SNPRINTF( buf, sizeof(buf), "&#x%02X;", (unsigned) ( c & 0xff ) );
-			#else
-				sprintf( buf, "&#x%02X;", (unsigned) ( c & 0xff ) );
-			#endif		
-
-			//*ME:	warning C4267: convert 'size_t' to 'int'
-			//*ME:	Int-Cast to make compiler happy ...
-			outString->append( buf, (int)strlen( buf ) );
-			++i;
+			top = new char[ BLOCK_SIZE ];
+			end = top + BLOCK_SIZE;
+			copy = top;
+			top += length + 1;
 		}
-		else
+	}
+	else
+	{
+		copy = top;
+		top += length + 1;
+	}
+	memcpy( copy, name, length );
+	copy[length] = 0;
+
+	Entry* entries = table->entries;
+	size_t i = hash & table->mask;
+	while ( entries[i].name )
+		i = ( i + 1 ) & table->mask;
+	entries[i].hash = hash;
+	entries[i].length = length;
+	TIXML_ATOMIC_STORE( entries[i].name, (const char*) copy );
+	++count;
+	return copy;
+}
+
+
+/*static*/ size_t TiXmlNameTable::Size()
+{
+	TiXmlNameLock lock;
+	return count;
+}
+
+
+/*static*/ void TiXmlNameTable::Rehash( size_t size )
+{
+	Table* t = new Table;
+	t->previous = table;
+	t->mask = size - 1;
+	t->entries = new Entry[ size ];
+	for( size_t i=0; i<size; ++i )
+		t->entries[i].name = 0;
+
+	if ( table )
+	{
+		for( size_t j=0; j<=table->mask; ++j )
 		{
-			//char realc = (char) c;
-			//outString->append( &realc, 1 );
-			*outString += (char) c;	// somewhat more efficient function call.
-			++i;
+			const Entry& entry = table->entries[j];
+			if ( !entry.name )
+				continue;
+			size_t i = entry.hash & t->mask;
+			while ( t->entries[i].name )
+				i = ( i + 1 ) & t->mask;
+			t->entries[i] = entry;
 		}
 	}
+	TIXML_ATOMIC_STORE( table, t );
+}
+
+
+// Put in front of every node and attribute, see TiXmlBase::operator new.
+union TiXmlAllocHeader
+{
+	TiXmlArena* arena;		// null for heap objects
+	double align;
+};
+
+
+void* TiXmlBase::operator new( size_t size )
+{
+	TiXmlAllocHeader* header = static_cast<TiXmlAllocHeader*>( ::operator new( sizeof( TiXmlAllocHeader ) + size ) );
+	header->arena = 0;
+	return header + 1;
+}
+
+
+void* TiXmlBase::operator new( size_t size, TiXmlArena& arena )
+{
+	TiXmlAllocHeader* header = static_cast<TiXmlAllocHeader*>( arena.Alloc( sizeof( TiXmlAllocHeader ) + size ) );
+	header->arena = &arena;
+	return header + 1;
+}
+
+
+void TiXmlBase::operator delete( void* p )
+{
+	if ( !p )
+		return;
+	TiXmlAllocHeader* header = static_cast<TiXmlAllocHeader*>( p ) - 1;
+	if ( !header->arena )
+		::operator delete( header );
+}
+
+
+void TiXmlBase::operator delete( void*, TiXmlArena& )
+{
+	// Only called if a constructor throws. The memory goes with the arena.
 }
 
 
@@ -137,15 +486,19 @@ TiXmlNode::TiXmlNode( NodeType _type ) : TiXmlBase()
 {
 	parent = 0;
 	type = _type;
+	symbol = 0;
 	firstChild = 0;
 	lastChild = 0;
 	prev = 0;
 	next = 0;
+	childIndex = 0;
 }
 
 
 TiXmlNode::~TiXmlNode()
 {
+	DropChildIndex();
+
 	TiXmlNode* node = firstChild;
 	TiXmlNode* temp = 0;
 
@@ -158,6 +511,28 @@ TiXmlNode::~TiXmlNode()
 }
 
 
+void TiXmlNode::SetValue( const char* _value )
+{
+	value = _value;
+	if ( type == TINYXML_ELEMENT )
+		symbol = InternName( &value, value );
+	if ( parent )
+		parent->DropChildIndex();
+}
+
+
+#ifdef TIXML_USE_STL
+void TiXmlNode::SetValue( const std::string& _value )
+{
+	value = _value;
+	if ( type == TINYXML_ELEMENT )
+		symbol = InternName( &value, value );
+	if ( parent )
+		parent->DropChildIndex();
+}
+#endif
+
+
 void TiXmlNode::CopyTo( TiXmlNode* target ) const
 {
 	target->SetValue (value.c_str() );
@@ -180,6 +555,7 @@ void TiXmlNode::Clear()
 
 	firstChild = 0;
 	lastChild = 0;
+	DropChildIndex();
 }
 
 
@@ -196,6 +572,7 @@ TiXmlNode* TiXmlNode::LinkEndChild( TiXmlNode* node )
 	}
 
 	node->parent = this;
+	DropChildIndex();
 
 	node->prev = lastChild;
 	node->next = 0;
@@ -240,6 +617,7 @@ TiXmlNode* TiXmlNode::InsertBeforeChild( TiXmlNode* beforeThis, const TiXmlNode&
 	if ( !node )
 		return 0;
 	node->parent = this;
+	DropChildIndex();
 
 	node->next = beforeThis;
 	node->prev = beforeThis->prev;
@@ -272,6 +650,7 @@ TiXmlNode* TiXmlNode::InsertAfterChild( TiXmlNode* afterThis, const TiXmlNode& a
 	if ( !node )
 		return 0;
 	node->parent = this;
+	DropChildIndex();
 
 	node->prev = afterThis;
 	node->next = afterThis->next;
@@ -308,6 +687,7 @@ TiXmlNode* TiXmlNode::ReplaceChild( TiXmlNode* replaceThis, const TiXmlNode& wit
 	TiXmlNode* node = withThis.Clone();
 	if ( !node )
 		return 0;
+	DropChildIndex();
 
 	node->next = replaceThis->next;
 	node->prev = replaceThis->prev;
@@ -339,6 +719,7 @@ bool TiXmlNode::RemoveChild( TiXmlNode* removeThis )
 		assert( 0 );
 		return false;
 	}
+	DropChildIndex();
 
 	if ( removeThis->next )
 		removeThis->next->prev = removeThis->prev;
@@ -356,11 +737,77 @@ bool TiXmlNode::RemoveChild( TiXmlNode* removeThis )
 
 const TiXmlNode* TiXmlNode::FirstChild( const char * _value ) const
 {
+	if ( childIndex )
+	{
+		const ChildIndex::Entry* entry = LookupChild( _value );
+		return entry ? entry->first : 0;
+	}
+
 	const TiXmlNode* node;
-	for ( node = firstChild; node; node = node->next )
+	int walked = 0;
+	for ( node = firstChild; node; node = node->next, ++walked )
 	{
 		if ( strcmp( node->Value(), _value ) == 0 )
-			return node;
+			break;
+	}
+	if ( walked > CHILD_INDEX_MIN && indexChildren )
+		IndexChildren();
+	return node;
+}
+
+
+void TiXmlNode::IndexChildren() const
+{
+	unsigned count = 0;
+	const TiXmlNode* node;
+	for ( node = firstChild; node; node = node->next )
+		++count;
+
+	// Keep the table at most half full, so probe runs stay short.
+	unsigned size = 16;
+	while ( size < count * 2 )
+		size *= 2;
+	ChildIndex* index = new ChildIndex( size );
+	for ( unsigned i=0; i<size; ++i )
+		index->entries[i].first = 0;
+
+	for ( node = firstChild; node; node = node->next )
+	{
+		const TIXML_STRING& v = node->value;
+		unsigned hash = TiXmlNameTable::Hash( v.data(), v.length() );
+		unsigned i = hash & index->mask;
+		for ( ; index->entries[i].first; i = ( i + 1 ) & index->mask )
+		{
+			const TIXML_STRING& other = index->entries[i].first->value;
+			if ( index->entries[i].hash == hash && other.length() == v.length() && memcmp( other.data(), v.data(), v.length() ) == 0 )
+				break;
+		}
+
+		ChildIndex::Entry& entry = index->entries[i];
+		if ( !entry.first )
+		{
+			entry.hash = hash;
+			entry.first = node;
+			entry.firstElement = 0;
+		}
+		if ( !entry.firstElement && node->type == TINYXML_ELEMENT )
+			entry.firstElement = static_cast<const TiXmlElement*>( node );
+	}
+	DropChildIndex();
+	childIndex = index;
+}
+
+
+const TiXmlNode::ChildIndex::Entry* TiXmlNode::LookupChild( const char* _value ) const
+{
+	size_t length = strlen( _value );
+	unsigned hash = TiXmlNameTable::Hash( _value, length );
+	for ( unsigned i = hash & childIndex->mask; childIndex->entries[i].first; i = ( i + 1 ) & childIndex->mask )
+	{
+		const ChildIndex::Entry& entry = childIndex->entries[i];
+		const TIXML_STRING& v = entry.first->value;
+		if ( entry.hash == hash && v.length() == length && memcmp( v.data(), _value, length ) == 0 )
+			return &entry;
 	}
 	return 0;
 }
@@ -462,16 +909,30 @@ const TiXmlElement* TiXmlNode::FirstChildElement() const
 
 const TiXmlElement* TiXmlNode::FirstChildElement( const char * _value ) const
 {
+	if ( childIndex )
+	{
+		const ChildIndex::Entry* entry = LookupChild( _value );
+		return entry ? entry->firstElement : 0;
+	}
+
+	// Only elements have symbols.
+	const char* wanted = TiXmlNameTable::Find( _value );
+	if ( !wanted )
+		return 0;
+
 	const TiXmlNode* node;
+	int walked = 0;
 
-	for (	node = FirstChild( _value );
+	for (	node = firstChild;
 			node;
-			node = node->NextSibling( _value ) )
+			node = node->next, ++walked )
 	{
-		if ( node->ToElement() )
-			return node->ToElement();
+		if ( node->symbol == wanted )
+			break;
 	}
-	return 0;
+	if ( walked > CHILD_INDEX_MIN && indexChildren )
+		IndexChildren();
+	return node ? node->ToElement() : 0;
 }
 
 
@@ -492,13 +953,17 @@ const TiXmlElement* TiXmlNode::NextSiblingElement() const
 
 const TiXmlElement* TiXmlNode::NextSiblingElement( const char * _value ) const
 {
+	const char* wanted = TiXmlNameTable::Find( _value );
+	if ( !wanted )
+		return 0;
+
 	const TiXmlNode* node;
 
-	for (	node = NextSibling( _value );
+	for (	node = next;
 			node;
-			node = node->NextSibling( _value ) )
+			node = node->next )
 	{
-		if ( node->ToElement() )
+		if ( node->symbol == wanted )
 			return node->ToElement();
 	}
 	return 0;
@@ -522,7 +987,7 @@ TiXmlElement::TiXmlElement (const char * _value)
 	: TiXmlNode( TiXmlNode::TINYXML_ELEMENT )
 {
 	firstChild = lastChild = 0;
-	value = _value;
+	SetValue( _value );
 }
 
 
@@ -531,7 +996,7 @@ TiXmlElement::TiXmlElement( const std::string& _value )
 	: TiXmlNode( TiXmlNode::TINYXML_ELEMENT )
 {
 	firstChild = lastChild = 0;
-	value = _value;
+	SetValue( _value );
 }
 #endif
 
@@ -869,14 +1334,30 @@ const char* TiXmlElement::GetText() const
 TiXmlDocument::TiXmlDocument() : TiXmlNode( TiXmlNode::TINYXML_DOCUMENT )
 {
 	tabsize = 4;
+	lazyLocations = false;
 	useMicrosoftBOM = false;
+	arena = 0;
+	inSituBuffer = 0;
+	ownsInSituBuffer = false;
+	parsingInSitu = false;
+	pendingTerminator = 0;
+	normalizingNewLines = false;
+	selection = 0;
 	ClearError();
 }
 
 TiXmlDocument::TiXmlDocument( const char * documentName ) : TiXmlNode( TiXmlNode::TINYXML_DOCUMENT )
 {
 	tabsize = 4;
+	lazyLocations = false;
 	useMicrosoftBOM = false;
+	arena = 0;
+	inSituBuffer = 0;
+	ownsInSituBuffer = false;
+	parsingInSitu = false;
+	pendingTerminator = 0;
+	normalizingNewLines = false;
+	selection = 0;
 	value = documentName;
 	ClearError();
 }
@@ -886,7 +1367,15 @@ TiXmlDocument::TiXmlDocument( const char * documentName ) : TiXmlNode( TiXmlNode
 TiXmlDocument::TiXmlDocument( const std::string& documentName ) : TiXmlNode( TiXmlNode::TINYXML_DOCUMENT )
 {
 	tabsize = 4;
+	lazyLocations = false;
 	useMicrosoftBOM = false;
+	arena = 0;
+	inSituBuffer = 0;
+	ownsInSituBuffer = false;
+	parsingInSitu = false;
+	pendingTerminator = 0;
+	normalizingNewLines = false;
+	selection = 0;
     value = documentName;
 	ClearError();
 }
@@ -895,10 +1384,152 @@ TiXmlDocument::TiXmlDocument( const std::string& documentName ) : TiXmlNode( TiX
 
 TiXmlDocument::TiXmlDocument( const TiXmlDocument& copy ) : TiXmlNode( TiXmlNode::TINYXML_DOCUMENT )
 {
+	arena = 0;
+	inSituBuffer = 0;
+	ownsInSituBuffer = false;
+	parsingInSitu = false;
+	pendingTerminator = 0;
+	normalizingNewLines = false;
+	selection = 0;
 	copy.CopyTo( this );
 }
 
 
+TiXmlDocument::~TiXmlDocument()
+{
+	// The children have to go before the arena they live in.
+	Clear();
+	delete arena;
+	ClearKeepPaths();
+}
+
+
+void TiXmlDocument::SetUseArena( bool useArena, size_t blockSize )
+{
+	Clear();
+	delete arena;
+	arena = useArena ? new TiXmlArena( blockSize ) : 0;
+}
+
+
+void TiXmlDocument::Clear()
+{
+	TiXmlNode::Clear();
+	if ( arena )
+		arena->Reset();
+	if ( ownsInSituBuffer )
+		delete [] inSituBuffer;
+	inSituBuffer = 0;
+	ownsInSituBuffer = false;
+}
+
+
+const char* TiXmlDocument::ParseInSitu( char* xml, TiXmlEncoding encoding, bool adoptBuffer )
+{
+	Clear();
+	inSituBuffer = xml;
+	ownsInSituBuffer = adoptBuffer;
+
+	// Stamp() walks over the input, which the parse changes.
+	int savedTabsize = tabsize;
+	tabsize = 0;
+	#ifndef TIXML_USE_STL
+	parsingInSitu = true;
+	#endif
+
+	const char* result = Parse( xml, 0, encoding );
+
+	if ( pendingTerminator )
+		*pendingTerminator = 0;
+	pendingTerminator = 0;
+	parsingInSitu = false;
+	tabsize = savedTabsize;
+	return result;
+}
+
+
+TIXML_STRING* TiXmlDocument::ParseBuffer( TIXML_STRING* target )
+{
+	#ifndef TIXML_USE_STL
+	if ( arena || parsingInSitu )
+		return &parseBuffer;
+	#endif
+	return target;
+}
+
+
+void TiXmlDocument::StoreParsed( TIXML_STRING* target, TIXML_STRING* parsed, const char* source, const char* p )
+{
+	#ifndef TIXML_USE_STL
+	if ( parsed == target )
+		return;
+
+	size_t len = parsed->length();
+	if ( parsingInSitu )
+	{
+		// A null p means the parse failed, and won't read anything more.
+		if ( pendingTerminator && ( !p || pendingTerminator < p ) )
+		{
+			*pendingTerminator = 0;
+			pendingTerminator = 0;
+		}
+		if ( !len )
+		{
+			target->clear();
+			return;
+		}
+
+		// The decoded string is never longer than its source, which has been read.
+		// Its terminator may land on the character at p though (the '<' after a
+		// text, for example), which then has to wait until the parser moved on.
+		char* dest = const_cast<char*>( source );
+		memcpy( dest, parsed->data(), len );
+		target->borrow( dest, len );
+		if ( !p || dest + len < p )
+		{
+			dest[len] = 0;
+		}
+		else
+		{
+			assert( !pendingTerminator );
+			pendingTerminator = dest + len;
+		}
+	}
+	else if ( len > TIXML_STRING::local_capacity() )
+	{
+		target->assign_external( arena->Alloc( TIXML_STRING::external_size( len ) ), parsed->data(), len );
+	}
+	else if ( len )
+	{
+		// Short enough to live in the string itself.
+		target->assign( parsed->data(), len );
+	}
+	else
+	{
+		target->clear();
+	}
+	#else
+	(void) target;
+	(void) parsed;
+	(void) source;
+	(void) p;
+	#endif
+}
+
+
+const char* TiXmlDocument::StoreName( TIXML_STRING* target, TIXML_STRING* parsed, const char* source, const char* p )
+{
+	// In-situ, the name stays in the input like everything else.
+	if ( parsingInSitu )
+	{
+		StoreParsed( target, parsed, source, p );
+		return TiXmlNameTable::Intern( target->data(), target->length() );
+	}
+	return InternName( target, *parsed );
+}
+
+
+
 void TiXmlDocument::operator=( const TiXmlDocument& copy )
 {
 	Clear();
@@ -950,6 +1581,10 @@ bool TiXmlDocument::LoadFile( FILE* file, TiXmlEncoding encoding )
 	Clear();
 	location.Clear();
 
+	// Parse the file where it is, if it can be mapped.
+	if ( ParseMappedFile( file, encoding ) )
+		return !Error();
+
 	// Get the file size, so we can pre-allocate the string. HUGE speed impact.
 	long length = 0;
 	fseek( file, 0, SEEK_END );
@@ -1036,9 +1671,54 @@ bool TiXmlDocument::LoadFile( FILE* file, TiXmlEncoding encoding )
 }
 
 
-bool TiXmlDocument::SaveFile( const char * filename ) const
+
+bool TiXmlDocument::ParseMappedFile( FILE* file, TiXmlEncoding encoding )
 {
-	// The old c stuff lives on...
+	// Returns false if the file can't be mapped (a pipe, say), and has to be read.
+	#ifdef TIXML_MMAP
+	struct stat info;
+	int fd = fileno( file );
+	if ( fd < 0 || fstat( fd, &info ) != 0 || !S_ISREG( info.st_mode ) || info.st_size <= 0 )
+		return false;
+	if ( (off_t)(size_t) info.st_size != info.st_size )
+		return false;		// too big for the address space
+
+	// The parser needs a null terminator after the file. The rest of the last page
+	// of a mapping reads as zeros, but if the file fills its last page exactly there
+	// is no such byte: so map the file in to a zeroed region a page longer than it.
+	size_t length = (size_t) info.st_size;
+	size_t pageSize = (size_t) sysconf( _SC_PAGESIZE );
+	size_t mapLength = ( length / pageSize + 1 ) * pageSize;
+	void* region = mmap( 0, mapLength, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+	if ( region == MAP_FAILED )
+		return false;
+	if ( mmap( region, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0 ) == MAP_FAILED )
+	{
+		munmap( region, mapLength );
+		return false;
+	}
+	#ifdef MADV_SEQUENTIAL
+	madvise( region, length, MADV_SEQUENTIAL );
+	#endif
+
+	// The file isn't normalized, as LoadFile() does for a buffer: the parser
+	// reads CR and CR+LF as LF instead.
+	normalizingNewLines = true;
+	Parse( (const char*) region, 0, encoding );
+	normalizingNewLines = false;
+
+	munmap( region, mapLength );
+	return true;
+	#else
+	(void) file;
+	(void) encoding;
+	return false;
+	#endif
+}
+
+bool TiXmlDocument::SaveFile( const char * filename ) const
+{
+	// The old c stuff lives on...
 	FILE* fp = TiXmlFOpen( filename, "w" );
 	if ( fp )
 	{
@@ -1075,9 +1755,14 @@ void TiXmlDocument::CopyTo( TiXmlDocument* target ) const
 	target->errorId = errorId;
 	target->errorDesc = errorDesc;
 	target->tabsize = tabsize;
+	target->lazyLocations = lazyLocations;
 	target->errorLocation = errorLocation;
 	target->useMicrosoftBOM = useMicrosoftBOM;
 
+	target->ClearKeepPaths();
+	for ( int i = 0; i < KeepPaths(); ++i )
+		target->AddKeepPath( KeepPath( i ) );
+
 	TiXmlNode* node = 0;
 	for ( node = firstChild; node; node = node->NextSibling() )
 	{
@@ -1202,6 +1887,29 @@ int TiXmlAttribute::QueryDoubleValue( double* dval ) const
 	return TIXML_WRONG_TYPE;
 }
 
+void TiXmlAttribute::SetName( const char* _name )
+{
+	// The set indexes attributes by name, so it has to hear about a rename.
+	if ( set )
+		set->Unindex( this );
+	name = _name;
+	symbol = InternName( &name, name );
+	if ( set )
+		set->Index( this );
+}
+
+#ifdef TIXML_USE_STL
+void TiXmlAttribute::SetName( const std::string& _name )
+{
+	if ( set )
+		set->Unindex( this );
+	name = _name;
+	symbol = InternName( &name, name );
+	if ( set )
+		set->Index( this );
+}
+#endif
+
 void TiXmlAttribute::SetIntValue( int _value )
 {
 	char buf [64];
@@ -1454,6 +2162,9 @@ TiXmlAttributeSet::TiXmlAttributeSet()
 {
 	sentinel.next = &sentinel;
 	sentinel.prev = &sentinel;
+	index = 0;
+	indexMask = 0;
+	count = 0;
 }
 
 
@@ -1461,6 +2172,7 @@ TiXmlAttributeSet::~TiXmlAttributeSet()
 {
 	assert( sentinel.next == &sentinel );
 	assert( sentinel.prev == &sentinel );
+	delete [] index;
 }
 
 
@@ -1477,36 +2189,127 @@ void TiXmlAttributeSet::Add( TiXmlAttribute* addMe )
 
 	sentinel.prev->next = addMe;
 	sentinel.prev      = addMe;
+
+	addMe->set = this;
+	++count;
+	if ( index )
+		Index( addMe );
+	else if ( count > INDEX_MIN )
+		Rehash( 4 * INDEX_MIN );
 }
 
 void TiXmlAttributeSet::Remove( TiXmlAttribute* removeMe )
 {
-	TiXmlAttribute* node;
+	if ( removeMe->set != this )
+	{
+		assert( 0 );		// we tried to remove a non-linked attribute.
+		return;
+	}
+
+	Unindex( removeMe );
+	removeMe->prev->next = removeMe->next;
+	removeMe->next->prev = removeMe->prev;
+	removeMe->next = 0;
+	removeMe->prev = 0;
+	removeMe->set = 0;
+	--count;
+}
+
+
+TiXmlAttribute* TiXmlAttributeSet::FindSymbol( const char* symbol ) const
+{
+	if ( !symbol )
+		return 0;
 
-	for( node = sentinel.next; node != &sentinel; node = node->next )
+	if ( index )
 	{
-		if ( node == removeMe )
+		for( unsigned i = Slot( symbol ); index[i]; i = ( i + 1 ) & indexMask )
 		{
-			node->prev->next = node->next;
-			node->next->prev = node->prev;
-			node->next = 0;
-			node->prev = 0;
-			return;
+			if ( index[i]->symbol == symbol )
+				return index[i];
 		}
+		return 0;
+	}
+
+	for( TiXmlAttribute* node = sentinel.next; node != &sentinel; node = node->next )
+	{
+		if ( node->symbol == symbol )
+			return node;
 	}
-	assert( 0 );		// we tried to remove a non-linked attribute.
+	return 0;
 }
 
 
-#ifdef TIXML_USE_STL
-TiXmlAttribute* TiXmlAttributeSet::Find( const std::string& name ) const
+void TiXmlAttributeSet::Index( TiXmlAttribute* attribute )
+{
+	if ( !index )
+		return;
+
+	// Keep the table at most half full, so probe runs stay short.
+	if ( count * 2 > indexMask + 1 )
+	{
+		Rehash( ( indexMask + 1 ) * 2 );
+		return;
+	}
+
+	unsigned i = Slot( attribute->symbol );
+	while ( index[i] )
+		i = ( i + 1 ) & indexMask;
+	index[i] = attribute;
+}
+
+
+void TiXmlAttributeSet::Unindex( TiXmlAttribute* attribute )
+{
+	if ( !index )
+		return;
+
+	unsigned i = Slot( attribute->symbol );
+	while ( index[i] != attribute )
+	{
+		assert( index[i] );
+		i = ( i + 1 ) & indexMask;
+	}
+	index[i] = 0;
+
+	// Close the gap: pull back any later entry in the run that can't be
+	// found from its home slot any more.
+	for( unsigned j = ( i + 1 ) & indexMask; index[j]; j = ( j + 1 ) & indexMask )
+	{
+		unsigned home = Slot( index[j]->symbol );
+		bool reachable = ( i <= j ) ? ( i < home && home <= j ) : ( i < home || home <= j );
+		if ( !reachable )
+		{
+			index[i] = index[j];
+			index[j] = 0;
+			i = j;
+		}
+	}
+}
+
+
+void TiXmlAttributeSet::Rehash( unsigned size )
 {
+	delete [] index;
+	index = new TiXmlAttribute*[ size ];
+	indexMask = size - 1;
+	for( unsigned i=0; i<size; ++i )
+		index[i] = 0;
+
 	for( TiXmlAttribute* node = sentinel.next; node != &sentinel; node = node->next )
 	{
-		if ( node->name == name )
-			return node;
+		unsigned i = Slot( node->symbol );
+		while ( index[i] )
+			i = ( i + 1 ) & indexMask;
+		index[i] = node;
 	}
-	return 0;
+}
+
+
+#ifdef TIXML_USE_STL
+TiXmlAttribute* TiXmlAttributeSet::Find( const std::string& name ) const
+{
+	return FindSymbol( TiXmlNameTable::Find( name.data(), name.length() ) );
 }
 
 TiXmlAttribute* TiXmlAttributeSet::FindOrCreate( const std::string& _name )
@@ -1514,8 +2317,8 @@ TiXmlAttribute* TiXmlAttributeSet::FindOrCreate( const std::string& _name )
 	TiXmlAttribute* attrib = Find( _name );
 	if ( !attrib ) {
 		attrib = new TiXmlAttribute();
-		Add( attrib );
 		attrib->SetName( _name );
+		Add( attrib );
 	}
 	return attrib;
 }
@@ -1524,12 +2327,7 @@ TiXmlAttribute* TiXmlAttributeSet::FindOrCreate( const std::string& _name )
 
 TiXmlAttribute* TiXmlAttributeSet::Find( const char* name ) const
 {
-	for( TiXmlAttribute* node = sentinel.next; node != &sentinel; node = node->next )
-	{
-		if ( strcmp( node->name.c_str(), name ) == 0 )
-			return node;
-	}
-	return 0;
+	return FindSymbol( TiXmlNameTable::Find( name ) );
 }
 
 
@@ -1538,8 +2336,8 @@ TiXmlAttribute* TiXmlAttributeSet::FindOrCreate( const char* _name )
 	TiXmlAttribute* attrib = Find( _name );
 	if ( !attrib ) {
 		attrib = new TiXmlAttribute();
-		Add( attrib );
 		attrib->SetName( _name );
+		Add( attrib );
 	}
 	return attrib;
 }
@@ -1706,26 +2504,258 @@ TiXmlHandle TiXmlHandle::ChildElement( const char* value, int count ) const
 }
 
 
-bool TiXmlPrinter::VisitEnter( const TiXmlDocument& )
+TiXmlHandle TiXmlHandle::Path( const TiXmlPath& path ) const
+{
+	return TiXmlHandle( node ? path.First( node ) : 0 );
+}
+
+
+TiXmlPath::TiXmlPath( const char* path )
+{
+	Compile( path );
+}
+
+
+#ifdef TIXML_USE_STL
+TiXmlPath::TiXmlPath( const std::string& path )
+{
+	Compile( path.c_str() );
+}
+#endif
+
+
+TiXmlPath::TiXmlPath( const TiXmlPath& copy )
+{
+	steps = 0;
+	Copy( copy );
+}
+
+
+void TiXmlPath::operator=( const TiXmlPath& copy )
+{
+	if ( &copy != this )
+		Copy( copy );
+}
+
+
+TiXmlPath::~TiXmlPath()
+{
+	delete [] steps;
+}
+
+
+void TiXmlPath::Copy( const TiXmlPath& copy )
+{
+	delete [] steps;
+	steps = copy.count ? new Step[ copy.count ] : 0;
+	for( int i=0; i<copy.count; ++i )
+		steps[i] = copy.steps[i];
+	count = copy.count;
+	absolute = copy.absolute;
+	errorOffset = copy.errorOffset;
+}
+
+
+void TiXmlPath::Compile( const char* path )
+{
+	steps = 0;
+	count = 0;
+	errorOffset = -1;
+
+	const char* p = path;
+	absolute = ( *p == '/' );
+	if ( absolute )
+		++p;
+
+	int size = 1;
+	for( const char* q = p; *q; ++q )
+	{
+		if ( *q == '/' )
+			++size;
+	}
+	steps = new Step[ size ];
+
+	while ( true )
+	{
+		const char* name = p;
+		while ( *p && *p != '/' && *p != '[' && *p != ']' && !TiXmlBase::IsWhiteSpace( *p ) )
+			++p;
+		if ( p == name )
+			break;
+
+		// A path only looks names up, so it doesn't add them to the table.
+		Step& step = steps[count];
+		step.symbol = 0;
+		if ( p - name != 1 || *name != '*' )
+		{
+			step.name.assign( name, p - name );
+			step.symbol = TiXmlNameTable::Find( name, p - name );
+		}
+		step.index = 0;
+		if ( *p == '[' )
+		{
+			++p;
+			if ( *p == '*' )
+			{
+				step.index = ALL;
+				++p;
+			}
+			else if ( *p >= '0' && *p <= '9' )
+			{
+				while ( *p >= '0' && *p <= '9' && step.index < 100000000 )
+				{
+					step.index = step.index * 10 + ( *p - '0' );
+					++p;
+				}
+			}
+			else
+			{
+				break;
+			}
+			if ( *p != ']' )
+				break;
+			++p;
+		}
+		++count;
+
+		if ( !*p )
+			return;
+		if ( *p != '/' )
+			break;
+		++p;
+	}
+
+	// Only get here on an error.
+	errorOffset = (int)( p - path );
+	count = 0;
+}
+
+
+TiXmlElement* TiXmlPath::First( TiXmlNode* from ) const
+{
+	TiXmlPathIterator it( *this, from );
+	return it.Element();
+}
+
+
+TiXmlElement* TiXmlPath::Match( int level, TiXmlNode* parent, TiXmlElement* previous ) const
+{
+	const Step& step = steps[level];
+	const char* symbol = step.Symbol();
+	TiXmlElement* element;
+
+	if ( !symbol && !step.Any() )
+		return 0;	// no element has the name
+
+	if ( step.index != ALL )
+	{
+		// A single match, so there is nothing after the previous one.
+		if ( previous )
+			return 0;
+		// The symbol is the name itself, and this lookup can use the child index.
+		if ( step.index == 0 && symbol )
+			return parent->FirstChildElement( symbol );
+
+		int skip = step.index;
+		for( element = parent->FirstChildElement(); element; element = element->NextSiblingElement() )
+		{
+			if ( ( !symbol || element->Symbol() == symbol ) && skip-- == 0 )
+				return element;
+		}
+		return 0;
+	}
+
+	for(	element = previous ? previous->NextSiblingElement() : parent->FirstChildElement();
+			element;
+			element = element->NextSiblingElement() )
+	{
+		if ( !symbol || element->Symbol() == symbol )
+			return element;
+	}
+	return 0;
+}
+
+
+TiXmlPathIterator::TiXmlPathIterator( const TiXmlPath& _path, TiXmlNode* from ) : path( _path )
 {
+	root = ( from && path.absolute ) ? from->GetDocument() : from;
+	at = path.count ? new TiXmlElement*[ path.count ] : 0;
+	for( int i=0; i<path.count; ++i )
+		at[i] = 0;
+	current = 0;
+	if ( root && path.count )
+		Seek( 0 );
+}
+
+
+TiXmlPathIterator::~TiXmlPathIterator()
+{
+	delete [] at;
+}
+
+
+void TiXmlPathIterator::Next()
+{
+	if ( current )
+		Seek( path.count - 1 );
+}
+
+
+void TiXmlPathIterator::Seek( int level )
+{
+	// Depth first: find the next match of a step, and go down to the next step
+	// from there. A step with no more matches goes back up to the one before.
+	while ( level >= 0 )
+	{
+		TiXmlNode* parent = level ? at[level-1] : root;
+		TiXmlElement* match = path.Match( level, parent, at[level] );
+		at[level] = match;
+		if ( !match )
+		{
+			--level;
+		}
+		else if ( level == path.count - 1 )
+		{
+			current = match;
+			return;
+		}
+		else
+		{
+			++level;
+		}
+	}
+	current = 0;
+}
+
+
+bool TiXmlPrinter::VisitEnter( const TiXmlDocument& doc )
+{
+	if ( !sink )
+		Reserve( buffer.size() + EstimateSize( doc ) );
 	return true;
 }
 
 bool TiXmlPrinter::VisitExit( const TiXmlDocument& )
 {
-	return true;
+	return Flush();
 }
 
 bool TiXmlPrinter::VisitEnter( const TiXmlElement& element, const TiXmlAttribute* firstAttribute )
 {
 	DoIndent();
 	buffer += "<";
-	buffer += element.Value();
+	buffer += element.ValueTStr();
 
 	for( const TiXmlAttribute* attrib = firstAttribute; attrib; attrib = attrib->Next() )
 	{
+		// As TiXmlAttribute::Print(), without the copies.
+		const char* quote = attrib->ValueTStr().find( '\"' ) == TIXML_STRING::npos ? "\"" : "'";
 		buffer += " ";
-		attrib->Print( 0, 0, &buffer );
+		TiXmlBase::EncodeString( attrib->NameTStr(), &buffer );
+		buffer += "=";
+		buffer += quote;
+		TiXmlBase::EncodeString( attrib->ValueTStr(), &buffer );
+		buffer += quote;
 	}
 
 	if ( !element.FirstChild() ) 
@@ -1749,7 +2779,7 @@ bool TiXmlPrinter::VisitEnter( const TiXmlElement& element, const TiXmlAttribute
 		}
 	}
 	++depth;	
-	return true;
+	return Drain();
 }
 
 
@@ -1771,11 +2801,11 @@ bool TiXmlPrinter::VisitExit( const TiXmlElement& element )
 			DoIndent();
 		}
 		buffer += "</";
-		buffer += element.Value();
+		buffer += element.ValueTStr();
 		buffer += ">";
 		DoLineBreak();
 	}
-	return true;
+	return Drain();
 }
 
 
@@ -1785,25 +2815,21 @@ bool TiXmlPrinter::Visit( const TiXmlText& text )
 	{
 		DoIndent();
 		buffer += "<![CDATA[";
-		buffer += text.Value();
+		buffer += text.ValueTStr();
 		buffer += "]]>";
 		DoLineBreak();
 	}
 	else if ( simpleTextPrint )
 	{
-		TIXML_STRING str;
-		TiXmlBase::EncodeString( text.ValueTStr(), &str );
-		buffer += str;
+		TiXmlBase::EncodeString( text.ValueTStr(), &buffer );
 	}
 	else
 	{
 		DoIndent();
-		TIXML_STRING str;
-		TiXmlBase::EncodeString( text.ValueTStr(), &str );
-		buffer += str;
+		TiXmlBase::EncodeString( text.ValueTStr(), &buffer );
 		DoLineBreak();
 	}
-	return true;
+	return Drain();
 }
 
 
@@ -1812,7 +2838,7 @@ bool TiXmlPrinter::Visit( const TiXmlDeclaration& declaration )
 	DoIndent();
 	declaration.Print( 0, 0, &buffer );
 	DoLineBreak();
-	return true;
+	return Drain();
 }
 
 
@@ -1820,10 +2846,10 @@ bool TiXmlPrinter::Visit( const TiXmlComment& comment )
 {
 	DoIndent();
 	buffer += "<!--";
-	buffer += comment.Value();
+	buffer += comment.ValueTStr();
 	buffer += "-->";
 	DoLineBreak();
-	return true;
+	return Drain();
 }
 
 
@@ -1831,9 +2857,880 @@ bool TiXmlPrinter::Visit( const TiXmlUnknown& unknown )
 {
 	DoIndent();
 	buffer += "<";
-	buffer += unknown.Value();
+	buffer += unknown.ValueTStr();
 	buffer += ">";
 	DoLineBreak();
+	return Drain();
+}
+
+
+void TiXmlPrinter::SetSink( TiXmlSink* _sink, size_t bufferSize )
+{
+	sink = _sink;
+	flushSize = bufferSize;
+	error = false;
+	if ( sink )
+		buffer.reserve( flushSize + flushSize / 2 );
+}
+
+
+bool TiXmlPrinter::Flush()
+{
+	if ( !sink )
+		return true;
+	if ( !error && buffer.size() > 0 && !sink->Write( buffer.c_str(), buffer.size() ) )
+		error = true;
+	buffer.erase();
+	return !error;
+}
+
+
+size_t TiXmlPrinter::Estimate( const TiXmlNode& node, int level ) const
+{
+	// Each node takes a line of its own: the indent, and the line break.
+	size_t line = indent.length() * level + lineBreak.length();
+	size_t size = 0;
+
+	switch ( node.Type() )
+	{
+		case TiXmlNode::TINYXML_DOCUMENT:
+			for( const TiXmlNode* child = node.FirstChild(); child; child = child->NextSibling() )
+				size += Estimate( *child, level );
+			return size;
+
+		case TiXmlNode::TINYXML_ELEMENT:
+		{
+			// <name a="v">  </name>, each on a line
+			const TiXmlElement* element = node.ToElement();
+			size = 2 * ( line + element->ValueTStr().length() ) + 5;
+			for( const TiXmlAttribute* attrib = element->FirstAttribute(); attrib; attrib = attrib->Next() )
+				size += attrib->NameTStr().length() + attrib->ValueTStr().length() + 4;
+			for( const TiXmlNode* child = node.FirstChild(); child; child = child->NextSibling() )
+				size += Estimate( *child, level + 1 );
+			return size;
+		}
+
+		case TiXmlNode::TINYXML_TEXT:
+			return line + node.ValueTStr().length() + ( node.ToText()->CDATA() ? 12 : 0 );
+
+		case TiXmlNode::TINYXML_COMMENT:
+			return line + node.ValueTStr().length() + 7;
+
+		case TiXmlNode::TINYXML_DECLARATION:
+		{
+			const TiXmlDeclaration* declaration = node.ToDeclaration();
+			return line + strlen( declaration->Version() ) + strlen( declaration->Encoding() )
+						+ strlen( declaration->Standalone() ) + 46;
+		}
+
+		default:
+			return line + node.ValueTStr().length() + 2;
+	}
+}
+
+
+
+bool TiXmlFileSink::Write( const char* data, size_t length )
+{
+	return fwrite( data, 1, length, file ) == length;
+}
+
+
+bool TiXmlFdSink::Write( const char* data, size_t length )
+{
+	while ( length > 0 )
+	{
+		#if defined( _WIN32 )
+			unsigned chunk = length > 0x40000000 ? 0x40000000 : (unsigned) length;
+			int written = _write( fd, data, chunk );
+		#else
+			ssize_t written = write( fd, data, length );
+		#endif
+		if ( written < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+			return false;
+		}
+		data += written;
+		length -= written;
+	}
 	return true;
 }
 
+
+TiXmlWriter::TiXmlWriter( TiXmlSink* _sink, size_t _bufferSize )
+	: sink( _sink ), buffer( 0 ), bufferSize( _bufferSize ), used( 0 ), depth( 0 ),
+	  inTag( false ), inlineText( false ), error( false ),
+	  openElements(), indent( "    " ), lineBreak( "\n" )
+{
+	buffer = new char[ bufferSize ? bufferSize : 1 ];
+}
+
+
+TiXmlWriter::~TiXmlWriter()
+{
+	Flush();
+	delete [] buffer;
+}
+
+
+bool TiXmlWriter::Flush()
+{
+	if ( !error && used > 0 && !sink->Write( buffer, used ) )
+		error = true;
+	used = 0;
+	return !error;
+}
+
+
+void TiXmlWriter::Put( const char* data, size_t length )
+{
+	if ( length > bufferSize - used )
+	{
+		Flush();
+		if ( length > bufferSize )
+		{
+			// Too big to buffer; straight to the sink.
+			if ( !error && !sink->Write( data, length ) )
+				error = true;
+			return;
+		}
+	}
+	if ( error )
+		return;
+	memcpy( buffer + used, data, length );
+	used += length;
+}
+
+
+void TiXmlWriter::PutEncoded( const char* str )
+{
+	const char* end = str + strlen( str );
+	char scratch[ 8 ];
+
+	while ( str < end )
+	{
+		const char* replacement = 0;
+		size_t replacementLength = 0;
+		const char* run = TiXmlBase::EncodeRun( str, end, &replacement, &replacementLength, scratch );
+
+		Put( str, run - str );
+		if ( run == end )
+			break;
+		Put( replacement, replacementLength );
+		str = run + 1;
+	}
+}
+
+
+void TiXmlWriter::DoIndent()
+{
+	for( int i=0; i<depth; ++i )
+		Put( indent );
+}
+
+
+void TiXmlWriter::StartChild()
+{
+	// Whatever comes next goes on a line of its own.
+	if ( inTag )
+	{
+		Put( ">" );
+		Put( lineBreak );
+	}
+	else if ( inlineText )
+	{
+		Put( lineBreak );
+	}
+	inTag = false;
+	inlineText = false;
+}
+
+
+bool TiXmlWriter::Declaration( const char* version, const char* encoding, const char* standalone )
+{
+	if ( error )
+		return false;
+	StartChild();
+	DoIndent();
+	Put( "<?xml " );
+	if ( version && *version ) {
+		Put( "version=\"" ); Put( version ); Put( "\" " );
+	}
+	if ( encoding && *encoding ) {
+		Put( "encoding=\"" ); Put( encoding ); Put( "\" " );
+	}
+	if ( standalone && *standalone ) {
+		Put( "standalone=\"" ); Put( standalone ); Put( "\" " );
+	}
+	Put( "?>" );
+	Put( lineBreak );
+	return !error;
+}
+
+
+bool TiXmlWriter::StartElement( const char* name )
+{
+	if ( error || !name || !*name )
+		return false;
+	StartChild();
+	DoIndent();
+	Put( "<" );
+	Put( name );
+	openElements += name;
+	openElements += '\0';
+	++depth;
+	inTag = true;
+	return !error;
+}
+
+
+bool TiXmlWriter::Attribute( const char* name, const char* value )
+{
+	if ( error || !inTag || !name || !value )
+		return false;
+	// As TiXmlAttribute::Print(): single quotes if the value has a double quote.
+	const char* quote = strchr( value, '\"' ) ? "'" : "\"";
+	Put( " " );
+	PutEncoded( name );
+	Put( "=" );
+	Put( quote );
+	PutEncoded( value );
+	Put( quote );
+	return !error;
+}
+
+
+bool TiXmlWriter::Attribute( const char* name, int value )
+{
+	char buf[64];
+	#if defined(TIXML_SNPRINTF)		
+		TIXML_SNPRINTF( buf, sizeof(buf), "%d", value );
+	#else
+		sprintf( buf, "%d", value );
+	#endif
+	return Attribute( name, buf );
+}
+
+
+bool TiXmlWriter::DoubleAttribute( const char* name, double value )
+{
+	char buf[256];
+	#if defined(TIXML_SNPRINTF)		
+		TIXML_SNPRINTF( buf, sizeof(buf), "%g", value );
+	#else
+		sprintf( buf, "%g", value );
+	#endif
+	return Attribute( name, buf );
+}
+
+
+bool TiXmlWriter::Text( const char* text )
+{
+	if ( error || depth == 0 || !text )
+		return false;
+	if ( inTag )
+	{
+		// Text right after the start tag stays on its line, as
+		// TiXmlPrinter prints an element with only text in it.
+		Put( ">" );
+		inTag = false;
+		inlineText = true;
+		PutEncoded( text );
+	}
+	else if ( inlineText )
+	{
+		PutEncoded( text );
+	}
+	else
+	{
+		DoIndent();
+		PutEncoded( text );
+		Put( lineBreak );
+	}
+	return !error;
+}
+
+
+bool TiXmlWriter::CData( const char* text )
+{
+	if ( error || depth == 0 || !text )
+		return false;
+	StartChild();
+	DoIndent();
+	Put( "<![CDATA[" );
+	Put( text );
+	Put( "]]>" );
+	Put( lineBreak );
+	return !error;
+}
+
+
+bool TiXmlWriter::Comment( const char* text )
+{
+	if ( error || !text )
+		return false;
+	StartChild();
+	DoIndent();
+	Put( "<!--" );
+	Put( text );
+	Put( "-->" );
+	Put( lineBreak );
+	return !error;
+}
+
+
+bool TiXmlWriter::EndElement()
+{
+	if ( error || depth == 0 )
+		return false;
+
+	size_t end = openElements.length() - 1;
+	size_t begin = end;
+	while ( begin > 0 && openElements[begin-1] )
+		--begin;
+
+	--depth;
+	if ( inTag )
+	{
+		Put( " />" );
+	}
+	else
+	{
+		if ( !inlineText )
+			DoIndent();
+		Put( "</" );
+		Put( openElements.c_str() + begin, end - begin );
+		Put( ">" );
+	}
+	Put( lineBreak );
+	inTag = false;
+	inlineText = false;
+	openElements.assign( openElements.c_str(), begin );
+	return !error;
+}
+
+
+namespace {
+
+// Builds the arrays of a snapshot. The nodes are in document order, so the
+// children and the next sibling of a node always come after it.
+class TiXmlSnapshotWriter
+{
+public:
+	TiXmlSnapshotWriter( const TiXmlNode& top )
+		: nodes( 0 ), attributes( 0 ), nodeCount( 0 ), attributeCount( 0 ),
+		  nodesUsed( 0 ), attributesUsed( 0 ), symbols( 0 ), symbolOffsets( 0 ), symbolMask( 0 )
+	{
+		Count( top );
+		nodes = new TiXmlSnapshot::Node[ nodeCount ];
+		attributes = new TiXmlSnapshot::Attribute[ attributeCount ? attributeCount : 1 ];
+
+		// Names are interned (see TiXmlNameTable), so each is written once,
+		// found by its symbol. There are no more names than nodes and attributes.
+		size_t slots = 16;
+		while ( slots < 2 * ( (size_t) nodeCount + attributeCount ) )
+			slots *= 2;
+		symbolMask = slots - 1;
+		symbols = new const char*[ slots ];
+		symbolOffsets = new size_t[ slots ];
+		for( size_t i = 0; i < slots; ++i )
+			symbols[i] = 0;
+
+		Add( top, TiXmlSnapshot::NONE );
+	}
+
+	~TiXmlSnapshotWriter()
+	{
+		delete [] nodes;
+		delete [] attributes;
+		delete [] symbols;
+		delete [] symbolOffsets;
+	}
+
+	TiXmlSnapshot::Node* nodes;
+	TiXmlSnapshot::Attribute* attributes;
+	size_t nodeCount;
+	size_t attributeCount;
+	TIXML_STRING strings;
+
+private:
+	void Count( const TiXmlNode& node )
+	{
+		++nodeCount;
+		if ( node.ToElement() )
+		{
+			for( const TiXmlAttribute* attrib = node.ToElement()->FirstAttribute(); attrib; attrib = attrib->Next() )
+				++attributeCount;
+		}
+		else if ( node.ToDeclaration() )
+		{
+			attributeCount += 3;
+		}
+		for( const TiXmlNode* child = node.FirstChild(); child; child = child->NextSibling() )
+			Count( *child );
+	}
+
+	size_t String( const char* str, size_t length )
+	{
+		size_t offset = strings.length();
+		strings.append( str, length );
+		strings += '\0';
+		return offset;
+	}
+
+	size_t Name( const char* symbol, const TIXML_STRING& name )
+	{
+		if ( !symbol )
+			return String( name.c_str(), name.length() );
+		size_t i = (size_t) symbol & symbolMask;
+		while ( symbols[i] && symbols[i] != symbol )
+			i = ( i + 1 ) & symbolMask;
+		if ( !symbols[i] )
+		{
+			symbols[i] = symbol;
+			symbolOffsets[i] = String( name.c_str(), name.length() );
+		}
+		return symbolOffsets[i];
+	}
+
+	void AddAttribute( TiXmlSnapshot::Node& node, size_t name, size_t value )
+	{
+		attributes[ attributesUsed ].name = (unsigned) name;
+		attributes[ attributesUsed ].value = (unsigned) value;
+		++attributesUsed;
+		++node.attributeCount;
+	}
+
+	unsigned Add( const TiXmlNode& node, unsigned parent )
+	{
+		unsigned index = (unsigned) nodesUsed++;
+		TiXmlSnapshot::Node& n = nodes[ index ];
+		n.type = node.Type();
+		n.parent = parent;
+		n.firstChild = TiXmlSnapshot::NONE;
+		n.nextSibling = TiXmlSnapshot::NONE;
+		n.firstAttribute = (unsigned) attributesUsed;
+		n.attributeCount = 0;
+
+		if ( node.ToElement() )
+		{
+			n.value = (unsigned) Name( node.Symbol(), node.ValueTStr() );
+			for( const TiXmlAttribute* attrib = node.ToElement()->FirstAttribute(); attrib; attrib = attrib->Next() )
+				AddAttribute( n, Name( attrib->Symbol(), attrib->NameTStr() ), String( attrib->Value(), attrib->ValueTStr().length() ) );
+		}
+		else
+		{
+			n.value = (unsigned) String( node.Value(), node.ValueTStr().length() );
+			if ( node.ToText() && node.ToText()->CDATA() )
+				n.type |= TiXmlSnapshot::CDATA_FLAG;
+			if ( node.ToDeclaration() )
+			{
+				const TiXmlDeclaration* declaration = node.ToDeclaration();
+				const char* names[] = { "version", "encoding", "standalone" };
+				const char* values[] = { declaration->Version(), declaration->Encoding(), declaration->Standalone() };
+				for( int i = 0; i < 3; ++i )
+				{
+					TIXML_STRING name( names[i] );
+					AddAttribute( n, Name( TiXmlNameTable::Intern( names[i] ), name ), String( values[i], strlen( values[i] ) ) );
+				}
+			}
+		}
+
+		unsigned previous = TiXmlSnapshot::NONE;
+		for( const TiXmlNode* child = node.FirstChild(); child; child = child->NextSibling() )
+		{
+			unsigned c = Add( *child, index );
+			if ( previous == TiXmlSnapshot::NONE )
+				nodes[ index ].firstChild = c;
+			else
+				nodes[ previous ].nextSibling = c;
+			previous = c;
+		}
+		return index;
+	}
+
+	size_t nodesUsed;
+	size_t attributesUsed;
+	const char** symbols;
+	size_t* symbolOffsets;
+	size_t symbolMask;
+};
+
+}	// namespace
+
+
+/*static*/ bool TiXmlSnapshot::Write( const TiXmlNode& node, TIXML_STRING* out )
+{
+	TiXmlSnapshotWriter writer( node );
+	if (    writer.nodeCount >= NONE
+		 || writer.attributeCount >= NONE
+		 || writer.strings.length() >= NONE )
+		return false;
+
+	Header header;
+	memcpy( header.magic, "TiXmlSn1", 8 );
+	header.byteOrder = 0x01020304;
+	header.nodeCount = (unsigned) writer.nodeCount;
+	header.attributeCount = (unsigned) writer.attributeCount;
+	header.stringSize = (unsigned) writer.strings.length();
+
+	out->reserve( out->length() + sizeof( header ) + writer.nodeCount * sizeof( Node )
+				  + writer.attributeCount * sizeof( Attribute ) + writer.strings.length() );
+	out->append( (const char*) &header, sizeof( header ) );
+	out->append( (const char*) writer.nodes, writer.nodeCount * sizeof( Node ) );
+	out->append( (const char*) writer.attributes, writer.attributeCount * sizeof( Attribute ) );
+	out->append( writer.strings.c_str(), writer.strings.length() );
+	return true;
+}
+
+
+/*static*/ bool TiXmlSnapshot::SaveFile( const TiXmlNode& node, const char* filename )
+{
+	TIXML_STRING snapshot;
+	if ( !Write( node, &snapshot ) )
+		return false;
+	FILE* file = TiXmlFOpen( filename, "wb" );
+	if ( !file )
+		return false;
+	bool written = fwrite( snapshot.c_str(), 1, snapshot.length(), file ) == snapshot.length();
+	return fclose( file ) == 0 && written;
+}
+
+
+TiXmlSnapshot::TiXmlSnapshot()
+	: nodes( 0 ), attributes( 0 ), strings( 0 ), nodeCount( 0 ), attributeCount( 0 ),
+	  mapped( 0 ), mappedLength( 0 ), owned( 0 )
+{
+}
+
+
+TiXmlSnapshot::~TiXmlSnapshot()
+{
+	Close();
+}
+
+
+void TiXmlSnapshot::Close()
+{
+	#ifdef TIXML_MMAP
+	if ( mapped )
+		munmap( mapped, mappedLength );
+	#endif
+	delete [] owned;
+	mapped = 0;
+	mappedLength = 0;
+	owned = 0;
+	nodes = 0;
+	attributes = 0;
+	strings = 0;
+	nodeCount = 0;
+	attributeCount = 0;
+}
+
+
+bool TiXmlSnapshot::LoadFile( const char* filename )
+{
+	Close();
+	FILE* file = TiXmlFOpen( filename, "rb" );
+	if ( !file )
+		return false;
+
+	const void* data = 0;
+	size_t length = 0;
+
+	#ifdef TIXML_MMAP
+	struct stat info;
+	int fd = fileno( file );
+	if (    fd >= 0 && fstat( fd, &info ) == 0 && S_ISREG( info.st_mode ) && info.st_size > 0
+		 && (off_t)(size_t) info.st_size == info.st_size )
+	{
+		void* region = mmap( 0, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if ( region != MAP_FAILED )
+		{
+			mapped = region;
+			mappedLength = (size_t) info.st_size;
+			data = mapped;
+			length = mappedLength;
+		}
+	}
+	#endif
+
+	if ( !data )
+	{
+		// Can't be mapped: read it in.
+		long size = 0;
+		if ( fseek( file, 0, SEEK_END ) == 0 && ( size = ftell( file ) ) > 0 && fseek( file, 0, SEEK_SET ) == 0 )
+		{
+			owned = new char[ size ];
+			if ( fread( owned, 1, (size_t) size, file ) == (size_t) size )
+			{
+				data = owned;
+				length = (size_t) size;
+			}
+		}
+	}
+	fclose( file );
+
+	if ( !data || !Use( data, length ) )
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+
+bool TiXmlSnapshot::Attach( const void* data, size_t length )
+{
+	Close();
+	return Use( data, length );
+}
+
+
+bool TiXmlSnapshot::Use( const void* data, size_t length )
+{
+	// Everything is checked here, so that navigating can trust the indexes.
+	if ( !data || ( (size_t) data & 3 ) != 0 || length < sizeof( Header ) )
+		return false;
+	const Header* header = (const Header*) data;
+	if ( memcmp( header->magic, "TiXmlSn1", 8 ) != 0 || header->byteOrder != 0x01020304 )
+		return false;
+
+	size_t rest = length - sizeof( Header );
+	if ( header->nodeCount == 0 || header->nodeCount > rest / sizeof( Node ) )
+		return false;
+	rest -= header->nodeCount * sizeof( Node );
+	if ( header->attributeCount > rest / sizeof( Attribute ) )
+		return false;
+	rest -= header->attributeCount * sizeof( Attribute );
+	if ( header->stringSize == 0 || header->stringSize != rest )
+		return false;
+
+	const Node* n = (const Node*)( header + 1 );
+	const Attribute* a = (const Attribute*)( n + header->nodeCount );
+	const char* s = (const char*)( a + header->attributeCount );
+	unsigned count = header->nodeCount;
+	unsigned size = header->stringSize;
+	if ( s[ size - 1 ] != 0 )
+		return false;
+
+	// Parents come before, and children and siblings after, so there are no cycles.
+	// A child's parent, and a sibling's parent, must agree with the link to it,
+	// so no node is reached twice: navigating and CopyTo() see a tree.
+	for( unsigned i = 0; i < count; ++i )
+	{
+		unsigned type = n[i].type & ~(unsigned) CDATA_FLAG;
+		if (    type >= TiXmlNode::TINYXML_TYPECOUNT
+			 || ( type == TiXmlNode::TINYXML_DOCUMENT && i != 0 )
+			 || n[i].value >= size
+			 || ( i == 0 ? n[i].parent != NONE : n[i].parent >= i )
+			 || ( n[i].firstChild != NONE && ( n[i].firstChild <= i || n[i].firstChild >= count ) )
+			 || ( n[i].nextSibling != NONE && ( n[i].nextSibling <= i || n[i].nextSibling >= count ) )
+			 || ( n[i].firstChild != NONE && n[ n[i].firstChild ].parent != i )
+			 || ( n[i].nextSibling != NONE && n[ n[i].nextSibling ].parent != n[i].parent )
+			 || n[i].firstAttribute > header->attributeCount
+			 || n[i].attributeCount > header->attributeCount - n[i].firstAttribute )
+			return false;
+	}
+	for( unsigned i = 0; i < header->attributeCount; ++i )
+	{
+		if ( a[i].name >= size || a[i].value >= size )
+			return false;
+	}
+
+	nodes = n;
+	attributes = a;
+	strings = s;
+	nodeCount = count;
+	attributeCount = header->attributeCount;
+	return true;
+}
+
+
+TiXmlSnapshotNode TiXmlSnapshot::Root() const
+{
+	return nodeCount ? TiXmlSnapshotNode( this, 0 ) : TiXmlSnapshotNode();
+}
+
+
+bool TiXmlSnapshot::CopyTo( TiXmlDocument* doc ) const
+{
+	if ( !nodeCount )
+		return false;
+	doc->Clear();
+	doc->ClearError();
+	if ( ( nodes[0].type & ~(unsigned) CDATA_FLAG ) == TiXmlNode::TINYXML_DOCUMENT )
+	{
+		for( unsigned child = nodes[0].firstChild; child != NONE; child = nodes[ child ].nextSibling )
+			CopyNode( child, doc );
+	}
+	else
+	{
+		CopyNode( 0, doc );
+	}
+	return true;
+}
+
+
+void TiXmlSnapshot::CopyNode( unsigned index, TiXmlNode* parent ) const
+{
+	const Node& n = nodes[ index ];
+	TiXmlSnapshotNode source( this, index );
+	TiXmlNode* node = 0;
+
+	switch ( n.type & ~(unsigned) CDATA_FLAG )
+	{
+		case TiXmlNode::TINYXML_ELEMENT:
+		{
+			TiXmlElement* element = new TiXmlElement( source.Value() );
+			for( int i = 0; i < source.AttributeCount(); ++i )
+				element->SetAttribute( source.AttributeName( i ), source.AttributeValue( i ) );
+			node = element;
+			break;
+		}
+		case TiXmlNode::TINYXML_COMMENT:
+			node = new TiXmlComment( source.Value() );
+			break;
+		case TiXmlNode::TINYXML_UNKNOWN:
+			node = new TiXmlUnknown();
+			node->SetValue( source.Value() );
+			break;
+		case TiXmlNode::TINYXML_TEXT:
+		{
+			TiXmlText* text = new TiXmlText( source.Value() );
+			text->SetCDATA( source.CDATA() );
+			node = text;
+			break;
+		}
+		case TiXmlNode::TINYXML_DECLARATION:
+		{
+			const char* version = source.Attribute( "version" );
+			const char* encoding = source.Attribute( "encoding" );
+			const char* standalone = source.Attribute( "standalone" );
+			node = new TiXmlDeclaration( version ? version : "", encoding ? encoding : "", standalone ? standalone : "" );
+			break;
+		}
+		default:
+			return;
+	}
+
+	parent->LinkEndChild( node );
+	for( unsigned child = n.firstChild; child != NONE; child = nodes[ child ].nextSibling )
+		CopyNode( child, node );
+}
+
+
+int TiXmlSnapshotNode::Type() const
+{
+	return snapshot ? (int)( snapshot->nodes[ index ].type & ~(unsigned) TiXmlSnapshot::CDATA_FLAG ) : -1;
+}
+
+
+const char* TiXmlSnapshotNode::Value() const
+{
+	return snapshot ? snapshot->strings + snapshot->nodes[ index ].value : 0;
+}
+
+
+bool TiXmlSnapshotNode::CDATA() const
+{
+	return snapshot && ( snapshot->nodes[ index ].type & TiXmlSnapshot::CDATA_FLAG ) != 0;
+}
+
+
+TiXmlSnapshotNode TiXmlSnapshotNode::Parent() const
+{
+	if ( !snapshot || snapshot->nodes[ index ].parent == TiXmlSnapshot::NONE )
+		return TiXmlSnapshotNode();
+	return TiXmlSnapshotNode( snapshot, snapshot->nodes[ index ].parent );
+}
+
+
+TiXmlSnapshotNode TiXmlSnapshotNode::FirstChild() const
+{
+	if ( !snapshot || snapshot->nodes[ index ].firstChild == TiXmlSnapshot::NONE )
+		return TiXmlSnapshotNode();
+	return TiXmlSnapshotNode( snapshot, snapshot->nodes[ index ].firstChild );
+}
+
+
+TiXmlSnapshotNode TiXmlSnapshotNode::NextSibling() const
+{
+	if ( !snapshot || snapshot->nodes[ index ].nextSibling == TiXmlSnapshot::NONE )
+		return TiXmlSnapshotNode();
+	return TiXmlSnapshotNode( snapshot, snapshot->nodes[ index ].nextSibling );
+}
+
+
+TiXmlSnapshotNode TiXmlSnapshotNode::FirstChildElement( const char* name ) const
+{
+	if ( !snapshot )
+		return TiXmlSnapshotNode();
+	const TiXmlSnapshot::Node* nodes = snapshot->nodes;
+	for( unsigned i = nodes[ index ].firstChild; i != TiXmlSnapshot::NONE; i = nodes[i].nextSibling )
+	{
+		if (    nodes[i].type == TiXmlNode::TINYXML_ELEMENT
+			 && ( !name || strcmp( snapshot->strings + nodes[i].value, name ) == 0 ) )
+			return TiXmlSnapshotNode( snapshot, i );
+	}
+	return TiXmlSnapshotNode();
+}
+
+
+TiXmlSnapshotNode TiXmlSnapshotNode::NextSiblingElement( const char* name ) const
+{
+	if ( !snapshot )
+		return TiXmlSnapshotNode();
+	const TiXmlSnapshot::Node* nodes = snapshot->nodes;
+	for( unsigned i = nodes[ index ].nextSibling; i != TiXmlSnapshot::NONE; i = nodes[i].nextSibling )
+	{
+		if (    nodes[i].type == TiXmlNode::TINYXML_ELEMENT
+			 && ( !name || strcmp( snapshot->strings + nodes[i].value, name ) == 0 ) )
+			return TiXmlSnapshotNode( snapshot, i );
+	}
+	return TiXmlSnapshotNode();
+}
+
+
+const char* TiXmlSnapshotNode::GetText() const
+{
+	TiXmlSnapshotNode child = FirstChild();
+	if ( Type() != TiXmlNode::TINYXML_ELEMENT || child.Type() != TiXmlNode::TINYXML_TEXT )
+		return 0;
+	return child.Value();
+}
+
+
+const char* TiXmlSnapshotNode::Attribute( const char* name ) const
+{
+	for( int i = 0; i < AttributeCount(); ++i )
+	{
+		if ( strcmp( AttributeName( i ), name ) == 0 )
+			return AttributeValue( i );
+	}
+	return 0;
+}
+
+
+int TiXmlSnapshotNode::AttributeCount() const
+{
+	return snapshot ? (int) snapshot->nodes[ index ].attributeCount : 0;
+}
+
+
+const char* TiXmlSnapshotNode::AttributeName( int i ) const
+{
+	if ( i < 0 || i >= AttributeCount() )
+		return 0;
+	return snapshot->strings + snapshot->attributes[ snapshot->nodes[ index ].firstAttribute + i ].name;
+}
+
+
+const char* TiXmlSnapshotNode::AttributeValue( int i ) const
+{
+	if ( i < 0 || i >= AttributeCount() )
+		return 0;
+	return snapshot->strings + snapshot->attributes[ snapshot->nodes[ index ].firstAttribute + i ].value;
+}
@@ -80,14 +80,27 @@ distribution.
 	#endif
 #endif	
 
+// The parser scans the input 16 or 32 bytes at a time with SSE2 or AVX2, if the
+// CPU has them (checked at run time.) This needs GCC 4.9 or Clang on x86. If you
+// get compilation troubles, or want the plain byte by byte code, define TIXML_NO_SIMD.
+#if    !defined( TIXML_NO_SIMD ) \
+	&& ( defined( __x86_64__ ) || defined( __i386__ ) ) \
+	&& ( defined( __clang__ ) || ( defined( __GNUC__ ) && ( __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) ) ) )
+	#define TIXML_SIMD
+#endif
+
 class TiXmlDocument;
 class TiXmlElement;
 class TiXmlComment;
 class TiXmlUnknown;
 class TiXmlAttribute;
+class TiXmlAttributeSet;
 class TiXmlText;
 class TiXmlDeclaration;
 class TiXmlParsingData;
+class TiXmlSelection;
+class TiXmlSaxHandler;
+class TiXmlPath;
 
 const int TIXML_MAJOR_VERSION = 2;
 const int TIXML_MINOR_VERSION = 6;
@@ -106,6 +119,113 @@ struct TiXmlCursor
 };
 
 
+/**
+	A bump allocator, used by a TiXmlDocument in arena mode (see TiXmlDocument::SetUseArena)
+	to hold its nodes, attributes and strings. Memory is taken from large blocks by
+	moving a pointer, and is only given back when the whole arena is reset or destroyed.
+	Freeing a single allocation does nothing.
+*/
+class TiXmlArena
+{
+public:
+	/// Create an arena which allocates blocks of (at least) blockSize bytes.
+	TiXmlArena( size_t blockSize = 16 * 1024 );
+	~TiXmlArena();
+
+	/// Allocate 'size' bytes, aligned for any TinyXml object.
+	void* Alloc( size_t size );
+
+	/** Release everything allocated from the arena. The first block is
+		kept, so a reused arena doesn't go back to the system for memory.
+	*/
+	void Reset();
+
+	/// The number of bytes handed out since the arena was created or reset.
+	size_t BytesUsed() const	{ return bytesUsed; }
+
+private:
+	TiXmlArena( const TiXmlArena& );			// not implemented.
+	void operator=( const TiXmlArena& );		// not allowed.
+
+	struct Block
+	{
+		Block*	next;
+		size_t	size;
+		double	align;	// block data starts after this header, suitably aligned
+	};
+	enum { ALIGNMENT = sizeof( double ) };
+
+	Block*	blocks;		// newest first
+	char*	top;		// next free byte in blocks
+	char*	end;		// end of blocks
+	size_t	blockSize;
+	size_t	bytesUsed;
+};
+
+
+/**
+	The names of elements and attributes, each kept once. An element or attribute
+	refers to the table's copy of its name, its symbol (see TiXmlNode::Symbol() and
+	TiXmlAttribute::Symbol()), so names can be compared by pointer: two names are
+	equal exactly when their symbols are.
+
+	The table is shared by all documents, and can be used from several threads.
+	It only ever grows; a name stays in it until the program exits. Every name
+	that is parsed or set is interned, so a program that parses untrusted input
+	can be made to use memory without bound by documents with ever new names.
+	(The elements a selective parse skips, see TiXmlDocument::AddKeepPath(),
+	aren't interned.) Lookups (TiXmlElement::Attribute(), FirstChildElement(), TiXmlPath and the
+	like) use Find(), and don't add the names they look for.
+*/
+class TiXmlNameTable
+{
+public:
+	/// The symbol for 'name', which is added to the table if it isn't there yet.
+	static const char* Intern( const char* name, size_t length );
+	static const char* Intern( const char* name )	{ return Intern( name, strlen( name ) ); }
+
+	/** The symbol for 'name', or null if the table doesn't have it. In that case,
+		no element or attribute has that name.
+	*/
+	static const char* Find( const char* name, size_t length );
+	static const char* Find( const char* name )		{ return Find( name, strlen( name ) ); }
+
+	/// The number of names in the table.
+	static size_t Size();
+
+	// [internal use]
+	// The hash of a name, FNV-1a.
+	static unsigned Hash( const char* name, size_t length );
+
+private:
+	struct Entry
+	{
+		unsigned hash;
+		size_t length;
+		const char* name;	// null for an empty slot
+	};
+	// Open addressing with linear probing. A table that is outgrown is kept,
+	// as a reader may still be looking at it.
+	struct Table
+	{
+		Table* previous;
+		size_t mask;
+		Entry* entries;
+	};
+	enum { BLOCK_SIZE = 4096 };
+
+	static const char* Lookup( const Table* table, unsigned hash, const char* name, size_t length );
+	static void Rehash( size_t size );
+
+	// Changed under a lock in tinyxml.cpp. Where the compiler has atomic loads
+	// and stores, readers don't take the lock.
+	static Table* table;
+	static size_t count;
+	static char* top;			// next free byte of the block names are copied to
+	static char* end;
+};
+
+
 /**
 	Implements the interface to the "Visitor pattern" (see the Accept() method.)
 	If you call the Accept() method, it requires being passed a TiXmlVisitor
@@ -196,6 +316,9 @@ class TiXmlBase
 	friend class TiXmlNode;
 	friend class TiXmlElement;
 	friend class TiXmlDocument;
+	friend class TiXmlPullParser;
+	friend class TiXmlPath;
+	friend class TiXmlSelection;
 
 public:
 	TiXmlBase()	:	userData(0)		{}
@@ -237,9 +360,10 @@ public:
 		reflect changes in the document.
 
 		There is a minor performance cost to computing the row and column. Computation
-		can be disabled if TiXmlDocument::SetTabSize() is called with 0 as the value.
+		can be disabled if TiXmlDocument::SetTabSize() is called with 0 as the value,
+		or left to errors alone with TiXmlDocument::SetLazyLocations().
 
-		@sa TiXmlDocument::SetTabSize()
+		@sa TiXmlDocument::SetTabSize(), TiXmlDocument::SetLazyLocations()
 	*/
 	int Row() const			{ return location.row + 1; }
 	int Column() const		{ return location.col + 1; }	///< See Row()
@@ -248,6 +372,17 @@ public:
 	void* GetUserData()						{ return userData; }	///< Get a pointer to arbitrary user data.
 	const void* GetUserData() const 		{ return userData; }	///< Get a pointer to arbitrary user data.
 
+	/*	Nodes and attributes can live on the heap or in a TiXmlArena. A small header
+		in front of each object remembers which, so 'delete' works on both: an arena
+		object has its destructor run, but its memory is only reclaimed with the arena.
+	*/
+	static void* operator new( size_t size );
+	static void* operator new( size_t size, TiXmlArena& arena );
+	static void* operator new( size_t, void* where )			{ return where; }
+	static void operator delete( void* p );
+	static void operator delete( void* p, TiXmlArena& );
+	static void operator delete( void*, void* )					{}
+
 	// Table that returs, for a given lead byte, the total number of bytes
 	// in the UTF-8 sequence.
 	static const int utf8ByteTable[256];
@@ -261,6 +396,13 @@ public:
 	*/
 	static void EncodeString( const TIXML_STRING& str, TIXML_STRING* out );
 
+	/*	[internal use] Finds the characters EncodeString() copies unchanged:
+		returns the end of the run of them that starts at 'p'. If that is
+		before 'end', the character there is written as 'replacement'
+		instead, which may point into 'scratch' (8 chars).
+	*/
+	static const char* EncodeRun( const char* p, const char* end, const char** replacement, size_t* replacementLength, char* scratch );
+
 	enum
 	{
 		TIXML_NO_ERROR = 0,
@@ -301,6 +443,12 @@ protected:
 	#ifdef TIXML_USE_STL
 	static bool	StreamWhiteSpace( std::istream * in, TIXML_STRING * tag );
 	static bool StreamTo( std::istream * in, int character, TIXML_STRING * tag );
+	/*	Appends characters from the stream to the tag up to, but not including,
+		the first 'stop0', 'stop1' or null. Works from the stream buffer a block
+		at a time. Returns the character stopped at (left in the stream), or -1
+		at the end of the stream.
+	*/
+	static int StreamSpan( std::istream * in, TIXML_STRING * tag, char stop0, char stop1 );
 	#endif
 
 	/*	Reads an XML name into the string provided. Returns
@@ -309,6 +457,12 @@ protected:
 	*/
 	static const char* ReadName( const char* p, TIXML_STRING* name, TiXmlEncoding encoding );
 
+	/*	Interns the name in 'name' (see TiXmlNameTable), and sets 'target' to it.
+		Returns the symbol. Where it can, 'target' refers to the table's copy of
+		the name, rather than keeping one of its own.
+	*/
+	static const char* InternName( TIXML_STRING* target, const TIXML_STRING& name );
+
 	/*	Reads text. Returns a pointer past the given end tag.
 		Wickedly complex options, but it keeps the (sensitive) code in one place.
 	*/
@@ -317,7 +471,11 @@ protected:
 									bool ignoreWhiteSpace,		// whether to keep the white space
 									const char* endTag,			// what ends this text
 									bool ignoreCase,			// whether to ignore case in the end tag
-									TiXmlEncoding encoding );	// the current encoding
+									TiXmlEncoding encoding,		// the current encoding
+									bool normalizeNewLines = false );	// whether CR and CR+LF are read as LF
+
+	// Translate CR and CR+LF to LF, in place.
+	static void NormalizeNewLines( TIXML_STRING* text );
 
 	// If an entity has been found, transform it into a character.
 	static const char* GetEntity( const char* in, char* value, int* length, TiXmlEncoding encoding );
@@ -360,6 +518,29 @@ protected:
 		}
 	}
 
+	/*	Fast scanning of the input, with SSE2 or AVX2 when TIXML_SIMD is defined and the
+		CPU has them, byte by byte otherwise. Each returns the first character that
+		stops the scan; the null terminator always does.
+	*/
+	enum
+	{
+		TIXML_SIMD_NONE,
+		TIXML_SIMD_SSE2,
+		TIXML_SIMD_AVX2
+	};
+	static int SimdLevel();
+
+	// Skips the ASCII white space characters.
+	static const char* ScanWhiteSpace( const char* p );
+	// Skips the characters that can follow the first character of a name.
+	static const char* ScanName( const char* p );
+	// Stops at '&', CR, 'endChar' and optionally bytes over 127. If 'condense' is set, also stops
+	// at white space, except for a single space between characters of text.
+	static const char* ScanText( const char* p, char endChar, bool condense, bool stopAtHighBytes );
+	// Stops at the characters EncodeString() replaces: '&', '<', '>', quotes and bytes
+	// under 32. Unlike the others, it scans [p, end), and returns 'end' if none is there.
+	static const char* ScanEscape( const char* p, const char* end );
+
 	// Return true if the next characters in the stream are any of the endTag sequences.
 	// Ignore case only works for english, and should only be relied on when comparing
 	// to English words: StringEqual( p, "version", true ) is fine.
@@ -505,15 +686,33 @@ public:
 		Text:		the text string
 		@endverbatim
 	*/
-	void SetValue(const char * _value) { value = _value;}
+	void SetValue( const char * _value );
 
     #ifdef TIXML_USE_STL
 	/// STL std::string form.
-	void SetValue( const std::string& _value )	{ value = _value; }
+	void SetValue( const std::string& _value );
 	#endif
 
+	/** The symbol of an element's name (see TiXmlNameTable): elements with the
+		same name have the same Symbol(). Null for the other types of node.
+	*/
+	const char* Symbol() const { return symbol; }
+
+	/**	Once a lookup by name (FirstChild( value ), FirstChildElement( value )) had
+		to walk past more than a few children, the node indexes its children by
+		value, and the next lookups don't walk at all. The index goes away when
+		the children, or their values, change.
+
+		Building the index changes the node, even from a const lookup, so it is
+		only safe when one thread at a time uses the document. Off by default.
+		Note changing this value is not thread safe.
+	*/
+	static void SetIndexChildren( bool index )	{ indexChildren = index; }
+	/// Return the current child index setting.
+	static bool IsIndexingChildren()			{ return indexChildren; }
+
 	/// Delete all the children of this node. Does not affect 'this'.
-	void Clear();
+	virtual void Clear();
 
 	/// One step up the DOM.
 	TiXmlNode* Parent()							{ return parent; }
@@ -759,6 +958,7 @@ protected:
 	TiXmlNode*		lastChild;
 
 	TIXML_STRING	value;
+	const char*		symbol;		// of the value, for elements
 
 	TiXmlNode*		prev;
 	TiXmlNode*		next;
@@ -766,6 +966,33 @@ protected:
 private:
 	TiXmlNode( const TiXmlNode& );				// not implemented.
 	void operator=( const TiXmlNode& base );	// not allowed.
+
+	// Up to this many children, walking the list is fine.
+	enum { CHILD_INDEX_MIN = 8 };
+
+	// The children by value: open addressing with linear probing.
+	struct ChildIndex
+	{
+		struct Entry
+		{
+			unsigned hash;
+			const TiXmlNode* first;				// first child with the value; null for an empty slot
+			const TiXmlElement* firstElement;	// first element with the value, if any
+		};
+
+		ChildIndex( unsigned size ) : mask( size - 1 ), entries( new Entry[ size ] )	{}
+		~ChildIndex()	{ delete [] entries; }
+
+		unsigned mask;
+		Entry* entries;
+	};
+
+	void IndexChildren() const;
+	const ChildIndex::Entry* LookupChild( const char* _value ) const;
+	void DropChildIndex() const		{ delete childIndex; childIndex = 0; }
+
+	mutable ChildIndex* childIndex;	// null until a lookup builds it
+	static bool indexChildren;
 };
 
 
@@ -786,16 +1013,19 @@ public:
 	{
 		document = 0;
 		prev = next = 0;
+		set = 0;
+		symbol = 0;
 	}
 
 	#ifdef TIXML_USE_STL
 	/// std::string constructor.
 	TiXmlAttribute( const std::string& _name, const std::string& _value )
 	{
-		name = _name;
+		symbol = InternName( &name, _name );
 		value = _value;
 		document = 0;
 		prev = next = 0;
+		set = 0;
 	}
 	#endif
 
@@ -803,9 +1033,11 @@ public:
 	TiXmlAttribute( const char * _name, const char * _value )
 	{
 		name = _name;
+		symbol = InternName( &name, name );
 		value = _value;
 		document = 0;
 		prev = next = 0;
+		set = 0;
 	}
 
 	const char*		Name()  const		{ return name.c_str(); }		///< Return the name of this attribute.
@@ -818,6 +1050,10 @@ public:
 
 	// Get the tinyxml string representation
 	const TIXML_STRING& NameTStr() const { return name; }
+	const TIXML_STRING& ValueTStr() const { return value; }
+
+	/// The symbol of the name (see TiXmlNameTable). Null for an attribute that wasn't named yet.
+	const char*		Symbol() const		{ return symbol; }
 
 	/** QueryIntValue examines the value string. It is an alternative to the
 		IntValue() method with richer error checking.
@@ -832,7 +1068,7 @@ public:
 	/// QueryDoubleValue examines the value string. See QueryIntValue().
 	int QueryDoubleValue( double* _value ) const;
 
-	void SetName( const char* _name )	{ name = _name; }				///< Set the name of this attribute.
+	void SetName( const char* _name );									///< Set the name of this attribute.
 	void SetValue( const char* _value )	{ value = _value; }				///< Set the value.
 
 	void SetIntValue( int _value );										///< Set the value from an integer.
@@ -840,7 +1076,7 @@ public:
 
     #ifdef TIXML_USE_STL
 	/// STL std::string form.
-	void SetName( const std::string& _name )	{ name = _name; }	
+	void SetName( const std::string& _name );
 	/// STL std::string form.	
 	void SetValue( const std::string& _value )	{ value = _value; }
 	#endif
@@ -882,9 +1118,11 @@ private:
 
 	TiXmlDocument*	document;	// A pointer back to a document, for error reporting.
 	TIXML_STRING name;
+	const char* symbol;			// of the name
 	TIXML_STRING value;
 	TiXmlAttribute*	prev;
 	TiXmlAttribute*	next;
+	TiXmlAttributeSet* set;		// The set this attribute is linked into, if any.
 };
 
 
@@ -899,9 +1137,16 @@ private:
 	This version is implemented with circular lists because:
 		- I like circular lists
 		- it demonstrates some independence from the (typical) doubly linked list.
+
+	The list keeps the attributes in order. Find() looks the name up in the
+	TiXmlNameTable once, and then compares symbols. Once there are more than
+	a few attributes, they are also indexed by symbol, so Find() doesn't have
+	to look at every one.
 */
 class TiXmlAttributeSet
 {
+	friend class TiXmlAttribute;
+
 public:
 	TiXmlAttributeSet();
 	~TiXmlAttributeSet();
@@ -916,6 +1161,8 @@ public:
 
 	TiXmlAttribute*	Find( const char* _name ) const;
 	TiXmlAttribute* FindOrCreate( const char* _name );
+	/// Find by the symbol of the name (see TiXmlNameTable).
+	TiXmlAttribute*	FindSymbol( const char* symbol ) const;
 
 #	ifdef TIXML_USE_STL
 	TiXmlAttribute*	Find( const std::string& _name ) const;
@@ -929,7 +1176,20 @@ private:
 	TiXmlAttributeSet( const TiXmlAttributeSet& );	// not allowed
 	void operator=( const TiXmlAttributeSet& );	// not allowed (as TiXmlAttribute)
 
+	// Up to this many attributes, walking the list beats the index.
+	enum { INDEX_MIN = 8 };
+
+	// Symbols are packed next to each other in the name table, so their
+	// addresses are spread well over the low bits.
+	unsigned Slot( const char* symbol ) const	{ return (unsigned)(size_t) symbol & indexMask; }
+	void Index( TiXmlAttribute* attribute );
+	void Unindex( TiXmlAttribute* attribute );
+	void Rehash( unsigned size );
+
 	TiXmlAttribute sentinel;
+	TiXmlAttribute** index;	// Open addressing with linear probing; null while the set is small.
+	unsigned indexMask;
+	unsigned count;
 };
 
 
@@ -1399,7 +1659,32 @@ public:
 	TiXmlDocument( const TiXmlDocument& copy );
 	void operator=( const TiXmlDocument& copy );
 
-	virtual ~TiXmlDocument() {}
+	virtual ~TiXmlDocument();
+
+	/** Switch the document to (or from) arena mode. In arena mode the nodes, attributes
+		and strings created by the parser are allocated from a TiXmlArena owned by the
+		document, and are released in one go when the document is cleared or destroyed.
+		This is much faster for the common "parse, read, throw away" usage.
+
+		Changing the mode deletes the current content of the document. Nodes created
+		by the application (new TiXmlElement, etc.) can still be linked in to an arena
+		document as usual.
+		@verbatim
+		TiXmlDocument doc;
+		doc.SetUseArena( true );
+		doc.Parse( xml );
+		@endverbatim
+	*/
+	void SetUseArena( bool useArena, size_t blockSize = 16 * 1024 );
+
+	/// Returns true if the document is in arena mode.
+	bool UsesArena() const					{ return arena != 0; }
+
+	/** Delete all the children of the document. In arena mode the memory of
+		the arena is released (and reused by the next parse.) A buffer adopted
+		by ParseInSitu() is deleted.
+	*/
+	void Clear();
 
 	/** Load a file using the current document value.
 		Returns true if successful. Will delete any existing
@@ -1416,6 +1701,10 @@ public:
 		doesn't stream - the entire object pointed at by the FILE*
 		will be interpreted as an XML file. TinyXML doesn't stream in XML from the current
 		file location. Streaming may be added in the future.
+
+		Where the system supports it (and TIXML_NO_MMAP isn't defined), a regular file is
+		memory mapped and parsed where it is, rather than read in to a buffer first. The
+		file must not be changed while it loads.
 	*/
 	bool LoadFile( FILE*, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
 	/// Save a file using the given FILE*. Returns true if successful.
@@ -1438,6 +1727,20 @@ public:
 	*/
 	virtual const char* Parse( const char* p, TiXmlParsingData* data = 0, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
 
+	/** Parse the given null terminated block of xml data in place (destructively). Entities
+		are decoded in the buffer and the names and values are null terminated in it, and the
+		nodes refer to the buffer instead of keeping copies. The current content of the document
+		is deleted first.
+
+		The buffer must stay valid until the document is cleared or destroyed. If adoptBuffer
+		is true the document takes ownership, and deletes it (with delete[]) at that point.
+
+		Rows and columns are not tracked by an in-situ parse, as the input changes while it
+		is read. In STL mode std::string can't refer to the buffer, so strings are copied as
+		with Parse().
+	*/
+	const char* ParseInSitu( char* xml, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING, bool adoptBuffer = false );
+
 	/** Get the root element -- the only top level element -- of the document.
 		In well formed XML, there should only be one. TinyXml is tolerant of
 		multiple elements at the document level.
@@ -1498,6 +1801,48 @@ public:
 
 	int TabSize() const	{ return tabsize; }
 
+	/** With lazy locations on, the parser doesn't work out the row and column of
+		every node and attribute as it goes: they report a Row() and Column() of 0.
+		The location of an error is only worked out when there is one, from the
+		start of the input, so ErrorRow() and ErrorCol() still report it. This
+		saves a second pass over the input when parses succeed and node locations
+		aren't wanted. Off by default; set it before the parse or load.
+
+		@sa SetTabSize, ErrorRow
+	*/
+	void SetLazyLocations( bool lazy )	{ lazyLocations = lazy; }
+
+	bool LazyLocations() const			{ return lazyLocations; }
+
+	/** Parse only part of the document. With keep paths added, the parser reads
+		the elements the paths select whole, and the elements on the way to them
+		without their text or other content; everything else is skipped by
+		looking for the matching end tag, and no nodes are created for it. This
+		is much faster, and smaller, when a large document is read for a few
+		values:
+		@verbatim
+		TiXmlDocument doc;
+		doc.AddKeepPath( TiXmlPath( "/OpenSearchDescription/movies/movie[*]/name" ) );
+		doc.AddKeepPath( TiXmlPath( "/OpenSearchDescription/movies/movie[*]/id" ) );
+		doc.LoadFile( "search.xml" );
+		@endverbatim
+		The paths start at the document, whether or not they start with '/'. An
+		index counts all the matching elements, the skipped ones too. A path that
+		has an error keeps nothing. Skipped content is only checked for balanced
+		tags, so some errors in it are not reported. Set the paths before the parse
+		or load; SetLazyLocations() saves working out the locations in the skipped
+		content as well.
+
+		@sa TiXmlPath
+	*/
+	void AddKeepPath( const TiXmlPath& path );
+	/// Remove the keep paths: the whole document is parsed.
+	void ClearKeepPaths();
+	/// The number of keep paths; none if the whole document is parsed.
+	int KeepPaths() const;
+	/// The keep path 'i', from 0 to KeepPaths()-1.
+	const TiXmlPath& KeepPath( int i ) const;
+
 	/** If you have handled the error, it can be reset with this call. The error
 		state is automatically cleared if you Parse a new XML block.
 	*/
@@ -1522,6 +1867,28 @@ public:
 	// [internal use]
 	void SetError( int err, const char* errorLocation, TiXmlParsingData* prevData, TiXmlEncoding encoding );
 
+	// [internal use]
+	// The arena, or null if the document isn't in arena mode.
+	TiXmlArena* Arena() const				{ return arena; }
+	// [internal use]
+	// The string the parser should read a name or value into. In arena and in-situ
+	// mode this is a scratch buffer, which StoreParsed() then copies to the arena or
+	// back to the input, at 'source' (where it was read from.) 'p' is the read position
+	// of the parser: input before it is never looked at again, and can be written to.
+	TIXML_STRING* ParseBuffer( TIXML_STRING* target );
+	void StoreParsed( TIXML_STRING* target, TIXML_STRING* parsed, const char* source, const char* p );
+	// [internal use]
+	// Like StoreParsed(), for a name, which is interned as well (see TiXmlNameTable.)
+	// Returns the symbol.
+	const char* StoreName( TIXML_STRING* target, TIXML_STRING* parsed, const char* source, const char* p );
+	// [internal use]
+	// True while parsing a file that wasn't normalized when it was loaded: the parser
+	// then reads CR and CR+LF as LF itself.
+	bool NormalizingNewLines() const		{ return normalizingNewLines; }
+	// [internal use]
+	// The state of a selective parse, or null if the whole document is parsed.
+	TiXmlSelection* Selection() const		{ return selection; }
+
 	virtual const TiXmlDocument*    ToDocument()    const { return this; } ///< Cast to a more defined type. Will return null not of the requested type.
 	virtual TiXmlDocument*          ToDocument()          { return this; } ///< Cast to a more defined type. Will return null not of the requested type.
 
@@ -1538,13 +1905,25 @@ protected :
 
 private:
 	void CopyTo( TiXmlDocument* target ) const;
+	bool ParseMappedFile( FILE* file, TiXmlEncoding encoding );
 
 	bool error;
 	int  errorId;
 	TIXML_STRING errorDesc;
 	int tabsize;
+	bool lazyLocations;
 	TiXmlCursor errorLocation;
 	bool useMicrosoftBOM;		// the UTF-8 BOM were found when read. Note this, and try to write.
+	TiXmlArena* arena;			// non-null in arena mode
+	#ifndef TIXML_USE_STL
+	TIXML_STRING parseBuffer;	// scratch buffer of the parser in arena and in-situ mode
+	#endif
+	char* inSituBuffer;			// input of ParseInSitu(), deleted with the content if owned
+	bool ownsInSituBuffer;
+	bool parsingInSitu;
+	char* pendingTerminator;	// null terminator the in-situ parse can't write yet
+	bool normalizingNewLines;
+	TiXmlSelection* selection;	// the keep paths, if any (see AddKeepPath)
 };
 
 
@@ -1627,6 +2006,8 @@ private:
 		// do something
 	}
 	@endverbatim
+
+	or a TiXmlPath, which does the same walk for a whole path.
 */
 class TiXmlHandle
 {
@@ -1665,6 +2046,11 @@ public:
 	*/
 	TiXmlHandle ChildElement( int index ) const;
 
+	/** Return a handle to the first element that 'path' selects, starting
+		from this node. See TiXmlPath.
+	*/
+	TiXmlHandle Path( const TiXmlPath& path ) const;
+
 	#ifdef TIXML_USE_STL
 	TiXmlHandle FirstChild( const std::string& _value ) const				{ return FirstChild( _value.c_str() ); }
 	TiXmlHandle FirstChildElement( const std::string& _value ) const		{ return FirstChildElement( _value.c_str() ); }
@@ -1708,6 +2094,159 @@ private:
 };
 
 
+/**	A TiXmlPath is a compiled path through the elements of a document, a small
+	subset of XPath. Compiling it once, and using it for every record, saves
+	looking up the same names again and again, and walking the siblings from
+	the start for every index, as a chain of TiXmlHandle calls does.
+
+	A path is a list of steps separated by '/'. A step is an element name, or
+	'*' for any element, and selects:
+	@verbatim
+	name		the first child element called 'name'
+	name[2]		the third child element called 'name' (the first is 0, as in TiXmlHandle)
+	name[*]		every child element called 'name'
+	@endverbatim
+	A path that starts with '/' starts at the document; otherwise, it starts at
+	the node it is used on.
+
+	Use a TiXmlPathIterator to get all the elements a path selects, in document
+	order, in a single pass over the tree:
+	@verbatim
+	TiXmlPath names( "/OpenSearchDescription/movies/movie[*]/name" );
+	for( TiXmlPathIterator it( names, &doc ); it.Element(); it.Next() )
+	{
+		printf( "%s\n", it.Element()->GetText() );
+	}
+	@endverbatim
+	or First(), or TiXmlHandle::Path(), for just the first one.
+*/
+class TiXmlPath
+{
+public:
+	/// Compile 'path'. A path that has an error selects nothing; see Error().
+	TiXmlPath( const char* path );
+	#ifdef TIXML_USE_STL
+	TiXmlPath( const std::string& path );		///< STL std::string form.
+	#endif
+	TiXmlPath( const TiXmlPath& copy );
+	void operator=( const TiXmlPath& copy );
+	~TiXmlPath();
+
+	/// True if the path couldn't be compiled.
+	bool Error() const				{ return errorOffset >= 0; }
+	/// Where in the path the error is, or -1 if there is none.
+	int ErrorOffset() const			{ return errorOffset; }
+
+	/// The number of steps in the path.
+	int Steps() const				{ return count; }
+
+	/// The first element the path selects from 'from', or null if there is none.
+	TiXmlElement* First( TiXmlNode* from ) const;
+
+private:
+	friend class TiXmlPathIterator;
+	friend class TiXmlSelection;
+
+	enum { ALL = -1 };	// index of a step that selects every match
+
+	struct Step
+	{
+		const char* symbol;		// of the name (see TiXmlNameTable); null for '*', or if the name wasn't in the table
+		TIXML_STRING name;		// empty for '*'
+		int index;				// of the match to select, or ALL
+
+		bool Any() const		{ return name.empty(); }
+		/*	The symbol of the name. A name that wasn't in the table when the path was
+			compiled is looked up again, as a document parsed since may have added it.
+			Null for '*', and for a name no element has.
+		*/
+		const char* Symbol() const
+		{
+			return ( symbol || Any() ) ? symbol : TiXmlNameTable::Find( name.data(), name.length() );
+		}
+	};
+
+	void Compile( const char* path );
+	void Copy( const TiXmlPath& copy );
+	// The next element step 'level' selects among the children of 'parent', after 'previous'.
+	TiXmlElement* Match( int level, TiXmlNode* parent, TiXmlElement* previous ) const;
+
+	Step* steps;
+	int count;
+	bool absolute;
+	int errorOffset;
+};
+
+
+/**	Walks over the elements a TiXmlPath selects, in document order. The path
+	and the tree must not change while the iterator is in use.
+*/
+class TiXmlPathIterator
+{
+public:
+	/// Start at the first element 'path' selects from 'from'.
+	TiXmlPathIterator( const TiXmlPath& path, TiXmlNode* from );
+	~TiXmlPathIterator();
+
+	/// The current element, or null when there are no more.
+	TiXmlElement* Element() const	{ return current; }
+	/// Move on to the next element.
+	void Next();
+
+private:
+	TiXmlPathIterator( const TiXmlPathIterator& );		// not implemented.
+	void operator=( const TiXmlPathIterator& );		// not allowed.
+
+	void Seek( int level );
+
+	const TiXmlPath& path;
+	TiXmlNode* root;
+	TiXmlElement** at;		// the current match of each step
+	TiXmlElement* current;
+};
+
+
+/**	The destination of a TiXmlWriter. Write() is called with the output in
+	pieces, each no larger than the writer's buffer (or a single string, if
+	that is larger); it returns false if the data could not be written.
+	Derive from TiXmlSink to send the output anywhere else, a socket for
+	instance.
+*/
+class TiXmlSink
+{
+public:
+	virtual ~TiXmlSink()	{}
+	virtual bool Write( const char* data, size_t length ) = 0;
+};
+
+
+/// A TiXmlSink that writes to a FILE. The file is not closed.
+class TiXmlFileSink : public TiXmlSink
+{
+public:
+	TiXmlFileSink( FILE* _file ) : file( _file )	{}
+	virtual bool Write( const char* data, size_t length );
+
+private:
+	FILE* file;
+};
+
+
+/** A TiXmlSink that writes to a file descriptor with write() (_write() on
+	Windows), so a pipe or a connected socket can be written to without
+	the buffering of a FILE. The descriptor is not closed.
+*/
+class TiXmlFdSink : public TiXmlSink
+{
+public:
+	TiXmlFdSink( int _fd ) : fd( _fd )	{}
+	virtual bool Write( const char* data, size_t length );
+
+private:
+	int fd;
+};
+
+
 /** Print to memory functionality. The TiXmlPrinter is useful when you need to:
 
 	-# Print to memory (especially in non-STL mode)
@@ -1726,12 +2265,24 @@ private:
 	doc.Accept( &printer );
 	fprintf( stdout, "%s", printer.CStr() );
 	@endverbatim
+
+	Printing a document first reserves room for it, from EstimateSize(),
+	so the output is not copied over and over as it grows. A large
+	document can instead be sent to a TiXmlSink as it is printed, without
+	holding all of it in memory:
+	@verbatim
+	TiXmlFdSink sink( fd );
+	TiXmlPrinter printer;
+	printer.SetSink( &sink );
+	doc.Accept( &printer );
+	@endverbatim
 */
 class TiXmlPrinter : public TiXmlVisitor
 {
 public:
 	TiXmlPrinter() : depth( 0 ), simpleTextPrint( false ),
-					 buffer(), indent( "    " ), lineBreak( "\n" ) {}
+					 buffer(), indent( "    " ), lineBreak( "\n" ),
+					 sink( 0 ), flushSize( 0 ), error( false ) {}
 
 	virtual bool VisitEnter( const TiXmlDocument& doc );
 	virtual bool VisitExit( const TiXmlDocument& doc );
@@ -1774,6 +2325,29 @@ public:
 	const std::string& Str()						{ return buffer; }
 	#endif
 
+	/** Make room for 'size' characters of output. Printing a document
+		does this by itself; call it with EstimateSize() before printing
+		any other node that is large.
+	*/
+	void Reserve( size_t size )						{ buffer.reserve( size ); }
+	/** Estimate the length of 'node' printed with the current indent and
+		line break. Entities are not counted, so the printed node may be
+		a little longer.
+	*/
+	size_t EstimateSize( const TiXmlNode& node ) const	{ return Estimate( node, 0 ); }
+
+	/** Write the output to 'sink' as it is printed: whenever 'bufferSize'
+		characters are waiting, they are written out and dropped, so CStr()
+		and Size() only cover what has not been written yet. The end of a
+		document flushes; after printing any other node, call Flush().
+		A null sink keeps all the output again.
+	*/
+	void SetSink( TiXmlSink* _sink, size_t bufferSize = 4096 );
+	/// Write out what is waiting. Returns false if the sink failed.
+	bool Flush();
+	/// True if the sink failed. Printing stops when it does.
+	bool Error() const								{ return error; }
+
 private:
 	void DoIndent()	{
 		for( int i=0; i<depth; ++i )
@@ -1782,12 +2356,550 @@ private:
 	void DoLineBreak() {
 		buffer += lineBreak;
 	}
+	bool Drain()	{
+		if ( sink && buffer.size() >= flushSize )
+			Flush();
+		return !error;
+	}
+	size_t Estimate( const TiXmlNode& node, int depth ) const;
 
 	int depth;
 	bool simpleTextPrint;
 	TIXML_STRING buffer;
 	TIXML_STRING indent;
 	TIXML_STRING lineBreak;
+	TiXmlSink* sink;
+	size_t flushSize;
+	bool error;
+};
+
+
+/**	Writes XML as it is produced, without building a document. Elements,
+	attributes and text are written through a fixed size buffer, which is
+	handed to a TiXmlSink whenever it fills; memory use does not grow with
+	the size of the output.
+
+	@verbatim
+	TiXmlFileSink sink( stdout );
+	TiXmlWriter writer( &sink );
+	writer.Declaration( "1.0", "UTF-8", "" );
+	writer.StartElement( "movie" );
+	writer.Attribute( "id", 550 );
+	writer.StartElement( "name" );
+	writer.Text( "Fight Club" );
+	writer.EndElement();
+	writer.EndElement();
+	writer.Flush();
+	@endverbatim
+
+	Text and attribute values are escaped as TiXmlBase::EncodeString()
+	escapes them, and the layout is the same as TiXmlPrinter's: a document
+	written with the same indent and line break prints exactly as
+	TiXmlPrinter would print it. Element names are written as given.
+
+	Every call returns false if it could not be done: an Attribute() that
+	does not follow StartElement(), an EndElement() with no open element,
+	or a sink that failed. Once the sink has failed, nothing more is written.
+	The destructor flushes the buffer, but does not end open elements.
+*/
+class TiXmlWriter
+{
+public:
+	/// Write to 'sink', through a buffer of 'bufferSize' bytes.
+	TiXmlWriter( TiXmlSink* sink, size_t bufferSize = 4096 );
+	~TiXmlWriter();
+
+	/** Set the indent characters. By default 4 spaces, as for TiXmlPrinter.
+		Set them before the first element.
+	*/
+	void SetIndent( const char* _indent )			{ indent = _indent ? _indent : ""; }
+	/// Set the line breaking string. By default set to newline (\n).
+	void SetLineBreak( const char* _lineBreak )		{ lineBreak = _lineBreak ? _lineBreak : ""; }
+	/// No indent and no line breaks: the most dense output.
+	void SetStreamPrinting()						{ indent = ""; lineBreak = ""; }
+
+	/// Write an XML declaration. Empty values are left out.
+	bool Declaration( const char* version, const char* encoding, const char* standalone );
+	/// Start an element. Attributes may follow until the next call of any other kind.
+	bool StartElement( const char* name );
+	/// Add an attribute to the element just started.
+	bool Attribute( const char* name, const char* value );
+	/// Add an attribute with an integer value.
+	bool Attribute( const char* name, int value );
+	/// Add an attribute with a double value, written as %g.
+	bool DoubleAttribute( const char* name, double value );
+	/// Write text in the current element.
+	bool Text( const char* text );
+	/// Write a CDATA section. The text is written as is.
+	bool CData( const char* text );
+	/// Write a comment. The text is written as is.
+	bool Comment( const char* text );
+	/// End the innermost open element.
+	bool EndElement();
+
+	#ifdef TIXML_USE_STL
+	bool StartElement( const std::string& name )						{ return StartElement( name.c_str() ); }
+	bool Attribute( const std::string& name, const std::string& value )	{ return Attribute( name.c_str(), value.c_str() ); }
+	bool Text( const std::string& text )								{ return Text( text.c_str() ); }
+	#endif
+
+	/// Write out the buffer. Returns false if the sink failed.
+	bool Flush();
+
+	/// The number of open elements.
+	int Depth() const		{ return depth; }
+	/// True if the sink failed.
+	bool Error() const		{ return error; }
+
+private:
+	TiXmlWriter( const TiXmlWriter& );		// not implemented.
+	void operator=( const TiXmlWriter& );	// not allowed.
+
+	void Put( const char* data, size_t length );
+	void Put( const char* str )				{ Put( str, strlen( str ) ); }
+	void Put( const TIXML_STRING& str )		{ Put( str.c_str(), str.length() ); }
+	void PutEncoded( const char* str );
+	void DoIndent();
+	void StartChild();
+
+	TiXmlSink*		sink;
+	char*			buffer;
+	size_t			bufferSize;
+	size_t			used;
+	int				depth;
+	bool			inTag;			// attributes may still be added
+	bool			inlineText;		// text follows the start tag on the same line
+	bool			error;
+	TIXML_STRING	openElements;	// names of the open elements, each followed by a null
+	TIXML_STRING	indent;
+	TIXML_STRING	lineBreak;
+};
+
+
+/**	A pull parser reads a document one event at a time, without building
+	a DOM. It uses the same tokenizer as TiXmlDocument::Parse(), so names,
+	text and entities come out exactly as they would in the tree, but the
+	memory used does not grow with the size of the document: only the
+	current event and the names of the open elements are held.
+
+	The input must be a null terminated string, and must stay valid (and
+	unchanged) while the parser is in use.
+
+	@verbatim
+	TiXmlPullParser parser( xml );
+	bool inName = false;
+	for( ;; )
+	{
+		TiXmlPullParser::Event e = parser.Next();
+		if ( e == TiXmlPullParser::END_DOCUMENT || e == TiXmlPullParser::PARSE_ERROR )
+			break;
+		if ( e == TiXmlPullParser::START_ELEMENT )
+			inName = strcmp( parser.Name(), "name" ) == 0;
+		else if ( e == TiXmlPullParser::TEXT && inName )
+			printf( "%s\n", parser.Value() );
+	}
+	@endverbatim
+
+	Each call to Next() returns the next event:
+	- START_ELEMENT: Name() is the tag name. It is followed by an ATTRIBUTE event
+	  for each attribute, and then the content of the element.
+	- ATTRIBUTE: Name() and Value() are the attribute name and value.
+	- END_ELEMENT: Name() is the tag name. An empty tag ( <foo/> ) produces
+	  a START_ELEMENT and an END_ELEMENT.
+	- TEXT: Value() is the text. CData() is true for a CDATA section.
+	  Blank text is skipped, as it is in the DOM.
+	- COMMENT, UNKNOWN: Value() is the content of the node.
+	- DECLARATION: Name() is "xml". The version, encoding and standalone
+	  values follow as ATTRIBUTE events.
+	- END_DOCUMENT and PARSE_ERROR: the parse is over. Further calls to Next()
+	  return the same event.
+
+	Unlike the DOM, a pull parser does not detect duplicate attributes.
+
+	If you prefer callbacks, Accept() will run the parser to the end and
+	call a TiXmlSaxHandler for each event.
+*/
+class TiXmlPullParser
+{
+public:
+	enum Event
+	{
+		START_DOCUMENT,		// before the first call to Next()
+		START_ELEMENT,
+		ATTRIBUTE,
+		END_ELEMENT,
+		TEXT,
+		COMMENT,
+		DECLARATION,
+		UNKNOWN,
+		END_DOCUMENT,
+		PARSE_ERROR,
+		NEED_INPUT			// only used by TiXmlPushParser
+	};
+
+	/// Create a parser for the null terminated string 'xml'.
+	TiXmlPullParser( const char* xml, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
+
+	/// Read the next event.
+	Event Next();
+
+	/// The last event returned by Next().
+	Event Current() const			{ return event; }
+
+	/// The element or attribute name of the current event.
+	const char* Name() const		{ return name.c_str(); }
+	/// The attribute value, text, comment or unknown content of the current event.
+	const char* Value() const		{ return value.c_str(); }
+	/// True if the current TEXT event is a CDATA section.
+	bool CData() const				{ return cdata; }
+	/// The number of elements open. A START_ELEMENT for the root element is at depth 1.
+	int Depth() const				{ return depth; }
+
+	/** Run the parser to the end, and call the handler for each event. If the
+		handler returns false, parsing stops. Returns false if there was a parse error.
+	*/
+	bool Accept( TiXmlSaxHandler* handler );
+
+	/// True if the parser stopped on an error.
+	bool Error() const				{ return event == PARSE_ERROR; }
+	/// The error id, as in TiXmlDocument::ErrorId().
+	int ErrorId() const				{ return errorId; }
+	/// The error description, as in TiXmlDocument::ErrorDesc().
+	const char* ErrorDesc() const;
+	/// The row (1-based) where the error occured. Tabs count as 4 columns.
+	int ErrorRow() const			{ return errorLocation.row+1; }
+	int ErrorCol() const			{ return errorLocation.col+1; }	///< The column where the error occured. See ErrorRow()
+
+private:
+	friend class TiXmlPushParser;
+
+	TiXmlPullParser( const TiXmlPullParser& );		// not implemented.
+	void operator=( const TiXmlPullParser& );		// not allowed.
+
+	// Used by TiXmlPushParser, which calls Start() once it has some input.
+	TiXmlPullParser( TiXmlEncoding encoding );
+	void Start( const char* xml );
+
+	enum
+	{
+		TAG_NONE,			// reading content
+		TAG_ELEMENT,		// reading the attributes of a start tag
+		TAG_DECLARATION		// reading the attributes of a declaration
+	};
+
+	Event SetError( int err, const char* pError );
+	bool Dispatch( Event e, TiXmlSaxHandler* handler );
+	bool HaveToken();
+	void Discard( size_t length );
+	Event ReadContent();
+	Event ReadTagAttribute();
+	Event ReadDeclarationAttribute();
+	bool ReadAttribute();
+	void PushElement();
+	void PopElement();
+
+	const char*		start;
+	const char*		p;
+	TiXmlEncoding	encoding;
+	Event			event;
+	int				tagState;
+	bool			detectEncoding;		// the declaration may still set the encoding
+	bool			cdata;
+	int				depth;
+	TIXML_STRING	name;
+	TIXML_STRING	value;
+	TIXML_STRING	openElements;		// names of the open elements, each followed by a null
+	int				errorId;
+	TiXmlCursor		errorLocation;
+
+	// Incremental input: the text from 'start' may be continued, and
+	// 'startLocation' is where 'start' is in the whole input.
+	bool			incremental;
+	TiXmlCursor		startLocation;
+
+	// How far HaveToken() has looked past 'p' for the end of a token that
+	// isn't complete yet, so the next Feed() doesn't scan it all again.
+	enum
+	{
+		SCAN_NONE,
+		SCAN_TEXT,
+		SCAN_COMMENT,
+		SCAN_CDATA,
+		SCAN_TAG,			// an element or declaration, with quoted values
+		SCAN_OTHER
+	};
+	int				scanKind;
+	size_t			scanned;
+	char			scanQuote;			// the quote of an open attribute value, or 0
+};
+
+
+/**	Callbacks for TiXmlPullParser::Accept(). All the methods have a default
+	implementation that returns true (continue parsing); override the ones
+	you are interested in. Return false to stop the parse.
+
+	The strings passed are only valid for the duration of the call.
+
+	@sa TiXmlPushParser
+*/
+class TiXmlSaxHandler
+{
+public:
+	virtual ~TiXmlSaxHandler() {}
+
+	/// An element has started. Its attributes follow.
+	virtual bool StartElement( const char* /*name*/ )						{ return true; }
+	/// An attribute of the last element or declaration.
+	virtual bool Attribute( const char* /*name*/, const char* /*value*/ )	{ return true; }
+	/// An element has ended.
+	virtual bool EndElement( const char* /*name*/ )							{ return true; }
+	/// Text (or a CDATA section) inside an element.
+	virtual bool Text( const char* /*text*/, bool /*cdata*/ )				{ return true; }
+	/// A comment.
+	virtual bool Comment( const char* /*comment*/ )							{ return true; }
+	/// A declaration. Its attributes follow.
+	virtual bool Declaration()												{ return true; }
+	/// Something the parser doesn't understand.
+	virtual bool Unknown( const char* /*unknown*/ )							{ return true; }
+};
+
+
+/**	A push parser is given the document in pieces, as they arrive (from a socket,
+	say), and calls a TiXmlSaxHandler for each event as soon as the input for it
+	is complete. Parsing can then overlap with the transfer, and the whole
+	document is never in memory: only the input that hasn't been parsed yet is
+	kept. The pieces can be split anywhere.
+
+	@verbatim
+	TiXmlPushParser parser( &handler );
+	while ( ( n = socket.Recv( buf, sizeof( buf ) ) ) > 0 )
+	{
+		if ( !parser.Feed( buf, n ) )
+			break;
+	}
+	parser.Finish();
+	@endverbatim
+
+	The events are the same as those of TiXmlPullParser::Accept() for the whole
+	document. The end of the document is only known when Finish() is called.
+*/
+class TiXmlPushParser
+{
+public:
+	/// Create a parser that calls 'handler' for each event.
+	TiXmlPushParser( TiXmlSaxHandler* handler, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
+
+	/** Parse the next 'length' bytes of the document. Returns false if there was
+		an error, or if the handler stopped the parse; no more input is needed then.
+	*/
+	bool Feed( const char* data, size_t length );
+
+	/// Tell the parser the input is complete. Returns false if there was an error.
+	bool Finish();
+
+	/// True when the document ended, had an error, or the handler stopped the parse.
+	bool Done() const				{ return done; }
+	/// The number of elements open.
+	int Depth() const				{ return parser.Depth(); }
+
+	/// True if the parse stopped on an error.
+	bool Error() const				{ return parser.Error(); }
+	/// The error id, as in TiXmlDocument::ErrorId().
+	int ErrorId() const				{ return parser.ErrorId(); }
+	/// The error description, as in TiXmlDocument::ErrorDesc().
+	const char* ErrorDesc() const	{ return parser.ErrorDesc(); }
+	/// The row (1-based) of the error, counted over all the input.
+	int ErrorRow() const			{ return parser.ErrorRow(); }
+	int ErrorCol() const			{ return parser.ErrorCol(); }	///< The column of the error. See ErrorRow()
+
+private:
+	TiXmlPushParser( const TiXmlPushParser& );		// not implemented.
+	void operator=( const TiXmlPushParser& );		// not allowed.
+
+	void Run();
+
+	TiXmlPullParser		parser;
+	TiXmlSaxHandler*	handler;
+	TIXML_STRING		buffer;		// the input not parsed yet
+	bool				started;
+	bool				done;
+};
+
+
+class TiXmlSnapshot;
+
+/**	A node of a TiXmlSnapshot. It is a small value, a position in the
+	snapshot, and is passed and copied as one. A null node (IsNull())
+	is returned where TiXmlNode would return a null pointer, and every
+	call on a null node returns null again, so calls can be chained as
+	with TiXmlHandle.
+*/
+class TiXmlSnapshotNode
+{
+public:
+	TiXmlSnapshotNode() : snapshot( 0 ), index( 0 )		{}
+
+	/// True if there is no node here.
+	bool IsNull() const								{ return snapshot == 0; }
+	/// The type of the node, one of TiXmlNode::NodeType. -1 if null.
+	int Type() const;
+	/// The value of the node, as TiXmlNode::Value(): the name of an element. Null if null.
+	const char* Value() const;
+	/// True for a text node that was a CDATA section.
+	bool CDATA() const;
+
+	TiXmlSnapshotNode Parent() const;
+	TiXmlSnapshotNode FirstChild() const;
+	TiXmlSnapshotNode NextSibling() const;
+	/// The first child element, with the given name if 'name' is not null.
+	TiXmlSnapshotNode FirstChildElement( const char* name = 0 ) const;
+	/// The next sibling element, with the given name if 'name' is not null.
+	TiXmlSnapshotNode NextSiblingElement( const char* name = 0 ) const;
+
+	/// The text of an element whose first child is text, as TiXmlElement::GetText().
+	const char* GetText() const;
+	/// The value of an attribute, or null if there is no such attribute.
+	const char* Attribute( const char* name ) const;
+	/// The number of attributes. (The version, encoding and standalone of a declaration.)
+	int AttributeCount() const;
+	const char* AttributeName( int i ) const;	///< The name of attribute 'i', in document order.
+	const char* AttributeValue( int i ) const;	///< The value of attribute 'i'.
+
+	bool operator==( const TiXmlSnapshotNode& other ) const	{ return snapshot == other.snapshot && index == other.index; }
+	bool operator!=( const TiXmlSnapshotNode& other ) const	{ return !( *this == other ); }
+
+private:
+	friend class TiXmlSnapshot;
+
+	TiXmlSnapshotNode( const TiXmlSnapshot* _snapshot, unsigned _index ) : snapshot( _snapshot ), index( _index )	{}
+
+	const TiXmlSnapshot* snapshot;
+	unsigned index;
+};
+
+
+/**	A read-only document in a compact binary form, which is used where it
+	lies in memory: nothing is parsed or allocated to load it. A large
+	document that rarely changes can be converted once, with Write() or
+	SaveFile(), and then each process maps the snapshot in with LoadFile()
+	and navigates it straight away.
+
+	@verbatim
+	// Once, when the reference data changes:
+	TiXmlDocument doc( "genres.xml" );
+	doc.LoadFile();
+	TiXmlSnapshot::SaveFile( doc, "genres.snap" );
+
+	// At startup:
+	TiXmlSnapshot genres;
+	if ( genres.LoadFile( "genres.snap" ) )
+	{
+		for( TiXmlSnapshotNode genre = genres.RootElement().FirstChildElement( "genre" );
+			 !genre.IsNull();
+			 genre = genre.NextSiblingElement( "genre" ) )
+		{
+			printf( "%s\n", genre.Attribute( "name" ) );
+		}
+	}
+	@endverbatim
+
+	The nodes refer to each other, and to their strings, by index and
+	offset, so the snapshot is valid wherever it is mapped. It is checked
+	when it is loaded; a damaged or foreign file fails to load, and can't
+	be navigated out of bounds. Snapshots are in the byte order of the
+	machine that wrote them, and don't load on one with another.
+
+	CopyTo() makes an ordinary TiXmlDocument again, which can be printed,
+	so a snapshot converts back to text XML.
+*/
+class TiXmlSnapshot
+{
+public:
+	TiXmlSnapshot();
+	~TiXmlSnapshot();
+
+	/** Convert 'node' (usually a document) and everything under it to a
+		snapshot, appended to 'out'. Returns false if it is too large for
+		32 bit offsets.
+	*/
+	static bool Write( const TiXmlNode& node, TIXML_STRING* out );
+	/// Write the snapshot of 'node' to a file. Returns true if successful.
+	static bool SaveFile( const TiXmlNode& node, const char* filename );
+
+	/** Load a snapshot file. It is mapped in read-only where the system
+		can, and read otherwise. Returns true if the file is a valid snapshot.
+	*/
+	bool LoadFile( const char* filename );
+	/** Use a snapshot that is already in memory, aligned to 4 bytes. The
+		memory is not copied, and must stay valid until the snapshot is
+		closed. Returns true if it is a valid snapshot.
+	*/
+	bool Attach( const void* data, size_t length );
+	/// Let go of the snapshot. The nodes from it must not be used after this.
+	void Close();
+
+	/// The top node: the document, or whatever node was written.
+	TiXmlSnapshotNode Root() const;
+	/// The first element under Root().
+	TiXmlSnapshotNode RootElement() const	{ return Root().FirstChildElement(); }
+	/// The number of nodes, 0 if nothing is loaded.
+	int NodeCount() const					{ return (int) nodeCount; }
+
+	/** Rebuild the snapshot as a document, replacing what 'doc' held.
+		If the snapshot was not written from a document, its top node
+		becomes the child of 'doc'. Returns false if nothing is loaded.
+	*/
+	bool CopyTo( TiXmlDocument* doc ) const;
+
+	// The file format: a Header, then the nodes, the attributes and the strings.
+	// Indexes and offsets are 32 bits, in the byte order of the writer.
+	struct Header
+	{
+		char magic[8];				// "TiXmlSn1"
+		unsigned int byteOrder;		// 0x01020304
+		unsigned int nodeCount;
+		unsigned int attributeCount;
+		unsigned int stringSize;	// bytes of null terminated strings
+	};
+	struct Node
+	{
+		unsigned int type;			// TiXmlNode::NodeType, plus CDATA_FLAG
+		unsigned int value;			// offset in the strings
+		unsigned int parent;		// indexes of nodes, or NONE
+		unsigned int firstChild;
+		unsigned int nextSibling;
+		unsigned int firstAttribute;
+		unsigned int attributeCount;
+	};
+	struct Attribute
+	{
+		unsigned int name;
+		unsigned int value;
+	};
+	enum
+	{
+		NONE = 0xffffffff,
+		CDATA_FLAG = 0x100
+	};
+
+private:
+	friend class TiXmlSnapshotNode;
+
+	TiXmlSnapshot( const TiXmlSnapshot& );		// not implemented.
+	void operator=( const TiXmlSnapshot& );		// not allowed.
+
+	bool Use( const void* data, size_t length );
+	void CopyNode( unsigned index, TiXmlNode* parent ) const;
+
+	const Node*			nodes;
+	const Attribute*	attributes;
+	const char*			strings;
+	unsigned			nodeCount;
+	unsigned			attributeCount;
+
+	void*	mapped;			// a mapping of the file, or
+	size_t	mappedLength;
+	char*	owned;			// a copy of it, or neither for Attach()
 };
 
 
@@ -27,6 +27,10 @@ distribution.
 
 #include "tinyxml.h"
 
+#ifdef TIXML_SIMD
+#	include <immintrin.h>
+#endif
+
 //#define DEBUG_PARSER
 #if defined( DEBUG_PARSER )
 #	if defined( DEBUG ) && defined( _MSC_VER )
@@ -171,29 +175,37 @@ void TiXmlBase::ConvertUTF32ToUTF8( unsigned long input, char* output, int* leng
 class TiXmlParsingData
 {
 	friend class TiXmlDocument;
+	friend class TiXmlPullParser;
   public:
-	void Stamp( const char* now, TiXmlEncoding encoding );
+	void Stamp( const char* now, TiXmlEncoding encoding )	{ if ( !lazy ) Advance( now, encoding ); }
 
-	const TiXmlCursor& Cursor()	{ return cursor; }
+	const TiXmlCursor& Cursor()	{ return lazy ? unknown : cursor; }
 
   private:
-	// Only used by the document!
-	TiXmlParsingData( const char* start, int _tabsize, int row, int col )
+	// Only used by the document (and the pull parser.)
+	TiXmlParsingData( const char* start, int _tabsize, int row, int col, bool _lazy = false )
 	{
 		assert( start );
 		stamp = start;
 		tabsize = _tabsize;
+		lazy = _lazy;
 		cursor.row = row;
 		cursor.col = col;
 	}
 
+	// Moves the cursor up to 'now'. When lazy, only errors get this far: the
+	// nodes are not stamped, and the cursor walks from the start in one go.
+	void Advance( const char* now, TiXmlEncoding encoding );
+
 	TiXmlCursor		cursor;
+	TiXmlCursor		unknown;	// Cleared: what the nodes get when lazy.
 	const char*		stamp;
 	int				tabsize;
+	bool			lazy;
 };
 
 
-void TiXmlParsingData::Stamp( const char* now, TiXmlEncoding encoding )
+void TiXmlParsingData::Advance( const char* now, TiXmlEncoding encoding )
 {
 	assert( now );
 
@@ -311,6 +323,394 @@ void TiXmlParsingData::Stamp( const char* now, TiXmlEncoding encoding )
 }
 
 
+// The scanners. The byte by byte versions are the reference; the SSE2 and AVX2
+// versions must stop at exactly the same character.
+
+static inline bool IsSpaceByte( unsigned char c )
+{
+	// The ASCII characters isspace() accepts: ' ', \t, \n, \v, \f and \r.
+	return c == ' ' || ( c >= 9 && c <= 13 );
+}
+
+static inline bool IsNameByte( unsigned char c )
+{
+	// As IsAlphaNum(), everything from 127 up is a letter.
+	return    ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || ( c >= '0' && c <= '9' )
+		   || c == '_' || c == '-' || c == '.' || c == ':' || c >= 127;
+}
+
+static inline bool IsEscapeByte( unsigned char c )
+{
+	return c < 32 || c == '&' || c == '<' || c == '>' || c == '\"' || c == '\'';
+}
+
+static inline bool IsTextStop( const char* p, char endChar, bool condense, bool stopAtHighBytes )
+{
+	unsigned char c = *p;
+	if ( c == 0 || c == '&' || c == '\r' || c == (unsigned char) endChar || ( stopAtHighBytes && c >= 128 ) )
+		return true;
+	if ( condense && IsSpaceByte( c ) )
+	{
+		// A single space between two characters of text is kept as it is.
+		unsigned char next = p[1];
+		return c != ' ' || next == 0 || next == (unsigned char) endChar || IsSpaceByte( next );
+	}
+	return false;
+}
+
+#ifdef TIXML_SIMD
+
+// The vector loops use aligned loads. An aligned block never crosses a page, so
+// reading the whole block that holds the null terminator is safe, but it can read
+// past the end of the allocation, which AddressSanitizer would report.
+#define TIXML_SIMD_FUNCTION( isa )	__attribute__(( target( isa ), no_sanitize_address ))
+
+TIXML_SIMD_FUNCTION( "sse2" )
+static const char* ScanWhiteSpaceSSE2( const char* p )
+{
+	while ( (size_t) p & 15 )
+	{
+		if ( !IsSpaceByte( *p ) )
+			return p;
+		++p;
+	}
+	const __m128i space = _mm_set1_epi8( ' ' );
+	const __m128i belowTab = _mm_set1_epi8( 8 );
+	const __m128i aboveCR = _mm_set1_epi8( 14 );
+	for( ;; )
+	{
+		__m128i v = _mm_load_si128( (const __m128i*) p );
+		__m128i ws = _mm_or_si128(	_mm_cmpeq_epi8( v, space ),
+									_mm_and_si128( _mm_cmpgt_epi8( v, belowTab ), _mm_cmplt_epi8( v, aboveCR ) ) );
+		unsigned stop = ~(unsigned) _mm_movemask_epi8( ws ) & 0xffff;
+		if ( stop )
+			return p + __builtin_ctz( stop );
+		p += 16;
+	}
+}
+
+TIXML_SIMD_FUNCTION( "avx2" )
+static const char* ScanWhiteSpaceAVX2( const char* p )
+{
+	while ( (size_t) p & 31 )
+	{
+		if ( !IsSpaceByte( *p ) )
+			return p;
+		++p;
+	}
+	const __m256i space = _mm256_set1_epi8( ' ' );
+	const __m256i belowTab = _mm256_set1_epi8( 8 );
+	const __m256i aboveCR = _mm256_set1_epi8( 14 );
+	for( ;; )
+	{
+		__m256i v = _mm256_load_si256( (const __m256i*) p );
+		__m256i ws = _mm256_or_si256(	_mm256_cmpeq_epi8( v, space ),
+										_mm256_and_si256( _mm256_cmpgt_epi8( v, belowTab ), _mm256_cmpgt_epi8( aboveCR, v ) ) );
+		unsigned stop = ~(unsigned) _mm256_movemask_epi8( ws );
+		if ( stop )
+			return p + __builtin_ctz( stop );
+		p += 32;
+	}
+}
+
+TIXML_SIMD_FUNCTION( "sse2" )
+static const char* ScanNameSSE2( const char* p )
+{
+	while ( (size_t) p & 15 )
+	{
+		if ( !IsNameByte( *p ) )
+			return p;
+		++p;
+	}
+	const __m128i lowerCase = _mm_set1_epi8( 0x20 );
+	const __m128i belowA = _mm_set1_epi8( 'a' - 1 );
+	const __m128i aboveZ = _mm_set1_epi8( 'z' + 1 );
+	const __m128i belowDash = _mm_set1_epi8( '-' - 1 );		// '-', '.', '/', '0'-'9', ':'
+	const __m128i aboveColon = _mm_set1_epi8( ':' + 1 );
+	const __m128i slash = _mm_set1_epi8( '/' );
+	const __m128i underscore = _mm_set1_epi8( '_' );
+	const __m128i del = _mm_set1_epi8( 127 );
+	const __m128i zero = _mm_setzero_si128();
+	for( ;; )
+	{
+		__m128i v = _mm_load_si128( (const __m128i*) p );
+		__m128i folded = _mm_or_si128( v, lowerCase );
+		__m128i name = _mm_and_si128( _mm_cmpgt_epi8( folded, belowA ), _mm_cmplt_epi8( folded, aboveZ ) );
+		name = _mm_or_si128( name, _mm_andnot_si128(	_mm_cmpeq_epi8( v, slash ),
+														_mm_and_si128( _mm_cmpgt_epi8( v, belowDash ), _mm_cmplt_epi8( v, aboveColon ) ) ) );
+		name = _mm_or_si128( name, _mm_cmpeq_epi8( v, underscore ) );
+		name = _mm_or_si128( name, _mm_cmpeq_epi8( v, del ) );
+		name = _mm_or_si128( name, _mm_cmplt_epi8( v, zero ) );		// 128 and up
+		unsigned stop = ~(unsigned) _mm_movemask_epi8( name ) & 0xffff;
+		if ( stop )
+			return p + __builtin_ctz( stop );
+		p += 16;
+	}
+}
+
+TIXML_SIMD_FUNCTION( "avx2" )
+static const char* ScanNameAVX2( const char* p )
+{
+	while ( (size_t) p & 31 )
+	{
+		if ( !IsNameByte( *p ) )
+			return p;
+		++p;
+	}
+	const __m256i lowerCase = _mm256_set1_epi8( 0x20 );
+	const __m256i belowA = _mm256_set1_epi8( 'a' - 1 );
+	const __m256i aboveZ = _mm256_set1_epi8( 'z' + 1 );
+	const __m256i belowDash = _mm256_set1_epi8( '-' - 1 );
+	const __m256i aboveColon = _mm256_set1_epi8( ':' + 1 );
+	const __m256i slash = _mm256_set1_epi8( '/' );
+	const __m256i underscore = _mm256_set1_epi8( '_' );
+	const __m256i del = _mm256_set1_epi8( 127 );
+	const __m256i zero = _mm256_setzero_si256();
+	for( ;; )
+	{
+		__m256i v = _mm256_load_si256( (const __m256i*) p );
+		__m256i folded = _mm256_or_si256( v, lowerCase );
+		__m256i name = _mm256_and_si256( _mm256_cmpgt_epi8( folded, belowA ), _mm256_cmpgt_epi8( aboveZ, folded ) );
+		name = _mm256_or_si256( name, _mm256_andnot_si256(	_mm256_cmpeq_epi8( v, slash ),
+															_mm256_and_si256( _mm256_cmpgt_epi8( v, belowDash ), _mm256_cmpgt_epi8( aboveColon, v ) ) ) );
+		name = _mm256_or_si256( name, _mm256_cmpeq_epi8( v, underscore ) );
+		name = _mm256_or_si256( name, _mm256_cmpeq_epi8( v, del ) );
+		name = _mm256_or_si256( name, _mm256_cmpgt_epi8( zero, v ) );
+		unsigned stop = ~(unsigned) _mm256_movemask_epi8( name );
+		if ( stop )
+			return p + __builtin_ctz( stop );
+		p += 32;
+	}
+}
+
+TIXML_SIMD_FUNCTION( "sse2" )
+static const char* ScanTextSSE2( const char* p, char endChar, bool condense, bool stopAtHighBytes )
+{
+	while ( (size_t) p & 15 )
+	{
+		if ( IsTextStop( p, endChar, condense, stopAtHighBytes ) )
+			return p;
+		++p;
+	}
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i amp = _mm_set1_epi8( '&' );
+	const __m128i end = _mm_set1_epi8( endChar );
+	const __m128i cr = _mm_set1_epi8( '\r' );
+	const __m128i space = _mm_set1_epi8( ' ' );
+	const __m128i belowTab = _mm_set1_epi8( 8 );
+	const __m128i aboveCR = _mm_set1_epi8( 14 );
+	for( ;; )
+	{
+		__m128i v = _mm_load_si128( (const __m128i*) p );
+		__m128i zeroOrEnd = _mm_or_si128( _mm_cmpeq_epi8( v, zero ), _mm_cmpeq_epi8( v, end ) );
+		unsigned stop = (unsigned) _mm_movemask_epi8( _mm_or_si128( zeroOrEnd, _mm_or_si128( _mm_cmpeq_epi8( v, amp ), _mm_cmpeq_epi8( v, cr ) ) ) );
+		if ( stopAtHighBytes )
+			stop |= (unsigned) _mm_movemask_epi8( v );
+		if ( condense )
+		{
+			// Stop at white space other than ' ', and at a ' ' that isn't followed
+			// by text. (The last byte can't see the next block: stop to be safe.)
+			unsigned spaces = (unsigned) _mm_movemask_epi8( _mm_cmpeq_epi8( v, space ) );
+			unsigned others = (unsigned) _mm_movemask_epi8( _mm_and_si128( _mm_cmpgt_epi8( v, belowTab ), _mm_cmplt_epi8( v, aboveCR ) ) );
+			unsigned notText = spaces | others | (unsigned) _mm_movemask_epi8( zeroOrEnd );
+			stop |= others | ( spaces & ( ( notText >> 1 ) | 0x8000u ) );
+		}
+		if ( stop )
+			return p + __builtin_ctz( stop );
+		p += 16;
+	}
+}
+
+TIXML_SIMD_FUNCTION( "avx2" )
+static const char* ScanTextAVX2( const char* p, char endChar, bool condense, bool stopAtHighBytes )
+{
+	while ( (size_t) p & 31 )
+	{
+		if ( IsTextStop( p, endChar, condense, stopAtHighBytes ) )
+			return p;
+		++p;
+	}
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i amp = _mm256_set1_epi8( '&' );
+	const __m256i end = _mm256_set1_epi8( endChar );
+	const __m256i cr = _mm256_set1_epi8( '\r' );
+	const __m256i space = _mm256_set1_epi8( ' ' );
+	const __m256i belowTab = _mm256_set1_epi8( 8 );
+	const __m256i aboveCR = _mm256_set1_epi8( 14 );
+	for( ;; )
+	{
+		__m256i v = _mm256_load_si256( (const __m256i*) p );
+		__m256i zeroOrEnd = _mm256_or_si256( _mm256_cmpeq_epi8( v, zero ), _mm256_cmpeq_epi8( v, end ) );
+		unsigned stop = (unsigned) _mm256_movemask_epi8( _mm256_or_si256( zeroOrEnd, _mm256_or_si256( _mm256_cmpeq_epi8( v, amp ), _mm256_cmpeq_epi8( v, cr ) ) ) );
+		if ( stopAtHighBytes )
+			stop |= (unsigned) _mm256_movemask_epi8( v );
+		if ( condense )
+		{
+			// Stop at white space other than ' ', and at a ' ' that isn't followed
+			// by text. (The last byte can't see the next block: stop to be safe.)
+			unsigned spaces = (unsigned) _mm256_movemask_epi8( _mm256_cmpeq_epi8( v, space ) );
+			unsigned others = (unsigned) _mm256_movemask_epi8( _mm256_and_si256( _mm256_cmpgt_epi8( v, belowTab ), _mm256_cmpgt_epi8( aboveCR, v ) ) );
+			unsigned notText = spaces | others | (unsigned) _mm256_movemask_epi8( zeroOrEnd );
+			stop |= others | ( spaces & ( ( notText >> 1 ) | 0x80000000u ) );
+		}
+		if ( stop )
+			return p + __builtin_ctz( stop );
+		p += 32;
+	}
+}
+
+// The output isn't null terminated where the scan must stop, so this one stays
+// inside [p, end) with unaligned loads, and finishes byte by byte.
+TIXML_SIMD_FUNCTION( "sse2" )
+static const char* ScanEscapeSSE2( const char* p, const char* end )
+{
+	const __m128i control = _mm_set1_epi8( 31 );
+	const __m128i amp = _mm_set1_epi8( '&' );
+	const __m128i lt = _mm_set1_epi8( '<' );
+	const __m128i gt = _mm_set1_epi8( '>' );
+	const __m128i quot = _mm_set1_epi8( '\"' );
+	const __m128i apos = _mm_set1_epi8( '\'' );
+	while ( end - p >= 16 )
+	{
+		__m128i v = _mm_loadu_si128( (const __m128i*) p );
+		__m128i escape = _mm_cmpeq_epi8( _mm_min_epu8( v, control ), v );		// under 32
+		escape = _mm_or_si128( escape, _mm_or_si128( _mm_cmpeq_epi8( v, amp ), _mm_cmpeq_epi8( v, quot ) ) );
+		escape = _mm_or_si128( escape, _mm_or_si128( _mm_cmpeq_epi8( v, lt ), _mm_cmpeq_epi8( v, gt ) ) );
+		escape = _mm_or_si128( escape, _mm_cmpeq_epi8( v, apos ) );
+		unsigned stop = (unsigned) _mm_movemask_epi8( escape );
+		if ( stop )
+			return p + __builtin_ctz( stop );
+		p += 16;
+	}
+	while ( p < end && !IsEscapeByte( *p ) )
+		++p;
+	return p;
+}
+
+TIXML_SIMD_FUNCTION( "avx2" )
+static const char* ScanEscapeAVX2( const char* p, const char* end )
+{
+	const __m256i control = _mm256_set1_epi8( 31 );
+	const __m256i amp = _mm256_set1_epi8( '&' );
+	const __m256i lt = _mm256_set1_epi8( '<' );
+	const __m256i gt = _mm256_set1_epi8( '>' );
+	const __m256i quot = _mm256_set1_epi8( '\"' );
+	const __m256i apos = _mm256_set1_epi8( '\'' );
+	while ( end - p >= 32 )
+	{
+		__m256i v = _mm256_loadu_si256( (const __m256i*) p );
+		__m256i escape = _mm256_cmpeq_epi8( _mm256_min_epu8( v, control ), v );
+		escape = _mm256_or_si256( escape, _mm256_or_si256( _mm256_cmpeq_epi8( v, amp ), _mm256_cmpeq_epi8( v, quot ) ) );
+		escape = _mm256_or_si256( escape, _mm256_or_si256( _mm256_cmpeq_epi8( v, lt ), _mm256_cmpeq_epi8( v, gt ) ) );
+		escape = _mm256_or_si256( escape, _mm256_cmpeq_epi8( v, apos ) );
+		unsigned stop = (unsigned) _mm256_movemask_epi8( escape );
+		if ( stop )
+			return p + __builtin_ctz( stop );
+		p += 32;
+	}
+	return ScanEscapeSSE2( p, end );
+}
+
+#endif	// TIXML_SIMD
+
+
+/*static*/ int TiXmlBase::SimdLevel()
+{
+	#ifdef TIXML_SIMD
+		// Checked on first use. Threads that race here all store the same value.
+		static int level = -1;
+		if ( level < 0 )
+		{
+			__builtin_cpu_init();
+			if ( __builtin_cpu_supports( "avx2" ) )
+				level = TIXML_SIMD_AVX2;
+			else if ( __builtin_cpu_supports( "sse2" ) )
+				level = TIXML_SIMD_SSE2;
+			else
+				level = TIXML_SIMD_NONE;
+		}
+		return level;
+	#else
+		return TIXML_SIMD_NONE;
+	#endif
+}
+
+
+/*static*/ const char* TiXmlBase::ScanWhiteSpace( const char* p )
+{
+	// Most runs are short, or empty: don't bother the vector code with those.
+	if ( !IsSpaceByte( p[0] ) || !IsSpaceByte( p[1] ) )
+		return IsSpaceByte( p[0] ) ? p+1 : p;
+
+	#ifdef TIXML_SIMD
+		switch ( SimdLevel() )
+		{
+			case TIXML_SIMD_AVX2:	return ScanWhiteSpaceAVX2( p );
+			case TIXML_SIMD_SSE2:	return ScanWhiteSpaceSSE2( p );
+		}
+	#endif
+	while ( IsSpaceByte( *p ) )
+		++p;
+	return p;
+}
+
+
+/*static*/ const char* TiXmlBase::ScanName( const char* p )
+{
+	#ifdef TIXML_SIMD
+		switch ( SimdLevel() )
+		{
+			case TIXML_SIMD_AVX2:	return ScanNameAVX2( p );
+			case TIXML_SIMD_SSE2:	return ScanNameSSE2( p );
+		}
+	#endif
+	while ( IsNameByte( *p ) )
+		++p;
+	return p;
+}
+
+
+/*static*/ const char* TiXmlBase::ScanText( const char* p, char endChar, bool condense, bool stopAtHighBytes )
+{
+	if ( IsTextStop( p, endChar, condense, stopAtHighBytes ) )
+		return p;
+
+	#ifdef TIXML_SIMD
+		switch ( SimdLevel() )
+		{
+			case TIXML_SIMD_AVX2:	return ScanTextAVX2( p, endChar, condense, stopAtHighBytes );
+			case TIXML_SIMD_SSE2:	return ScanTextSSE2( p, endChar, condense, stopAtHighBytes );
+		}
+	#endif
+	while ( !IsTextStop( p, endChar, condense, stopAtHighBytes ) )
+		++p;
+	return p;
+}
+
+
+/*static*/ const char* TiXmlBase::ScanEscape( const char* p, const char* end )
+{
+	// Names and short values: not worth the vector code.
+	if ( end - p < 16 )
+	{
+		while ( p < end && !IsEscapeByte( *p ) )
+			++p;
+		return p;
+	}
+
+	#ifdef TIXML_SIMD
+		switch ( SimdLevel() )
+		{
+			case TIXML_SIMD_AVX2:	return ScanEscapeAVX2( p, end );
+			case TIXML_SIMD_SSE2:	return ScanEscapeSSE2( p, end );
+		}
+	#endif
+	while ( p < end && !IsEscapeByte( *p ) )
+		++p;
+	return p;
+}
+
+
 const char* TiXmlBase::SkipWhiteSpace( const char* p, TiXmlEncoding encoding )
 {
 	if ( !p || !*p )
@@ -321,6 +721,7 @@ const char* TiXmlBase::SkipWhiteSpace( const char* p, TiXmlEncoding encoding )
 	{
 		while ( *p )
 		{
+			p = ScanWhiteSpace( p );
 			const unsigned char* pU = (const unsigned char*)p;
 			
 			// Skip the stupid Microsoft UTF-8 Byte order marks
@@ -354,6 +755,7 @@ const char* TiXmlBase::SkipWhiteSpace( const char* p, TiXmlEncoding encoding )
 	}
 	else
 	{
+		p = ScanWhiteSpace( p );
 		while ( *p && IsWhiteSpace( *p ) )
 			++p;
 	}
@@ -362,48 +764,137 @@ const char* TiXmlBase::SkipWhiteSpace( const char* p, TiXmlEncoding encoding )
 }
 
 #ifdef TIXML_USE_STL
-/*static*/ bool TiXmlBase::StreamWhiteSpace( std::istream * in, TIXML_STRING * tag )
+// Reads straight from the get area of the stream's buffer, so the stream
+// functions can scan and append a block of characters at a time rather
+// than going through peek() and get() for each one. [internal use]
+class TiXmlStreamReader
 {
-	for( ;; )
+public:
+	TiXmlStreamReader( std::istream* _in ) : in( _in ), buf( _in->rdbuf() ), begin( 0 ), end( 0 ), single( 0 ) {}
+
+	// Points Begin() and End() at the characters waiting in the stream,
+	// refilling the buffer if it has run dry. Returns false at the end
+	// of the stream.
+	bool Fill()
+	{
+		if ( !buf || !in->good() )
+			return false;
+
+		begin = Access::Next( buf );
+		end = Access::End( buf );
+		if ( begin == end )
+		{
+			int c = buf->sgetc();
+			if ( c == std::char_traits<char>::eof() )
+			{
+				in->setstate( std::ios::eofbit );
+				return false;
+			}
+			begin = Access::Next( buf );
+			end = Access::End( buf );
+			if ( begin == end )
+			{
+				// An unbuffered stream: one character at a time it is.
+				single = (char) c;
+				begin = &single;
+				end = begin + 1;
+			}
+		}
+		return true;
+	}
+
+	const char* Begin() const	{ return begin; }
+	const char* End() const		{ return end; }
+
+	// Takes the first 'n' characters found by Fill() out of the stream.
+	void Consume( size_t n )
+	{
+		if ( begin == &single )
+		{
+			if ( n )
+				buf->sbumpc();
+		}
+		else
+		{
+			Access::Bump( buf, (int) n );
+		}
+		begin += n;
+	}
+
+private:
+	// The get area is protected; naming it through a derived class is
+	// the standard way in from the outside.
+	class Access : public std::streambuf
 	{
-		if ( !in->good() ) return false;
+	public:
+		static const char* Next( std::streambuf* sb )	{ return (sb->*&Access::gptr)(); }
+		static const char* End( std::streambuf* sb )	{ return (sb->*&Access::egptr)(); }
+		static void Bump( std::streambuf* sb, int n )	{ (sb->*&Access::gbump)( n ); }
+	};
+
+	std::istream* in;
+	std::streambuf* buf;
+	const char* begin;
+	const char* end;
+	char single;
+};
 
-		int c = in->peek();
+
+/*static*/ bool TiXmlBase::StreamWhiteSpace( std::istream * in, TIXML_STRING * tag )
+{
+	TiXmlStreamReader reader( in );
+	while ( reader.Fill() )
+	{
+		const char* p = reader.Begin();
 		// At this scope, we can't get to a document. So fail silently.
-		if ( !IsWhiteSpace( c ) || c <= 0 )
-			return true;
+		while ( p < reader.End() && *p && IsWhiteSpace( *p ) )
+			++p;
 
-		*tag += (char) in->get();
+		size_t len = p - reader.Begin();
+		tag->append( reader.Begin(), len );
+		reader.Consume( len );
+		if ( p < reader.End() )
+			return true;
 	}
+	return false;
 }
 
 /*static*/ bool TiXmlBase::StreamTo( std::istream * in, int character, TIXML_STRING * tag )
 {
 	//assert( character > 0 && character < 128 );	// else it won't work in utf-8
-	while ( in->good() )
+	// Silent failure on a null: can't get document at this scope
+	return StreamSpan( in, tag, (char) character, (char) character ) == character;
+}
+
+/*static*/ int TiXmlBase::StreamSpan( std::istream * in, TIXML_STRING * tag, char stop0, char stop1 )
+{
+	TiXmlStreamReader reader( in );
+	while ( reader.Fill() )
 	{
-		int c = in->peek();
-		if ( c == character )
-			return true;
-		if ( c <= 0 )		// Silent failure: can't get document at this scope
-			return false;
+		const char* p = reader.Begin();
+		const char* end = reader.End();
+		while ( p < end && *p != stop0 && *p != stop1 && *p )
+			++p;
 
-		in->get();
-		*tag += (char) c;
+		size_t len = p - reader.Begin();
+		tag->append( reader.Begin(), len );
+		reader.Consume( len );
+		if ( p < end )
+			return (unsigned char) *p;
 	}
-	return false;
+	return -1;
 }
 #endif
 
 // One of TinyXML's more performance demanding functions. Try to keep the memory overhead down. The
-// "assign" optimization removes over 10% of the execution time.
+// "append" optimization (one call rather than a += per character) removes over 10% of the execution time.
 //
 const char* TiXmlBase::ReadName( const char* p, TIXML_STRING * name, TiXmlEncoding encoding )
 {
 	// Oddly, not supported on some comilers,
 	//name->clear();
-	// So use this:
-	*name = "";
+	// So use this, which also keeps the buffer of a reused string:
+	name->erase();
 	assert( p );
 
 	// Names start with letters or underscores.
@@ -417,29 +908,34 @@ const char* TiXmlBase::ReadName( const char* p, TIXML_STRING * name, TiXmlEncodi
 		 && ( IsAlpha( (unsigned char) *p, encoding ) || *p == '_' ) )
 	{
 		const char* start = p;
-		while(		p && *p
-				&&	(		IsAlphaNum( (unsigned char ) *p, encoding ) 
-						 || *p == '_'
-						 || *p == '-'
-						 || *p == '.'
-						 || *p == ':' ) )
-		{
-			//(*name) += *p; // expensive
-			++p;
-		}
+		// After the first character, letters, numbers, '_', '-', '.' and ':'. The
+		// test is the same as IsAlphaNum(), done many characters at a time.
+		p = ScanName( p );
 		if ( p-start > 0 ) {
-			name->assign( start, p-start );
+			name->append( start, p-start );
 		}
 		return p;
 	}
 	return 0;
 }
 
+// A hex digit that is already known to be one: 0-9 have bit 6 clear, and
+// A-F / a-f have it set with the value less 9 in the low nibble.
+static inline unsigned HexDigitValue( unsigned char c )
+{
+	return ( c & 0xf ) + 9 * ( c >> 6 );
+}
+
+
+static inline bool IsHexDigit( unsigned char c )
+{
+	return (unsigned)( c - '0' ) < 10 || (unsigned)( ( c | 0x20 ) - 'a' ) < 6;
+}
+
+
 const char* TiXmlBase::GetEntity( const char* p, char* value, int* length, TiXmlEncoding encoding )
 {
 	// Presume an entity, and pull it out.
-    TIXML_STRING ent;
-	int i;
 	*length = 0;
 
 	if ( *(p+1) && *(p+1) == '#' && *(p+2) )
@@ -453,26 +949,43 @@ const char* TiXmlBase::GetEntity( const char* p, char* value, int* length, TiXml
 			// Hexadecimal.
 			if ( !*(p+3) ) return 0;
 
+			// Run over the digits, rather than looking for the ';' first:
+			// a stray '&#x' then doesn't search the rest of the input.
 			const char* q = p+3;
-			q = strchr( q, ';' );
+			while ( IsHexDigit( *q ) )
+				++q;
 
-			if ( !q || !*q ) return 0;
-
-			delta = q-p;
-			--q;
+			if ( *q != ';' )
+			{
+				// Odd, or not a reference. Take the long way: like the
+				// original decoder, the digits start after the last 'x'
+				// before the ';'.
+				if ( !*q ) return 0;
+				q = strchr( q, ';' );
+				if ( !q || !*q ) return 0;
+
+				delta = q-p;
+				--q;
 
-			while ( *q != 'x' )
+				while ( *q != 'x' )
+				{
+					if ( !IsHexDigit( *q ) )
+						return 0;
+					ucs += mult * HexDigitValue( *q );
+					mult *= 16;
+					--q;
+				}
+			}
+			else
 			{
-				if ( *q >= '0' && *q <= '9' )
-					ucs += mult * (*q - '0');
-				else if ( *q >= 'a' && *q <= 'f' )
-					ucs += mult * (*q - 'a' + 10);
-				else if ( *q >= 'A' && *q <= 'F' )
-					ucs += mult * (*q - 'A' + 10 );
-				else 
-					return 0;
-				mult *= 16;
+				delta = q-p;
 				--q;
+
+				for( ; *q != 'x'; --q )
+				{
+					ucs += mult * HexDigitValue( *q );
+					mult *= 16;
+				}
 			}
 		}
 		else
@@ -481,9 +994,16 @@ const char* TiXmlBase::GetEntity( const char* p, char* value, int* length, TiXml
 			if ( !*(p+2) ) return 0;
 
 			const char* q = p+2;
-			q = strchr( q, ';' );
+			while ( (unsigned)( *q - '0' ) < 10 )
+				++q;
 
-			if ( !q || !*q ) return 0;
+			if ( *q != ';' )
+			{
+				// As for hex: the digits start after the last '#'.
+				if ( !*q ) return 0;
+				q = strchr( q, ';' );
+				if ( !q || !*q ) return 0;
+			}
 
 			delta = q-p;
 			--q;
@@ -511,16 +1031,22 @@ const char* TiXmlBase::GetEntity( const char* p, char* value, int* length, TiXml
 		return p + delta + 1;
 	}
 
-	// Now try to match it.
-	for( i=0; i<NUM_ENTITY; ++i )
+	// Now try to match it. The names all start with a different letter but
+	// for &amp; and &apos;, so there is at most one compare to do.
+	int i = -1;
+	switch ( *(p+1) )
 	{
-		if ( strncmp( entity[i].str, p, entity[i].strLength ) == 0 )
-		{
-			assert( strlen( entity[i].str ) == entity[i].strLength );
-			*value = entity[i].chr;
-			*length = 1;
-			return ( p + entity[i].strLength );
-		}
+		case 'a':	i = ( *(p+2) == 'm' ) ? 0 : 4;	break;
+		case 'l':	i = 1;							break;
+		case 'g':	i = 2;							break;
+		case 'q':	i = 3;							break;
+	}
+	if ( i >= 0 && strncmp( entity[i].str, p, entity[i].strLength ) == 0 )
+	{
+		assert( strlen( entity[i].str ) == entity[i].strLength );
+		*value = entity[i].chr;
+		*length = 1;
+		return ( p + entity[i].strLength );
 	}
 
 	// So it wasn't an entity, its unrecognized, or something like that.
@@ -576,9 +1102,17 @@ const char* TiXmlBase::ReadText(	const char* p,
 									bool trimWhiteSpace, 
 									const char* endTag, 
 									bool caseInsensitive,
-									TiXmlEncoding encoding )
+									TiXmlEncoding encoding,
+									bool normalizeNewLines )
 {
-    *text = "";
+    text->erase();
+
+	// Runs of characters that are copied as they are (no entity, no end tag, and, in
+	// UTF-8, no multi-byte character) are found by ScanText() and appended in one go.
+	// That can't be done for a case insensitive end tag that starts with a letter.
+	const bool scan = !caseInsensitive || !isalpha( (unsigned char) *endTag );
+	const bool utf8 = ( encoding == TIXML_ENCODING_UTF8 );
+
 	if (    !trimWhiteSpace			// certain tags always keep whitespace
 		 || !condenseWhiteSpace )	// if true, whitespace is always kept
 	{
@@ -587,6 +1121,20 @@ const char* TiXmlBase::ReadText(	const char* p,
 				&& !StringEqual( p, endTag, caseInsensitive, encoding )
 			  )
 		{
+			const char* run = scan ? ScanText( p, *endTag, false, utf8 ) : p;
+			if ( run > p )
+			{
+				text->append( p, run - p );
+				p = run;
+				continue;
+			}
+			if ( normalizeNewLines && *p == '\r' )
+			{
+				// CR+LF, and CR on its own, are read as LF.
+				(*text) += '\n';
+				p += ( *(p+1) == '\n' ) ? 2 : 1;
+				continue;
+			}
 			int len;
 			char cArr[4] = { 0, 0, 0, 0 };
 			p = GetChar( p, cArr, &len, encoding );
@@ -621,6 +1169,13 @@ const char* TiXmlBase::ReadText(	const char* p,
 					(*text) += ' ';
 					whitespace = false;
 				}
+				const char* run = scan ? ScanText( p, *endTag, true, utf8 ) : p;
+				if ( run > p )
+				{
+					text->append( p, run - p );
+					p = run;
+					continue;
+				}
 				int len;
 				char cArr[4] = { 0, 0, 0, 0 };
 				p = GetChar( p, cArr, &len, encoding );
@@ -636,6 +1191,35 @@ const char* TiXmlBase::ReadText(	const char* p,
 	return p;
 }
 
+/*static*/ void TiXmlBase::NormalizeNewLines( TIXML_STRING* text )
+{
+	const char* cr = (const char*) memchr( text->data(), '\r', text->length() );
+	if ( !cr )
+		return;
+
+	// Copies from the 'p' to 'q' pointer, where p can advance faster if
+	// a carriage return-newline is hit. (As TiXmlDocument::LoadFile().)
+	char* start = &(*text)[0];
+	const char* end = start + text->length();
+	const char* p = start + ( cr - text->data() );
+	char* q = const_cast<char*>( p );
+	while ( p < end )
+	{
+		if ( *p == '\r' )
+		{
+			*q++ = '\n';
+			++p;
+			if ( p < end && *p == '\n' )
+				++p;
+		}
+		else
+		{
+			*q++ = *p++;
+		}
+	}
+	text->assign( start, q - start );
+}
+
 #ifdef TIXML_USE_STL
 
 void TiXmlDocument::StreamIn( std::istream * in, TIXML_STRING * tag )
@@ -656,15 +1240,10 @@ void TiXmlDocument::StreamIn( std::istream * in, TIXML_STRING * tag )
 	while ( in->good() )
 	{
 		int tagIndex = (int) tag->length();
-		while ( in->good() && in->peek() != '>' )
+		if ( StreamSpan( in, tag, '>', '>' ) == 0 )
 		{
-			int c = in->get();
-			if ( c <= 0 )
-			{
-				SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
-				break;
-			}
-			(*tag) += (char) c;
+			in->get();
+			SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
 		}
 
 		if ( in->good() )
@@ -701,18 +1280,326 @@ void TiXmlDocument::StreamIn( std::istream * in, TIXML_STRING * tag )
 
 #endif
 
-const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiXmlEncoding encoding )
+// The state of a selective parse (see TiXmlDocument::AddKeepPath.) For every
+// element the parser is inside of, a frame of the paths that go on through its
+// children: the step each is at, and how many children matched that step so
+// far. The frames are kept end to end in 'entries'; the document is the first.
+class TiXmlSelection
 {
-	ClearError();
+public:
+	enum
+	{
+		READ,		// not selecting: read the markup as usual
+		MARKUP,		// not an element (a comment, CDATA, etc.)
+		SKIP,		// an element no path goes through
+		ENTER,		// an element on the way to the kept ones
+		KEEP		// an element a path selects: read it whole
+	};
+
+	TiXmlSelection() : paths( 0 ), pathCount( 0 ), entries( 0 ), entryCount( 0 ), entryCapacity( 0 ),
+					   frames( 0 ), frameCount( 0 ), frameCapacity( 0 ), active( false )	{}
+	~TiXmlSelection();
+
+	void Add( const TiXmlPath& path );
+	int Count() const						{ return pathCount; }
+	const TiXmlPath& Path( int i ) const	{ return *paths[i]; }
+
+	// Start choosing at the document level, or stop.
+	void Start();
+	void Stop()								{ active = false; }
+	// Not choosing while a kept element is read.
+	bool Active() const						{ return active; }
+	void Pause()							{ active = false; }
+	void Resume()							{ active = true; }
+
+	// What to do with the markup at 'p', a child of the element being read. For
+	// ENTER, the frame of the child is pushed; Leave() pops it after the child.
+	int Choose( const char* p, TiXmlEncoding encoding );
+	void Leave()							{ entryCount = frames[--frameCount]; }
+
+	// The end of the element or other markup at 'p', or null if the input ends
+	// first. Only the tags are balanced; nothing else is checked.
+	static const char* Skip( const char* p );
+
+private:
+	TiXmlSelection( const TiXmlSelection& );		// not implemented.
+	void operator=( const TiXmlSelection& );		// not allowed.
+
+	struct Entry
+	{
+		int path;
+		int level;		// the step of the path the children are matched to
+		int matches;	// the children that matched that step so far
+	};
+
+	void Push( int path, int level );
+	void PushFrame( int start );
+	// The end of the tag at 'p'; 'empty' is set for an empty element tag.
+	static const char* SkipTag( const char* p, bool* empty );
+
+	TiXmlPath** paths;
+	int pathCount;
+	Entry* entries;
+	int entryCount;
+	int entryCapacity;
+	int* frames;				// where each frame starts in 'entries'
+	int frameCount;
+	int frameCapacity;
+	bool active;
+};
 
-	// Parse away, at the document level. Since a document
-	// contains nothing but other tags, most of what happens
-	// here is skipping white space.
-	if ( !p || !*p )
-	{
-		SetError( TIXML_ERROR_DOCUMENT_EMPTY, 0, 0, TIXML_ENCODING_UNKNOWN );
-		return 0;
-	}
+
+TiXmlSelection::~TiXmlSelection()
+{
+	for ( int i = 0; i < pathCount; ++i )
+		delete paths[i];
+	delete [] paths;
+	delete [] entries;
+	delete [] frames;
+}
+
+
+void TiXmlSelection::Add( const TiXmlPath& path )
+{
+	TiXmlPath** grown = new TiXmlPath*[ pathCount + 1 ];
+	for ( int i = 0; i < pathCount; ++i )
+		grown[i] = paths[i];
+	grown[ pathCount++ ] = new TiXmlPath( path );
+	delete [] paths;
+	paths = grown;
+}
+
+
+void TiXmlSelection::Start()
+{
+	entryCount = 0;
+	frameCount = 0;
+	PushFrame( 0 );
+	for ( int i = 0; i < pathCount; ++i )
+	{
+		// A path that has an error selects nothing.
+		if ( !paths[i]->Error() && paths[i]->Steps() > 0 )
+			Push( i, 0 );
+	}
+	active = true;
+}
+
+
+void TiXmlSelection::Push( int path, int level )
+{
+	if ( entryCount == entryCapacity )
+	{
+		entryCapacity = entryCapacity ? entryCapacity * 2 : 16;
+		Entry* grown = new Entry[ entryCapacity ];
+		for ( int i = 0; i < entryCount; ++i )
+			grown[i] = entries[i];
+		delete [] entries;
+		entries = grown;
+	}
+	entries[ entryCount ].path = path;
+	entries[ entryCount ].level = level;
+	entries[ entryCount ].matches = 0;
+	++entryCount;
+}
+
+
+void TiXmlSelection::PushFrame( int start )
+{
+	if ( frameCount == frameCapacity )
+	{
+		frameCapacity = frameCapacity ? frameCapacity * 2 : 16;
+		int* grown = new int[ frameCapacity ];
+		for ( int i = 0; i < frameCount; ++i )
+			grown[i] = frames[i];
+		delete [] frames;
+		frames = grown;
+	}
+	frames[ frameCount++ ] = start;
+}
+
+
+int TiXmlSelection::Choose( const char* p, TiXmlEncoding encoding )
+{
+	assert( *p == '<' );
+
+	// The same test as Identify(): elements start with a letter or underscore.
+	if ( !TiXmlBase::IsAlpha( (unsigned char) *(p+1), encoding ) && *(p+1) != '_' )
+		return MARKUP;
+
+	// The element isn't parsed yet, so its name may not be in the table; then
+	// it is compared with the names of the steps as a string.
+	const char* name = p + 1;
+	size_t length = TiXmlBase::ScanName( name ) - name;
+	const char* symbol = TiXmlNameTable::Find( name, length );
+
+	const int first = frames[ frameCount-1 ];
+	const int last = entryCount;
+	bool keep = false;
+	for ( int i = first; i < last; ++i )
+	{
+		const TiXmlPath& path = *paths[ entries[i].path ];
+		const TiXmlPath::Step& step = path.steps[ entries[i].level ];
+		if ( !step.Any() )
+		{
+			if ( symbol ? step.Symbol() != symbol
+						: step.name.length() != length || memcmp( step.name.data(), name, length ) != 0 )
+				continue;
+		}
+		// Every match counts for an index, kept or not.
+		int match = entries[i].matches++;
+		if ( step.index != TiXmlPath::ALL && step.index != match )
+			continue;
+
+		if ( entries[i].level + 1 == path.count )
+			keep = true;
+		else
+			Push( entries[i].path, entries[i].level + 1 );
+	}
+
+	if ( keep )
+	{
+		entryCount = last;
+		return KEEP;
+	}
+	if ( entryCount > last )
+	{
+		PushFrame( last );
+		return ENTER;
+	}
+	return SKIP;
+}
+
+
+const char* TiXmlSelection::SkipTag( const char* p, bool* empty )
+{
+	// Up to the '>' that isn't in a quoted attribute value.
+	for ( ++p; *p; ++p )
+	{
+		if ( *p == '\"' || *p == '\'' )
+		{
+			p = strchr( p+1, *p );
+			if ( !p )
+				return 0;
+		}
+		else if ( *p == '>' )
+		{
+			*empty = *(p-1) == '/';
+			return p+1;
+		}
+	}
+	return 0;
+}
+
+
+/*static*/ const char* TiXmlSelection::Skip( const char* p )
+{
+	int depth = 0;
+	do
+	{
+		if ( *(p+1) == '/' )
+		{
+			--depth;
+			p = strchr( p, '>' );
+			if ( p )
+				++p;
+		}
+		else if ( *(p+1) == '!' )
+		{
+			if ( strncmp( p, "<!--", 4 ) == 0 )
+			{
+				p = strstr( p+4, "-->" );
+				if ( p )
+					p += 3;
+			}
+			else if ( strncmp( p, "<![CDATA[", 9 ) == 0 )
+			{
+				p = strstr( p+9, "]]>" );
+				if ( p )
+					p += 3;
+			}
+			else
+			{
+				p = strchr( p, '>' );
+				if ( p )
+					++p;
+			}
+		}
+		else if ( *(p+1) == '?' )
+		{
+			p = strstr( p+2, "?>" );
+			if ( p )
+				p += 2;
+		}
+		else if ( TiXmlBase::IsAlpha( (unsigned char) *(p+1), TIXML_ENCODING_UNKNOWN ) || *(p+1) == '_' )
+		{
+			bool empty = false;
+			p = SkipTag( p, &empty );
+			if ( p && !empty )
+				++depth;
+		}
+		else
+		{
+			// Unknown, as in Identify().
+			p = strchr( p, '>' );
+			if ( p )
+				++p;
+		}
+
+		if ( !p )
+			return 0;
+		if ( depth > 0 )
+		{
+			// Text is skipped with the tags.
+			p = strchr( p, '<' );
+			if ( !p )
+				return 0;
+		}
+	}
+	while ( depth > 0 );
+	return p;
+}
+
+
+void TiXmlDocument::AddKeepPath( const TiXmlPath& path )
+{
+	if ( !selection )
+		selection = new TiXmlSelection();
+	selection->Add( path );
+}
+
+
+void TiXmlDocument::ClearKeepPaths()
+{
+	delete selection;
+	selection = 0;
+}
+
+
+int TiXmlDocument::KeepPaths() const
+{
+	return selection ? selection->Count() : 0;
+}
+
+
+const TiXmlPath& TiXmlDocument::KeepPath( int i ) const
+{
+	assert( selection && i >= 0 && i < selection->Count() );
+	return selection->Path( i );
+}
+
+
+const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiXmlEncoding encoding )
+{
+	ClearError();
+
+	// Parse away, at the document level. Since a document
+	// contains nothing but other tags, most of what happens
+	// here is skipping white space.
+	if ( !p || !*p )
+	{
+		SetError( TIXML_ERROR_DOCUMENT_EMPTY, 0, 0, TIXML_ENCODING_UNKNOWN );
+		return 0;
+	}
 
 	// Note that, for a document, this needs to come
 	// before the while space skip, so that parsing
@@ -728,8 +1615,8 @@ const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiX
 		location.row = 0;
 		location.col = 0;
 	}
-	TiXmlParsingData data( p, TabSize(), location.row, location.col );
-	location = data.Cursor();
+	TiXmlParsingData data( p, TabSize(), location.row, location.col, lazyLocations );
+	location = data.cursor;
 
 	if ( encoding == TIXML_ENCODING_UNKNOWN )
 	{
@@ -751,13 +1638,52 @@ const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiX
 		return 0;
 	}
 
+	// In a selective parse, the elements no keep path goes through are skipped.
+	// Everything else at the document level is read.
+	bool skipped = false;
+	if ( selection )
+		selection->Start();
+
 	while ( p && *p )
 	{
+		int choice = TiXmlSelection::READ;
+		if ( selection && *p == '<' )
+			choice = selection->Choose( p, encoding );
+		if ( choice == TiXmlSelection::SKIP )
+		{
+			const char* start = p;
+			p = TiXmlSelection::Skip( p );
+			if ( !p )
+			{
+				SetError( TIXML_ERROR_READING_END_TAG, start, &data, encoding );
+				break;
+			}
+			skipped = true;
+			p = SkipWhiteSpace( p, encoding );
+			continue;
+		}
+
 		TiXmlNode* node = Identify( p, encoding );
 		if ( node )
 		{
+			if ( choice == TiXmlSelection::KEEP )
+				selection->Pause();
 			p = node->Parse( p, &data, encoding );
-			LinkEndChild( node );
+			if ( choice == TiXmlSelection::KEEP )
+				selection->Resume();
+			else if ( choice == TiXmlSelection::ENTER )
+				selection->Leave();
+			// An element the paths went in to, but kept nothing in, is dropped.
+			if ( choice == TiXmlSelection::ENTER && p && node->NoChildren() )
+			{
+				delete node;
+				node = 0;
+				skipped = true;
+			}
+			else
+			{
+				LinkEndChild( node );
+			}
 		}
 		else
 		{
@@ -766,7 +1692,7 @@ const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiX
 
 		// Did we get encoding info?
 		if (    encoding == TIXML_ENCODING_UNKNOWN
-			 && node->ToDeclaration() )
+			 && node && node->ToDeclaration() )
 		{
 			TiXmlDeclaration* dec = node->ToDeclaration();
 			const char* enc = dec->Encoding();
@@ -785,8 +1711,11 @@ const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiX
 		p = SkipWhiteSpace( p, encoding );
 	}
 
-	// Was this empty?
-	if ( !firstChild ) {
+	if ( selection )
+		selection->Stop();
+
+	// Was this empty? (Not if all of it was skipped.)
+	if ( !firstChild && !skipped ) {
 		SetError( TIXML_ERROR_DOCUMENT_EMPTY, 0, 0, encoding );
 		return 0;
 	}
@@ -809,8 +1738,8 @@ void TiXmlDocument::SetError( int err, const char* pError, TiXmlParsingData* dat
 	errorLocation.Clear();
 	if ( pError && data )
 	{
-		data->Stamp( pError, encoding );
-		errorLocation = data->Cursor();
+		data->Advance( pError, encoding );
+		errorLocation = data->cursor;
 	}
 }
 
@@ -844,26 +1773,30 @@ TiXmlNode* TiXmlNode::Identify( const char* p, TiXmlEncoding encoding )
 	const char* dtdHeader = { "<!" };
 	const char* cdataHeader = { "<![CDATA[" };
 
+	// In arena mode, the nodes come from the arena of the document.
+	TiXmlDocument* document = GetDocument();
+	TiXmlArena* arena = document ? document->Arena() : 0;
+
 	if ( StringEqual( p, xmlHeader, true, encoding ) )
 	{
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing Declaration\n" );
 		#endif
-		returnNode = new TiXmlDeclaration();
+		returnNode = arena ? new ( *arena ) TiXmlDeclaration() : new TiXmlDeclaration();
 	}
 	else if ( StringEqual( p, commentHeader, false, encoding ) )
 	{
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing Comment\n" );
 		#endif
-		returnNode = new TiXmlComment();
+		returnNode = arena ? new ( *arena ) TiXmlComment() : new TiXmlComment();
 	}
 	else if ( StringEqual( p, cdataHeader, false, encoding ) )
 	{
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing CDATA\n" );
 		#endif
-		TiXmlText* text = new TiXmlText( "" );
+		TiXmlText* text = arena ? new ( *arena ) TiXmlText( "" ) : new TiXmlText( "" );
 		text->SetCDATA( true );
 		returnNode = text;
 	}
@@ -872,7 +1805,7 @@ TiXmlNode* TiXmlNode::Identify( const char* p, TiXmlEncoding encoding )
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing Unknown(1)\n" );
 		#endif
-		returnNode = new TiXmlUnknown();
+		returnNode = arena ? new ( *arena ) TiXmlUnknown() : new TiXmlUnknown();
 	}
 	else if (    IsAlpha( *(p+1), encoding )
 			  || *(p+1) == '_' )
@@ -880,14 +1813,14 @@ TiXmlNode* TiXmlNode::Identify( const char* p, TiXmlEncoding encoding )
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing Element\n" );
 		#endif
-		returnNode = new TiXmlElement( "" );
+		returnNode = arena ? new ( *arena ) TiXmlElement( "" ) : new TiXmlElement( "" );
 	}
 	else
 	{
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing Unknown(2)\n" );
 		#endif
-		returnNode = new TiXmlUnknown();
+		returnNode = arena ? new ( *arena ) TiXmlUnknown() : new TiXmlUnknown();
 	}
 
 	if ( returnNode )
@@ -904,21 +1837,17 @@ void TiXmlElement::StreamIn (std::istream * in, TIXML_STRING * tag)
 {
 	// We're called with some amount of pre-parsing. That is, some of "this"
 	// element is in "tag". Go ahead and stream to the closing ">"
-	while( in->good() )
-	{
-		int c = in->get();
-		if ( c <= 0 )
-		{
-			TiXmlDocument* document = GetDocument();
-			if ( document )
-				document->SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
-			return;
-		}
-		(*tag) += (char) c ;
-		
-		if ( c == '>' )
-			break;
+	int c = StreamSpan( in, tag, '>', '>' );
+	if ( c <= 0 )
+	{
+		if ( c == 0 )
+			in->get();
+		TiXmlDocument* document = GetDocument();
+		if ( document )
+			document->SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
+		return;
 	}
+	(*tag) += (char) in->get();
 
 	if ( tag->length() < 3 ) return;
 
@@ -962,13 +1891,11 @@ void TiXmlElement::StreamIn (std::istream * in, TIXML_STRING * tag)
 
 			bool closingTag = false;
 			bool firstCharFound = false;
+			size_t checked = tag->length();
 
 			for( ;; )
 			{
-				if ( !in->good() )
-					return;
-
-				int c = in->peek();
+				int c = StreamSpan( in, tag, '>', '[' );
 				if ( c <= 0 )
 				{
 					TiXmlDocument* document = GetDocument();
@@ -976,15 +1903,25 @@ void TiXmlElement::StreamIn (std::istream * in, TIXML_STRING * tag)
 						document->SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
 					return;
 				}
-				
+				if ( c == '[' )
+					*tag += (char) in->get();
+
+				for( ; !firstCharFound && checked < tag->length(); ++checked )
+				{
+					char ch = (*tag)[checked];
+					if ( ch != '<' && !IsWhiteSpace( ch ) )
+					{
+						firstCharFound = true;
+						if ( ch == '/' )
+							closingTag = true;
+					}
+				}
+
 				if ( c == '>' )
 					break;
 
-				*tag += (char) c;
-				in->get();
-
 				// Early out if we find the CDATA id.
-				if ( c == '[' && tag->size() >= 9 )
+				if ( tag->size() >= 9 )
 				{
 					size_t len = tag->size();
 					const char* start = tag->c_str() + len - 9;
@@ -993,13 +1930,6 @@ void TiXmlElement::StreamIn (std::istream * in, TIXML_STRING * tag)
 						break;
 					}
 				}
-
-				if ( !firstCharFound && c != '<' && !IsWhiteSpace( c ) )
-				{
-					firstCharFound = true;
-					if ( c == '/' )
-						closingTag = true;
-				}
 			}
 			// If it was a closing tag, then read in the closing '>' to clean up the input stream.
 			// If it was not, the streaming will be done by the tag.
@@ -1068,15 +1998,14 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 	// Read the name.
 	const char* pErr = p;
 
-    p = ReadName( p, &value, encoding );
+	TIXML_STRING* name = document ? document->ParseBuffer( &value ) : &value;
+    p = ReadName( p, name, encoding );
 	if ( !p || !*p )
 	{
 		if ( document )	document->SetError( TIXML_ERROR_FAILED_TO_READ_ELEMENT_NAME, pErr, data, encoding );
 		return 0;
 	}
-
-    TIXML_STRING endTag ("</");
-	endTag += value;
+	symbol = document ? document->StoreName( &value, name, pErr, p ) : InternName( &value, value );
 
 	// Check for and read attributes. Also look for an empty
 	// tag or an end tag.
@@ -1119,9 +2048,13 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 			// </foo > and
 			// </foo> 
 			// are both valid end tags.
-			if ( StringEqual( p, endTag.c_str(), false, encoding ) )
+			// (The "</" and the name are matched separately, so the
+			// end tag doesn't have to be built in a string. The name is
+			// matched by length, as in-situ it may not be terminated yet.)
+			if (    StringEqual( p, "</", false, encoding )
+				 && strncmp( p+2, value.c_str(), value.length() ) == 0 )
 			{
-				p += endTag.length();
+				p += 2 + value.length();
 				p = SkipWhiteSpace( p, encoding );
 				if ( p && *p && *p == '>' ) {
 					++p;
@@ -1139,7 +2072,8 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 		else
 		{
 			// Try to read an attribute:
-			TiXmlAttribute* attrib = new TiXmlAttribute();
+			TiXmlArena* arena = document ? document->Arena() : 0;
+			TiXmlAttribute* attrib = arena ? new ( *arena ) TiXmlAttribute() : new TiXmlAttribute();
 			if ( !attrib )
 			{
 				return 0;
@@ -1157,11 +2091,7 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 			}
 
 			// Handle the strange case of double attributes:
-			#ifdef TIXML_USE_STL
-			TiXmlAttribute* node = attributeSet.Find( attrib->NameTStr() );
-			#else
-			TiXmlAttribute* node = attributeSet.Find( attrib->Name() );
-			#endif
+			TiXmlAttribute* node = attributeSet.FindSymbol( attrib->Symbol() );
 			if ( node )
 			{
 				if ( document ) document->SetError( TIXML_ERROR_PARSING_ELEMENT, pErr, data, encoding );
@@ -1180,21 +2110,35 @@ const char* TiXmlElement::ReadValue( const char* p, TiXmlParsingData* data, TiXm
 {
 	TiXmlDocument* document = GetDocument();
 
+	// In a selective parse of an element on the way to the kept ones, only the
+	// child elements are read, and of those only the ones a keep path goes through.
+	TiXmlSelection* selection = document ? document->Selection() : 0;
+	if ( selection && !selection->Active() )
+		selection = 0;
+
 	// Read in text and elements in any order.
 	const char* pWithWhiteSpace = p;
 	p = SkipWhiteSpace( p, encoding );
 
 	while ( p && *p )
 	{
-		if ( *p != '<' )
+		if ( *p != '<' && selection )
+		{
+			const char* markup = strchr( p, '<' );
+			p = markup ? markup : p + strlen( p );
+		}
+		else if ( *p != '<' )
 		{
 			// Take what we have, make a text element.
-			TiXmlText* textNode = new TiXmlText( "" );
+			TiXmlArena* arena = document ? document->Arena() : 0;
+			TiXmlText* textNode = arena ? new ( *arena ) TiXmlText( "" ) : new TiXmlText( "" );
 
 			if ( !textNode )
 			{
 			    return 0;
 			}
+			// Set the parent, so it can report errors (and find the document.)
+			textNode->parent = this;
 
 			if ( TiXmlBase::IsWhiteSpaceCondensed() )
 			{
@@ -1221,13 +2165,36 @@ const char* TiXmlElement::ReadValue( const char* p, TiXmlParsingData* data, TiXm
 			{
 				return p;
 			}
+
+			// A selective parse skips the markup it doesn't keep.
+			int choice = selection ? selection->Choose( p, encoding ) : TiXmlSelection::READ;
+			if ( choice == TiXmlSelection::SKIP || choice == TiXmlSelection::MARKUP )
+			{
+				const char* start = p;
+				p = TiXmlSelection::Skip( p );
+				if ( !p )
+				{
+					if ( document ) document->SetError( TIXML_ERROR_READING_END_TAG, start, data, encoding );
+					return 0;
+				}
+			}
 			else
 			{
 				TiXmlNode* node = Identify( p, encoding );
 				if ( node )
 				{
+					if ( choice == TiXmlSelection::KEEP )
+						selection->Pause();
 					p = node->Parse( p, data, encoding );
-					LinkEndChild( node );
+					if ( choice == TiXmlSelection::KEEP )
+						selection->Resume();
+					else if ( choice == TiXmlSelection::ENTER )
+						selection->Leave();
+					// An element the paths went in to, but kept nothing in, is dropped.
+					if ( choice == TiXmlSelection::ENTER && p && node->NoChildren() )
+						delete node;
+					else
+						LinkEndChild( node );
 				}				
 				else
 				{
@@ -1250,24 +2217,18 @@ const char* TiXmlElement::ReadValue( const char* p, TiXmlParsingData* data, TiXm
 #ifdef TIXML_USE_STL
 void TiXmlUnknown::StreamIn( std::istream * in, TIXML_STRING * tag )
 {
-	while ( in->good() )
-	{
-		int c = in->get();	
-		if ( c <= 0 )
-		{
-			TiXmlDocument* document = GetDocument();
-			if ( document )
-				document->SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
-			return;
-		}
-		(*tag) += (char) c;
-
-		if ( c == '>' )
-		{
-			// All is well.
-			return;		
-		}
+	int c = StreamSpan( in, tag, '>', '>' );
+	if ( c <= 0 )
+	{
+		if ( c == 0 )
+			in->get();
+		TiXmlDocument* document = GetDocument();
+		if ( document )
+			document->SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
+		return;
 	}
+	// All is well.
+	(*tag) += (char) in->get();
 }
 #endif
 
@@ -1288,13 +2249,17 @@ const char* TiXmlUnknown::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 		return 0;
 	}
 	++p;
-    value = "";
+	const char* start = p;
+	TIXML_STRING* buffer = document ? document->ParseBuffer( &value ) : &value;
+    buffer->erase();
 
 	while ( p && *p && *p != '>' )
 	{
-		value += *p;
+		(*buffer) += *p;
 		++p;
 	}
+	if ( document && document->NormalizingNewLines() ) NormalizeNewLines( buffer );
+	if ( document ) document->StoreParsed( &value, buffer, start, p );
 
 	if ( !p )
 	{
@@ -1308,21 +2273,22 @@ const char* TiXmlUnknown::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 #ifdef TIXML_USE_STL
 void TiXmlComment::StreamIn( std::istream * in, TIXML_STRING * tag )
 {
-	while ( in->good() )
+	for ( ;; )
 	{
-		int c = in->get();	
+		int c = StreamSpan( in, tag, '>', '>' );
 		if ( c <= 0 )
 		{
+			if ( c == 0 )
+				in->get();
 			TiXmlDocument* document = GetDocument();
 			if ( document )
 				document->SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
 			return;
 		}
 
-		(*tag) += (char) c;
+		(*tag) += (char) in->get();
 
-		if ( c == '>' 
-			 && tag->at( tag->length() - 2 ) == '-'
+		if (    tag->at( tag->length() - 2 ) == '-'
 			 && tag->at( tag->length() - 3 ) == '-' )
 		{
 			// All is well.
@@ -1373,13 +2339,17 @@ const char* TiXmlComment::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 				  <!-- declarations for <head> & <body> -->
 	*/
 
-    value = "";
+	const char* start = p;
+	TIXML_STRING* buffer = document ? document->ParseBuffer( &value ) : &value;
+    buffer->erase();
 	// Keep all the white space.
 	while (	p && *p && !StringEqual( p, endTag, false, encoding ) )
 	{
-		value.append( p, 1 );
+		buffer->append( p, 1 );
 		++p;
 	}
+	if ( document && document->NormalizingNewLines() ) NormalizeNewLines( buffer );
+	if ( document ) document->StoreParsed( &value, buffer, start, p );
 	if ( p && *p ) 
 		p += strlen( endTag );
 
@@ -1399,12 +2369,14 @@ const char* TiXmlAttribute::Parse( const char* p, TiXmlParsingData* data, TiXmlE
 	}
 	// Read the name, the '=' and the value.
 	const char* pErr = p;
-	p = ReadName( p, &name, encoding );
+	TIXML_STRING* buffer = document ? document->ParseBuffer( &name ) : &name;
+	p = ReadName( p, buffer, encoding );
 	if ( !p || !*p )
 	{
 		if ( document ) document->SetError( TIXML_ERROR_READING_ATTRIBUTES, pErr, data, encoding );
 		return 0;
 	}
+	symbol = document ? document->StoreName( &name, buffer, pErr, p ) : InternName( &name, name );
 	p = SkipWhiteSpace( p, encoding );
 	if ( !p || !*p || *p != '=' )
 	{
@@ -1424,24 +2396,26 @@ const char* TiXmlAttribute::Parse( const char* p, TiXmlParsingData* data, TiXmlE
 	const char SINGLE_QUOTE = '\'';
 	const char DOUBLE_QUOTE = '\"';
 
+	buffer = document ? document->ParseBuffer( &value ) : &value;
+	const char* start = p;
 	if ( *p == SINGLE_QUOTE )
 	{
-		++p;
+		start = ++p;
 		end = "\'";		// single quote in string
-		p = ReadText( p, &value, false, end, false, encoding );
+		p = ReadText( p, buffer, false, end, false, encoding, document && document->NormalizingNewLines() );
 	}
 	else if ( *p == DOUBLE_QUOTE )
 	{
-		++p;
+		start = ++p;
 		end = "\"";		// double quote in string
-		p = ReadText( p, &value, false, end, false, encoding );
+		p = ReadText( p, buffer, false, end, false, encoding, document && document->NormalizingNewLines() );
 	}
 	else
 	{
 		// All attribute values should be in single or double quotes.
 		// But this is such a common error that the parser will try
 		// its best, even without them.
-		value = "";
+		buffer->erase();
 		while (    p && *p											// existence
 				&& !IsWhiteSpace( *p )								// whitespace
 				&& *p != '/' && *p != '>' )							// tag end
@@ -1453,35 +2427,38 @@ const char* TiXmlAttribute::Parse( const char* p, TiXmlParsingData* data, TiXmlE
 				if ( document ) document->SetError( TIXML_ERROR_READING_ATTRIBUTES, p, data, encoding );
 				return 0;
 			}
-			value += *p;
+			(*buffer) += *p;
 			++p;
 		}
 	}
+	if ( document ) document->StoreParsed( &value, buffer, start, p );
 	return p;
 }
 
 #ifdef TIXML_USE_STL
 void TiXmlText::StreamIn( std::istream * in, TIXML_STRING * tag )
 {
-	while ( in->good() )
+	const char stop = cdata ? '>' : '<';
+	for ( ;; )
 	{
-		int c = in->peek();	
+		int c = StreamSpan( in, tag, stop, stop );
 		if ( !cdata && (c == '<' ) ) 
 		{
 			return;
 		}
 		if ( c <= 0 )
 		{
+			if ( c == 0 )
+				in->get();	// else the element would come straight back here
 			TiXmlDocument* document = GetDocument();
 			if ( document )
 				document->SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
 			return;
 		}
 
-		(*tag) += (char) c;
-		in->get();	// "commits" the peek made above
+		(*tag) += (char) in->get();
 
-		if ( cdata && c == '>' && tag->size() >= 3 ) {
+		if ( tag->size() >= 3 ) {
 			size_t len = tag->size();
 			if ( (*tag)[len-2] == ']' && (*tag)[len-3] == ']' ) {
 				// terminator of cdata.
@@ -1494,8 +2471,9 @@ void TiXmlText::StreamIn( std::istream * in, TIXML_STRING * tag )
 
 const char* TiXmlText::Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding )
 {
-	value = "";
 	TiXmlDocument* document = GetDocument();
+	TIXML_STRING* buffer = document ? document->ParseBuffer( &value ) : &value;
+	buffer->erase();
 
 	if ( data )
 	{
@@ -1516,15 +2494,18 @@ const char* TiXmlText::Parse( const char* p, TiXmlParsingData* data, TiXmlEncodi
 			return 0;
 		}
 		p += strlen( startTag );
+		const char* start = p;
 
 		// Keep all the white space, ignore the encoding, etc.
 		while (	   p && *p
 				&& !StringEqual( p, endTag, false, encoding )
 			  )
 		{
-			value += *p;
+			(*buffer) += *p;
 			++p;
 		}
+		if ( document && document->NormalizingNewLines() ) NormalizeNewLines( buffer );
+		if ( document ) document->StoreParsed( &value, buffer, start, p );
 
 		TIXML_STRING dummy; 
 		p = ReadText( p, &dummy, false, endTag, false, encoding );
@@ -1535,8 +2516,10 @@ const char* TiXmlText::Parse( const char* p, TiXmlParsingData* data, TiXmlEncodi
 		bool ignoreWhite = true;
 
 		const char* end = "<";
-		p = ReadText( p, &value, ignoreWhite, end, false, encoding );
-		if ( p )
+		const char* start = p;
+		p = ReadText( p, buffer, ignoreWhite, end, false, encoding, document && document->NormalizingNewLines() );
+		if ( document ) document->StoreParsed( &value, buffer, start, p ? p-1 : 0 );
+		if ( p && *p )
 			return p-1;	// don't truncate the '<'
 		return 0;
 	}
@@ -1545,24 +2528,18 @@ const char* TiXmlText::Parse( const char* p, TiXmlParsingData* data, TiXmlEncodi
 #ifdef TIXML_USE_STL
 void TiXmlDeclaration::StreamIn( std::istream * in, TIXML_STRING * tag )
 {
-	while ( in->good() )
-	{
-		int c = in->get();
-		if ( c <= 0 )
-		{
-			TiXmlDocument* document = GetDocument();
-			if ( document )
-				document->SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
-			return;
-		}
-		(*tag) += (char) c;
-
-		if ( c == '>' )
-		{
-			// All is well.
-			return;
-		}
+	int c = StreamSpan( in, tag, '>', '>' );
+	if ( c <= 0 )
+	{
+		if ( c == 0 )
+			in->get();
+		TiXmlDocument* document = GetDocument();
+		if ( document )
+			document->SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
+		return;
 	}
+	// All is well.
+	(*tag) += (char) in->get();
 }
 #endif
 
@@ -1633,3 +2610,584 @@ bool TiXmlText::Blank() const
 	return true;
 }
 
+
+
+TiXmlPullParser::TiXmlPullParser( const char* xml, TiXmlEncoding _encoding )
+	: start( 0 ), p( 0 ), encoding( _encoding ), event( START_DOCUMENT ), tagState( TAG_NONE ),
+	  detectEncoding( false ), cdata( false ), depth( 0 ), errorId( TiXmlBase::TIXML_NO_ERROR ),
+	  incremental( false ), scanKind( SCAN_NONE ), scanned( 0 ), scanQuote( 0 )
+{
+	errorLocation.Clear();
+	startLocation.row = startLocation.col = 0;
+	Start( xml );
+}
+
+
+TiXmlPullParser::TiXmlPullParser( TiXmlEncoding _encoding )
+	: start( 0 ), p( 0 ), encoding( _encoding ), event( START_DOCUMENT ), tagState( TAG_NONE ),
+	  detectEncoding( false ), cdata( false ), depth( 0 ), errorId( TiXmlBase::TIXML_NO_ERROR ),
+	  incremental( true ), scanKind( SCAN_NONE ), scanned( 0 ), scanQuote( 0 )
+{
+	errorLocation.Clear();
+	startLocation.row = startLocation.col = 0;
+}
+
+
+void TiXmlPullParser::Start( const char* xml )
+{
+	start = p = xml;
+	if ( !p || !*p )
+	{
+		SetError( TiXmlBase::TIXML_ERROR_DOCUMENT_EMPTY, 0 );
+		return;
+	}
+
+	if ( encoding == TIXML_ENCODING_UNKNOWN )
+	{
+		// Check for the Microsoft UTF-8 lead bytes.
+		const unsigned char* pU = (const unsigned char*)p;
+		if (	*(pU+0) && *(pU+0) == TIXML_UTF_LEAD_0
+			 && *(pU+1) && *(pU+1) == TIXML_UTF_LEAD_1
+			 && *(pU+2) && *(pU+2) == TIXML_UTF_LEAD_2 )
+		{
+			encoding = TIXML_ENCODING_UTF8;
+		}
+	}
+	// As in the document, the first declaration sets an unknown encoding.
+	detectEncoding = ( encoding == TIXML_ENCODING_UNKNOWN );
+}
+
+
+TiXmlPullParser::Event TiXmlPullParser::Next()
+{
+	if ( event == END_DOCUMENT || event == PARSE_ERROR )
+		return event;
+
+	cdata = false;
+	Event e;
+	if ( tagState == TAG_ELEMENT )
+		e = ReadTagAttribute();
+	else if ( tagState == TAG_DECLARATION )
+		e = ReadDeclarationAttribute();
+	else
+		e = ReadContent();
+
+	// Waiting for input doesn't change the current event.
+	if ( e != NEED_INPUT )
+		event = e;
+	return e;
+}
+
+
+bool TiXmlPullParser::Accept( TiXmlSaxHandler* handler )
+{
+	while ( Dispatch( Next(), handler ) )
+		;
+	return !Error();
+}
+
+
+bool TiXmlPullParser::Dispatch( Event e, TiXmlSaxHandler* handler )
+{
+	// Returns false once there is nothing more to do.
+	switch ( e )
+	{
+		case START_ELEMENT:	return handler->StartElement( name.c_str() );
+		case ATTRIBUTE:		return handler->Attribute( name.c_str(), value.c_str() );
+		case END_ELEMENT:	return handler->EndElement( name.c_str() );
+		case TEXT:			return handler->Text( value.c_str(), cdata );
+		case COMMENT:		return handler->Comment( value.c_str() );
+		case DECLARATION:	return handler->Declaration();
+		case UNKNOWN:		return handler->Unknown( value.c_str() );
+		default:			return false;
+	}
+}
+
+
+const char* TiXmlPullParser::ErrorDesc() const
+{
+	return errorId ? TiXmlBase::errorString[ errorId ] : "";
+}
+
+
+TiXmlPullParser::Event TiXmlPullParser::SetError( int err, const char* pError )
+{
+	assert( err > 0 && err < TiXmlBase::TIXML_ERROR_STRING_COUNT );
+	errorId = err;
+	errorLocation.Clear();
+	if ( pError && start )
+	{
+		TiXmlParsingData data( start, 4, startLocation.row, startLocation.col );
+		data.Stamp( pError, encoding );
+		errorLocation = data.Cursor();
+	}
+	event = PARSE_ERROR;
+	return event;
+}
+
+
+TiXmlPullParser::Event TiXmlPullParser::ReadContent()
+{
+	for( ;; )
+	{
+		const char* pWithWhiteSpace = p;
+		p = TiXmlBase::SkipWhiteSpace( p, encoding );
+
+		if ( incremental && ( !p || !HaveToken() ) )
+		{
+			// Wait for more input. The white space is read again then.
+			p = pWithWhiteSpace;
+			return NEED_INPUT;
+		}
+
+		if ( !p || !*p || ( *p != '<' && depth == 0 ) )
+		{
+			// The end of the input, or (as for the document) text
+			// outside of any element, ends the document.
+			if ( depth > 0 )
+				return SetError( TiXmlBase::TIXML_ERROR_READING_END_TAG, p );
+			if ( event == START_DOCUMENT )
+				return SetError( TiXmlBase::TIXML_ERROR_DOCUMENT_EMPTY, 0 );
+			return END_DOCUMENT;
+		}
+
+		if ( *p != '<' )
+		{
+			// Text. Blank text is skipped, as the element does.
+			const char* q = TiXmlBase::ReadText(	TiXmlBase::IsWhiteSpaceCondensed() ? p : pWithWhiteSpace,
+													&value, true, "<", false, encoding );
+			if ( !q )
+				return SetError( TiXmlBase::TIXML_ERROR_READING_ELEMENT_VALUE, 0 );
+			p = ( q[-1] == '<' ) ? q-1 : q;		// don't truncate the '<'
+
+			for ( size_t i=0; i<value.length(); ++i )
+			{
+				if ( !TiXmlBase::IsWhiteSpace( value[i] ) )
+					return TEXT;
+			}
+			continue;
+		}
+
+		if ( depth > 0 && TiXmlBase::StringEqual( p, "</", false, encoding ) )
+		{
+			// The end tag must match the innermost open element.
+			const char* pErr = p;
+			size_t end = openElements.length() - 1;
+			size_t begin = end;
+			while ( begin > 0 && openElements[begin-1] )
+				--begin;
+			if ( strncmp( p+2, openElements.c_str() + begin, end - begin ) != 0 )
+				return SetError( TiXmlBase::TIXML_ERROR_READING_END_TAG, pErr );
+
+			p = TiXmlBase::SkipWhiteSpace( p + 2 + end - begin, encoding );
+			if ( !p || *p != '>' )
+				return SetError( TiXmlBase::TIXML_ERROR_READING_END_TAG, p );
+			++p;
+			PopElement();
+			return END_ELEMENT;
+		}
+
+		if ( TiXmlBase::StringEqual( p, "<?xml", true, encoding ) )
+		{
+			name = "xml";
+			p += 5;
+			tagState = TAG_DECLARATION;
+			return DECLARATION;
+		}
+
+		if ( TiXmlBase::StringEqual( p, "<!--", false, encoding ) )
+		{
+			// Comments keep their white space and entities.
+			p += 4;
+			const char* begin = p;
+			while ( *p && !TiXmlBase::StringEqual( p, "-->", false, encoding ) )
+				++p;
+			value.assign( begin, p - begin );
+			if ( *p )
+				p += 3;
+			return COMMENT;
+		}
+
+		if ( TiXmlBase::StringEqual( p, "<![CDATA[", false, encoding ) )
+		{
+			p += 9;
+			const char* begin = p;
+			while ( *p && !TiXmlBase::StringEqual( p, "]]>", false, encoding ) )
+				++p;
+			value.assign( begin, p - begin );
+			if ( *p )
+				p += 3;
+			cdata = true;
+			return TEXT;
+		}
+
+		if (    TiXmlBase::StringEqual( p, "<!", false, encoding )
+			 || !( TiXmlBase::IsAlpha( *(p+1), encoding ) || *(p+1) == '_' ) )
+		{
+			++p;
+			const char* begin = p;
+			while ( *p && *p != '>' )
+				++p;
+			value.assign( begin, p - begin );
+			if ( *p )
+				++p;
+			return UNKNOWN;
+		}
+
+		// An element. Its attributes are read by the following calls.
+		const char* pErr = p+1;
+		p = TiXmlBase::ReadName( pErr, &name, encoding );
+		if ( !p || !*p )
+			return SetError( TiXmlBase::TIXML_ERROR_FAILED_TO_READ_ELEMENT_NAME, pErr );
+		PushElement();
+		tagState = TAG_ELEMENT;
+		return START_ELEMENT;
+	}
+}
+
+
+bool TiXmlPullParser::HaveToken()
+{
+	// Everything the next event reads must be in the input: text up to
+	// the '<' after it, and a tag up to the '>' that ends it.
+	//
+	// While this returns false, 'p' stays where it is and the input only
+	// grows, so the search carries on from where the last call stopped. The
+	// kind of token can change while its first few characters arrive; then
+	// the search starts over.
+	if ( !*p )
+		return false;
+
+	int kind;
+	const char* terminator;
+	size_t skip;
+	if ( *p != '<' )
+	{
+		if ( depth == 0 )
+			return true;
+		kind = SCAN_TEXT;
+		terminator = "<";
+		skip = 1;
+	}
+	else if ( TiXmlBase::StringEqual( p, "<!--", false, encoding ) )
+	{
+		kind = SCAN_COMMENT;
+		terminator = "-->";
+		skip = 4;
+	}
+	else if ( TiXmlBase::StringEqual( p, "<![CDATA[", false, encoding ) )
+	{
+		kind = SCAN_CDATA;
+		terminator = "]]>";
+		skip = 9;
+	}
+	else if ( TiXmlBase::IsAlpha( *(p+1), encoding ) || *(p+1) == '_' || *(p+1) == '?' )
+	{
+		kind = SCAN_TAG;
+		terminator = 0;
+		skip = 1;
+	}
+	else
+	{
+		kind = SCAN_OTHER;
+		terminator = ">";
+		skip = 1;
+	}
+
+	if ( kind != scanKind )
+	{
+		scanKind = kind;
+		scanned = skip;
+		scanQuote = 0;
+	}
+
+	if ( terminator )
+	{
+		const char* q = p + scanned;
+		if ( strstr( q, terminator ) )
+		{
+			scanKind = SCAN_NONE;
+			return true;
+		}
+		// The start of the terminator may be at the very end: look at it again.
+		size_t length = strlen( q );
+		size_t keep = strlen( terminator ) - 1;
+		if ( length > keep )
+			scanned += length - keep;
+		return false;
+	}
+
+	// An element or declaration: a '>' in a quoted value doesn't end it.
+	const char* q = p + scanned;
+	for ( ; *q; ++q )
+	{
+		if ( scanQuote )
+		{
+			if ( *q == scanQuote )
+				scanQuote = 0;
+		}
+		else if ( *q == '>' )
+		{
+			scanKind = SCAN_NONE;
+			return true;
+		}
+		else if ( *q == '\'' || *q == '\"' )
+		{
+			scanQuote = *q;
+		}
+	}
+	scanned = q - p;
+	return false;
+}
+
+
+void TiXmlPullParser::Discard( size_t length )
+{
+	// The first 'length' characters of the input are about to be thrown
+	// away: keep track of where the rest starts, for the error location.
+	TiXmlParsingData data( start, 4, startLocation.row, startLocation.col );
+	data.Stamp( start + length, encoding );
+	startLocation = data.Cursor();
+}
+
+
+TiXmlPullParser::Event TiXmlPullParser::ReadTagAttribute()
+{
+	const char* pErr = p;
+	p = TiXmlBase::SkipWhiteSpace( p, encoding );
+	if ( !p || !*p )
+		return SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, pErr );
+
+	if ( *p == '/' )
+	{
+		// Empty tag.
+		++p;
+		if ( *p != '>' )
+			return SetError( TiXmlBase::TIXML_ERROR_PARSING_EMPTY, p );
+		++p;
+		tagState = TAG_NONE;
+		PopElement();
+		return END_ELEMENT;
+	}
+	if ( *p == '>' )
+	{
+		// Done with attributes; on to the content.
+		++p;
+		tagState = TAG_NONE;
+		return ReadContent();
+	}
+
+	pErr = p;
+	if ( !ReadAttribute() )
+		return PARSE_ERROR;
+	if ( !*p )
+		return SetError( TiXmlBase::TIXML_ERROR_PARSING_ELEMENT, pErr );
+	return ATTRIBUTE;
+}
+
+
+TiXmlPullParser::Event TiXmlPullParser::ReadDeclarationAttribute()
+{
+	while ( p && *p )
+	{
+		if ( *p == '>' )
+		{
+			++p;
+			tagState = TAG_NONE;
+			if ( detectEncoding )
+			{
+				// No encoding given.
+				encoding = TIXML_ENCODING_UTF8;
+				detectEncoding = false;
+			}
+			return ReadContent();
+		}
+
+		p = TiXmlBase::SkipWhiteSpace( p, encoding );
+		if (    TiXmlBase::StringEqual( p, "version", true, encoding )
+			 || TiXmlBase::StringEqual( p, "encoding", true, encoding )
+			 || TiXmlBase::StringEqual( p, "standalone", true, encoding ) )
+		{
+			if ( !ReadAttribute() )
+				return PARSE_ERROR;
+
+			if ( detectEncoding && TiXmlBase::StringEqual( name.c_str(), "encoding", true, encoding ) )
+			{
+				const char* enc = value.c_str();
+				if ( *enc == 0 )
+					encoding = TIXML_ENCODING_UTF8;
+				else if ( TiXmlBase::StringEqual( enc, "UTF-8", true, TIXML_ENCODING_UNKNOWN ) )
+					encoding = TIXML_ENCODING_UTF8;
+				else if ( TiXmlBase::StringEqual( enc, "UTF8", true, TIXML_ENCODING_UNKNOWN ) )
+					encoding = TIXML_ENCODING_UTF8;	// incorrect, but be nice
+				else 
+					encoding = TIXML_ENCODING_LEGACY;
+				detectEncoding = false;
+			}
+			return ATTRIBUTE;
+		}
+
+		// Read over whatever it is.
+		while( p && *p && *p != '>' && !TiXmlBase::IsWhiteSpace( *p ) )
+			++p;
+	}
+	return SetError( TiXmlBase::TIXML_ERROR_PARSING_DECLARATION, p );
+}
+
+
+bool TiXmlPullParser::ReadAttribute()
+{
+	// The same rules as TiXmlAttribute::Parse().
+	const char* pErr = p;
+	p = TiXmlBase::ReadName( p, &name, encoding );
+	if ( !p || !*p )
+	{
+		SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, pErr );
+		return false;
+	}
+	p = TiXmlBase::SkipWhiteSpace( p, encoding );
+	if ( !p || *p != '=' )
+	{
+		SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, p );
+		return false;
+	}
+	p = TiXmlBase::SkipWhiteSpace( p+1, encoding );
+	if ( !p || !*p )
+	{
+		SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, p );
+		return false;
+	}
+
+	if ( *p == '\'' )
+	{
+		p = TiXmlBase::ReadText( p+1, &value, false, "\'", false, encoding );
+	}
+	else if ( *p == '\"' )
+	{
+		p = TiXmlBase::ReadText( p+1, &value, false, "\"", false, encoding );
+	}
+	else
+	{
+		// Be tolerant of missing quotes, as the document is.
+		value.erase();
+		while ( p && *p && !TiXmlBase::IsWhiteSpace( *p ) && *p != '/' && *p != '>' )
+		{
+			if ( *p == '\'' || *p == '\"' )
+			{
+				SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, p );
+				return false;
+			}
+			value += *p;
+			++p;
+		}
+	}
+	if ( !p )
+	{
+		SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, 0 );
+		return false;
+	}
+	return true;
+}
+
+
+void TiXmlPullParser::PushElement()
+{
+	openElements += name;
+	openElements += '\0';
+	++depth;
+}
+
+
+void TiXmlPullParser::PopElement()
+{
+	// The last name on the stack becomes the current name.
+	size_t end = openElements.length() - 1;
+	size_t begin = end;
+	while ( begin > 0 && openElements[begin-1] )
+		--begin;
+	name.assign( openElements.c_str() + begin, end - begin );
+	openElements.assign( openElements.c_str(), begin );
+	--depth;
+}
+
+
+TiXmlPushParser::TiXmlPushParser( TiXmlSaxHandler* _handler, TiXmlEncoding encoding )
+	: parser( encoding ), handler( _handler ), buffer(), started( false ), done( false )
+{
+}
+
+
+bool TiXmlPushParser::Feed( const char* data, size_t length )
+{
+	if ( done )
+		return false;
+	if ( memchr( data, 0, length ) )
+	{
+		parser.SetError( TiXmlBase::TIXML_ERROR_EMBEDDED_NULL, 0 );
+		done = true;
+		return false;
+	}
+
+	// Drop the input that has been parsed, once it is half of the buffer.
+	size_t offset = started ? parser.p - parser.start : 0;
+	if ( offset > 0 && offset >= buffer.length() / 2 )
+	{
+		parser.Discard( offset );
+		buffer.assign( buffer.c_str() + offset, buffer.length() - offset );
+		offset = 0;
+	}
+	buffer.append( data, length );
+
+	if ( !started )
+	{
+		// Wait for enough input to see a byte order mark.
+		if ( buffer.length() < 3 )
+			return true;
+		parser.Start( buffer.c_str() );
+		started = true;
+	}
+	else
+	{
+		parser.start = buffer.c_str();
+		parser.p = parser.start + offset;
+
+		// Every event ends with a '<' or a '>' (or the end of the input.) Without
+		// one, the event that is waiting can't be complete.
+		if ( !memchr( data, '<', length ) && !memchr( data, '>', length ) )
+			return true;
+	}
+	Run();
+	return !done;
+}
+
+
+bool TiXmlPushParser::Finish()
+{
+	if ( !done )
+	{
+		parser.incremental = false;
+		if ( !started )
+		{
+			parser.Start( buffer.c_str() );
+			started = true;
+		}
+		Run();
+	}
+	return !Error();
+}
+
+
+void TiXmlPushParser::Run()
+{
+	for( ;; )
+	{
+		TiXmlPullParser::Event e = parser.Next();
+		if ( e == TiXmlPullParser::NEED_INPUT )
+			return;
+		if ( !parser.Dispatch( e, handler ) )
+		{
+			done = true;
+			return;
+		}
+	}
+}
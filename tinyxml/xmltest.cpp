@@ -69,6 +69,27 @@ bool XmlTest( const char* testString, int expected, int found, bool noEcho )
 }
 
 
+// A sink for the writer and printer tests: collects the output, and fails
+// once 'limit' writes are done.
+struct StringSink : public TiXmlSink
+{
+	StringSink() : writes( 0 ), largest( 0 ), limit( -1 ) {}
+	virtual bool Write( const char* data, size_t length ) {
+		if ( writes == limit )
+			return false;
+		++writes;
+		if ( length > largest )
+			largest = length;
+		out.append( data, length );
+		return true;
+	}
+	TIXML_STRING out;
+	int writes;
+	size_t largest;
+	int limit;
+};
+
+
 //
 // This file demonstrates some basic functionality of TinyXml.
 // Note that the example is very contrived. It presumes you know
@@ -1338,6 +1359,929 @@ int main()
 		}*/
 	}
 
+	// --------------------------------------------------------
+	printf ("\n** Arena documents **\n");
+	{
+		const char* arenaXml =	"<?xml version=\"1.0\"?>"
+								"<results page='1'>"
+									"<!-- search -->"
+									"<movie id='603' name='The Matrix &amp; more'>Neo<![CDATA[<raw>]]></movie>"
+									"<movie id='604'><title>Reloaded</title></movie>"
+								"</results>";
+
+		TiXmlDocument doc;
+		doc.SetUseArena( true, 256 );
+		XmlTest( "Arena mode on.", true, doc.UsesArena() );
+		doc.Parse( arenaXml );
+		XmlTest( "Arena parse.", false, doc.Error() );
+
+		TiXmlElement* movie = doc.RootElement()->FirstChildElement( "movie" );
+		XmlTest( "Arena element name.", "movie", movie->Value() );
+		XmlTest( "Arena attribute.", "The Matrix & more", movie->Attribute( "name" ) );
+		XmlTest( "Arena text.", "Neo", movie->GetText() );
+		XmlTest( "Arena CDATA.", "<raw>", movie->LastChild()->Value() );
+		XmlTest( "Arena comment.", " search ", doc.RootElement()->FirstChild()->Value() );
+		XmlTest( "Arena declaration.", "1.0", doc.FirstChild()->ToDeclaration()->Version() );
+		XmlTest( "Arena nested.", "Reloaded", movie->NextSiblingElement()->FirstChildElement()->GetText() );
+
+		// Arena nodes and strings can be changed, removed and copied like any other.
+		movie->SetAttribute( "name", "The Matrix" );
+		movie->SetAttribute( "year", 1999 );
+		movie->FirstChild()->SetValue( "Neo Anderson" );
+		movie->RemoveChild( movie->LastChild() );
+		movie->LinkEndChild( new TiXmlElement( "heap" ) );
+		TiXmlPrinter printer;
+		printer.SetStreamPrinting();
+		movie->Accept( &printer );
+		XmlTest( "Arena nodes modified.", "<movie id=\"603\" name=\"The Matrix\" year=\"1999\">Neo Anderson<heap /></movie>", printer.CStr() );
+
+		TiXmlDocument copy( doc );
+		XmlTest( "Arena document copy.", false, copy.UsesArena() );
+		XmlTest( "Arena document copied.", "The Matrix", copy.RootElement()->FirstChildElement()->Attribute( "name" ) );
+
+		// Reuse the document; the memory of the arena is reused as well.
+		for( int i=0; i<3; ++i )
+		{
+			doc.Clear();
+			doc.Parse( arenaXml );
+		}
+		XmlTest( "Arena document reused.", "604", doc.RootElement()->LastChild()->ToElement()->Attribute( "id" ) );
+
+		// Cleared as a TiXmlNode, the document releases the arena as well.
+		TiXmlNode* docNode = &doc;
+		docNode->Clear();
+		XmlTest( "Arena cleared through a node.", 0, (int)doc.Arena()->BytesUsed() );
+		doc.Parse( arenaXml );
+
+		TiXmlArena arena( 64 );
+		void* small = arena.Alloc( 3 );
+		void* big = arena.Alloc( 100 );
+		void* next = arena.Alloc( 8 );
+		XmlTest( "Arena alignment.", 0, (int)( (size_t)small % sizeof( double ) ) );
+		XmlTest( "Arena big block.", true, big != 0 && (char*)next == (char*)small + sizeof( double ) );
+		XmlTest( "Arena bytes used.", (int)( sizeof( double ) * 2 + 104 ), (int)arena.BytesUsed() );
+		arena.Reset();
+		XmlTest( "Arena reset reuses.", true, arena.Alloc( 8 ) == small );
+
+		doc.SetUseArena( false );
+		XmlTest( "Arena mode off.", false, doc.UsesArena() );
+		XmlTest( "Arena mode change clears.", true, doc.FirstChild() == 0 );
+	}
+
+	// --------------------------------------------------------
+	printf ("\n** In-situ parsing **\n");
+	{
+		char inSituXml[] =	"<?xml version=\"1.0\"?>\n"
+							"<results page='1'><!--search--><movie id=\"603\" name='A &amp; B' bare=x>Neo &lt;1&gt;"
+							"<![CDATA[<raw>]]>tail</movie><empty/><e a=''></e><!DOCTYPE x></results>";
+
+		TiXmlDocument doc;
+		doc.ParseInSitu( inSituXml );
+		XmlTest( "In-situ parse.", false, doc.Error() );
+
+		TiXmlElement* root = doc.RootElement();
+		TiXmlElement* movie = root->FirstChildElement( "movie" );
+		XmlTest( "In-situ element name.", "results", root->Value() );
+		XmlTest( "In-situ attribute.", "603", movie->Attribute( "id" ) );
+		XmlTest( "In-situ attribute entity.", "A & B", movie->Attribute( "name" ) );
+		XmlTest( "In-situ unquoted attribute.", "x", movie->Attribute( "bare" ) );
+		XmlTest( "In-situ text entities.", "Neo <1>", movie->GetText() );
+		XmlTest( "In-situ CDATA.", "<raw>", movie->FirstChild()->NextSibling()->Value() );
+		XmlTest( "In-situ text after CDATA.", "tail", movie->LastChild()->Value() );
+		XmlTest( "In-situ comment.", "search", root->FirstChild()->Value() );
+		XmlTest( "In-situ empty element.", "empty", movie->NextSiblingElement()->Value() );
+		XmlTest( "In-situ empty attribute.", "", root->FirstChildElement( "e" )->Attribute( "a" ) );
+		XmlTest( "In-situ unknown.", "!DOCTYPE x", root->LastChild()->Value() );
+		XmlTest( "In-situ declaration.", "1.0", doc.FirstChild()->ToDeclaration()->Version() );
+		#ifndef TIXML_USE_STL
+		XmlTest( "In-situ names point into the input.", true,
+				 movie->Value() > inSituXml && movie->Value() < inSituXml + sizeof( inSituXml ) );
+		#endif
+
+		movie->SetAttribute( "name", "The Matrix" );
+		movie->FirstChild()->SetValue( "Neo" );
+		XmlTest( "In-situ values can change.", "The Matrix", movie->Attribute( "name" ) );
+		XmlTest( "In-situ text can change.", "Neo", movie->GetText() );
+
+		TiXmlDocument arenaDoc;
+		arenaDoc.SetUseArena( true );
+		char* adopted = new char[ 64 ];
+		strcpy( adopted, "<a b='c'>d &amp; e</a>" );
+		arenaDoc.ParseInSitu( adopted, TIXML_DEFAULT_ENCODING, true );
+		XmlTest( "In-situ with arena.", "d & e", arenaDoc.RootElement()->GetText() );
+		XmlTest( "In-situ with arena attribute.", "c", arenaDoc.RootElement()->Attribute( "b" ) );
+
+		char badXml[] = "<a><b>text</a>";
+		TiXmlDocument bad;
+		bad.ParseInSitu( badXml );
+		XmlTest( "In-situ error.", true, bad.Error() );
+	}
+
+	printf ("\n** Pull parser **\n");
+	{
+		const char* pullXml =	"<?xml version=\"1.0\" encoding='UTF-8'?>\n"
+								"<results page='1'><!--search-->\n"
+								"  <movie id=\"603\" name='A &amp; B'>Neo &lt;1&gt;<![CDATA[<raw>]]></movie>\n"
+								"  <movie id='604'/>\n"
+								"  <!DOCTYPE x>\n"
+								"</results>";
+
+		// Write each event as a letter, and the name/value in brackets.
+		char events[512] = "";
+		TiXmlPullParser parser( pullXml );
+		int maxDepth = 0;
+		for( ;; )
+		{
+			TiXmlPullParser::Event e = parser.Next();
+			if ( e == TiXmlPullParser::END_DOCUMENT || e == TiXmlPullParser::PARSE_ERROR )
+				break;
+			if ( parser.Depth() > maxDepth )
+				maxDepth = parser.Depth();
+
+			char buf[64];
+			switch ( e )
+			{
+				case TiXmlPullParser::START_ELEMENT:	sprintf( buf, "S(%s)", parser.Name() );	break;
+				case TiXmlPullParser::ATTRIBUTE:		sprintf( buf, "A(%s=%s)", parser.Name(), parser.Value() );	break;
+				case TiXmlPullParser::END_ELEMENT:		sprintf( buf, "E(%s)", parser.Name() );	break;
+				case TiXmlPullParser::TEXT:				sprintf( buf, "%c(%s)", parser.CData() ? 'D' : 'T', parser.Value() );	break;
+				case TiXmlPullParser::COMMENT:			sprintf( buf, "C(%s)", parser.Value() );	break;
+				case TiXmlPullParser::DECLARATION:		sprintf( buf, "X(%s)", parser.Name() );	break;
+				default:								sprintf( buf, "U(%s)", parser.Value() );	break;
+			}
+			strcat( events, buf );
+		}
+		XmlTest( "Pull events.",	"X(xml)A(version=1.0)A(encoding=UTF-8)"
+									"S(results)A(page=1)C(search)"
+									"S(movie)A(id=603)A(name=A & B)T(Neo <1>)D(<raw>)E(movie)"
+									"S(movie)A(id=604)E(movie)"
+									"U(!DOCTYPE x)E(results)",
+				 events );
+		XmlTest( "Pull ends.", TiXmlPullParser::END_DOCUMENT, parser.Current() );
+		XmlTest( "Pull ends only once.", TiXmlPullParser::END_DOCUMENT, parser.Next() );
+		XmlTest( "Pull depth.", 2, maxDepth );
+		XmlTest( "Pull depth at end.", 0, parser.Depth() );
+
+		TiXmlPullParser badEnd( "<a>\n<b>text</a>" );
+		while ( badEnd.Next() != TiXmlPullParser::PARSE_ERROR && badEnd.Current() != TiXmlPullParser::END_DOCUMENT )
+			;
+		XmlTest( "Pull mismatched end tag.", TiXmlBase::TIXML_ERROR_READING_END_TAG, badEnd.ErrorId() );
+		XmlTest( "Pull error row.", 2, badEnd.ErrorRow() );
+		XmlTest( "Pull error col.", 8, badEnd.ErrorCol() );
+
+		TiXmlPullParser unclosed( "<a><b>" );
+		while ( unclosed.Next() != TiXmlPullParser::PARSE_ERROR && unclosed.Current() != TiXmlPullParser::END_DOCUMENT )
+			;
+		XmlTest( "Pull unclosed element.", true, unclosed.Error() );
+
+		TiXmlPullParser empty( "  " );
+		XmlTest( "Pull empty document.", TiXmlBase::TIXML_ERROR_DOCUMENT_EMPTY, empty.Next() == TiXmlPullParser::PARSE_ERROR ? empty.ErrorId() : 0 );
+
+		// Pick the names out of the movies with callbacks.
+		struct MovieNames : public TiXmlSaxHandler
+		{
+			MovieNames() : movies( 0 ), stopped( false ) { names[0] = 0; }
+			virtual bool StartElement( const char* name )	{ if ( strcmp( name, "movie" ) == 0 ) ++movies; return true; }
+			virtual bool Attribute( const char* name, const char* value ) {
+				if ( strcmp( name, "name" ) == 0 )
+					strcat( names, value );
+				return true;
+			}
+			virtual bool Unknown( const char* ) { stopped = true; return false; }
+			virtual bool EndElement( const char* )	{ return !stopped; }
+
+			int movies;
+			bool stopped;
+			char names[64];
+		};
+		MovieNames handler;
+		TiXmlPullParser saxParser( pullXml );
+		XmlTest( "SAX parse.", true, saxParser.Accept( &handler ) );
+		XmlTest( "SAX movies.", 2, handler.movies );
+		XmlTest( "SAX attribute.", "A & B", handler.names );
+		XmlTest( "SAX stopped by handler.", TiXmlPullParser::UNKNOWN, saxParser.Current() );
+
+		TiXmlPullParser saxBad( "<a><b></a>" );
+		TiXmlSaxHandler nothing;
+		XmlTest( "SAX error.", false, saxBad.Accept( &nothing ) );
+	}
+
+	printf ("\n** Push parser **\n");
+	{
+		const char* pushXml =	"\xef\xbb\xbf<?xml version=\"1.0\"?>\n"
+								"<results page='1'><!-- a > b -->\n"
+								"  <movie id=\"603\" name='A &amp; B &gt; C'>Neo &lt;1&gt;<![CDATA[<raw>]]></movie>\n"
+								"  <movie id='604'/>\n"
+								"  <!DOCTYPE x>\n"
+								"</results>\n"
+								"<!-- after -->";
+
+		// Write each event as a letter, and the name/value in brackets.
+		struct EventLog : public TiXmlSaxHandler
+		{
+			EventLog() { log[0] = 0; }
+			void Add( char c, const char* s1, const char* s2 = 0 ) {
+				size_t len = strlen( log );
+				sprintf( log + len, s2 ? "%c(%s=%s)" : "%c(%s)", c, s1, s2 );
+			}
+			virtual bool StartElement( const char* name )					{ Add( 'S', name ); return true; }
+			virtual bool Attribute( const char* name, const char* value )	{ Add( 'A', name, value ); return true; }
+			virtual bool EndElement( const char* name )						{ Add( 'E', name ); return true; }
+			virtual bool Text( const char* text, bool cdata )				{ Add( cdata ? 'D' : 'T', text ); return true; }
+			virtual bool Comment( const char* comment )						{ Add( 'C', comment ); return true; }
+			virtual bool Declaration()										{ Add( 'X', "" ); return true; }
+			virtual bool Unknown( const char* unknown )						{ Add( 'U', unknown ); return true; }
+			char log[512];
+		};
+
+		EventLog whole;
+		TiXmlPullParser pullParser( pushXml );
+		pullParser.Accept( &whole );
+
+		// Split the input in two at every place, and in one byte pieces.
+		int splitsOkay = 0;
+		int length = (int) strlen( pushXml );
+		for ( int split=0; split<=length; ++split )
+		{
+			EventLog pieces;
+			TiXmlPushParser parser( &pieces );
+			parser.Feed( pushXml, split );
+			parser.Feed( pushXml + split, length - split );
+			if ( parser.Finish() && strcmp( whole.log, pieces.log ) == 0 )
+				++splitsOkay;
+		}
+		XmlTest( "Push split anywhere.", length+1, splitsOkay );
+
+		EventLog bytes;
+		TiXmlPushParser byteParser( &bytes );
+		for ( int i=0; i<length; ++i )
+			byteParser.Feed( pushXml + i, 1 );
+		XmlTest( "Push root closed before the end.", 0, byteParser.Depth() );
+		XmlTest( "Push not done before Finish().", false, byteParser.Done() );
+		XmlTest( "Push one byte at a time.", true, byteParser.Finish() );
+		XmlTest( "Push events.", whole.log, bytes.log );
+		XmlTest( "Push done.", true, byteParser.Done() );
+
+		// Terminators that arrive a byte at a time, or are hidden in quotes.
+		const char* splitXml = "<a x='1>2' y=\"'>\"><!-- - -> --><![CDATA[ ]] ]> ]]><!x>text</a>";
+		EventLog splitWhole;
+		TiXmlPullParser splitPull( splitXml );
+		splitPull.Accept( &splitWhole );
+		EventLog splitBytes;
+		TiXmlPushParser splitParser( &splitBytes );
+		for ( int i=0; splitXml[i]; ++i )
+			splitParser.Feed( splitXml + i, 1 );
+		XmlTest( "Push split terminators.", true, splitParser.Finish() );
+		XmlTest( "Push split terminator events.", splitWhole.log, splitBytes.log );
+
+		// Events are sent as soon as they are complete.
+		EventLog early;
+		TiXmlPushParser earlyParser( &early );
+		earlyParser.Feed( "<a x='1'><b>te", 14 );
+		XmlTest( "Push early events.", "S(a)A(x=1)S(b)", early.log );
+		earlyParser.Feed( "xt</b", 5 );
+		XmlTest( "Push early text.", "S(a)A(x=1)S(b)T(text)", early.log );
+
+		EventLog bad;
+		TiXmlPushParser badParser( &bad );
+		badParser.Feed( "<a>\n  <b>\n", 10 );
+		XmlTest( "Push error found early.", false, badParser.Feed( "  </c>", 6 ) );
+		XmlTest( "Push error id.", TiXmlBase::TIXML_ERROR_READING_END_TAG, badParser.ErrorId() );
+		XmlTest( "Push error row.", 3, badParser.ErrorRow() );
+		XmlTest( "Push error col.", 3, badParser.ErrorCol() );
+
+		EventLog unfinished;
+		TiXmlPushParser unfinishedParser( &unfinished );
+		unfinishedParser.Feed( "<a><b/>", 7 );
+		XmlTest( "Push unfinished document.", false, unfinishedParser.Finish() );
+
+		EventLog none;
+		TiXmlPushParser emptyParser( &none );
+		XmlTest( "Push empty document.", false, emptyParser.Finish() );
+		XmlTest( "Push empty document error.", TiXmlBase::TIXML_ERROR_DOCUMENT_EMPTY, emptyParser.ErrorId() );
+	}
+
+	printf ("\n** Long runs (vector scanning) **\n");
+	{
+		// Names, white space and text longer than the 16 and 32 byte blocks the
+		// scanner may use, with the interesting characters on block edges.
+		const char* longXml =
+			"<a_very_long-element.name:with_more_than_32_characters                                      "
+			"attribute_name_that_is_also_quite_long=\"0123456789abcdef0123456789abcdef &amp; 0123456789abcdef\">"
+			"\n\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\n"
+			"0123456789abcdef0123456789abcde  two spaces 0123456789abcdef0123456789abcd\tand a tab &lt; "
+			"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789 trailing    "
+			"</a_very_long-element.name:with_more_than_32_characters>";
+
+		bool condensed = TiXmlBase::IsWhiteSpaceCondensed();
+		TiXmlBase::SetCondenseWhiteSpace( true );
+		TiXmlDocument doc;
+		doc.Parse( longXml );
+		TiXmlElement* element = doc.RootElement();
+		XmlTest( "Long name.", "a_very_long-element.name:with_more_than_32_characters", element ? element->Value() : "" );
+		XmlTest( "Long attribute.", "0123456789abcdef0123456789abcdef & 0123456789abcdef",
+				 element ? element->Attribute( "attribute_name_that_is_also_quite_long" ) : "" );
+		XmlTest( "Long text condensed.",
+				 "0123456789abcdef0123456789abcde two spaces 0123456789abcdef0123456789abcd and a tab < "
+				 "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789 trailing",
+				 element ? element->GetText() : "" );
+
+		TiXmlBase::SetCondenseWhiteSpace( false );
+		TiXmlDocument keptDoc;
+		keptDoc.Parse( longXml );
+		element = keptDoc.RootElement();
+		XmlTest( "Long text kept.",
+				 "\n\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\n"
+				 "0123456789abcdef0123456789abcde  two spaces 0123456789abcdef0123456789abcd\tand a tab < "
+				 "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789 trailing    ",
+				 element ? element->GetText() : "" );
+		TiXmlBase::SetCondenseWhiteSpace( condensed );
+	}
+
+	printf ("\n** Mapped LoadFile **\n");
+	{
+		// Files are parsed where they are mapped, so new lines are normalized
+		// while parsing rather than in a copy of the file.
+		FILE* textfile = fopen( "test7.xml", "wb" );
+		if ( textfile )
+		{
+			fputs( "<a v='1\r\n2\r3'>line\r\nbreak\rhere&#13;<!--c\r\nd\r-->"
+				   "<![CDATA[x\r\ny\r]]><!u\r\nv\r></a>", textfile );
+			fclose( textfile );
+
+			bool condensed = TiXmlBase::IsWhiteSpaceCondensed();
+			TiXmlBase::SetCondenseWhiteSpace( false );
+			TiXmlDocument doc;
+			XmlTest( "Mapped load.", true, doc.LoadFile( "test7.xml" ) );
+			TiXmlElement* element = doc.RootElement();
+			TiXmlNode* node = element ? element->FirstChild() : 0;
+			XmlTest( "Mapped attribute new lines.", "1\n2\n3", element ? element->Attribute( "v" ) : "" );
+			XmlTest( "Mapped text new lines.", "line\nbreak\nhere\r", node ? node->Value() : "" );
+			node = node ? node->NextSibling() : 0;
+			XmlTest( "Mapped comment new lines.", "c\nd\n", node ? node->Value() : "" );
+			node = node ? node->NextSibling() : 0;
+			XmlTest( "Mapped CDATA new lines.", "x\ny\n", node ? node->Value() : "" );
+			node = node ? node->NextSibling() : 0;
+			XmlTest( "Mapped unknown new lines.", "!u\nv\n", node ? node->Value() : "" );
+			TiXmlBase::SetCondenseWhiteSpace( condensed );
+		}
+
+		// A file that fills its last page exactly still has a terminator.
+		textfile = fopen( "test8.xml", "wb" );
+		if ( textfile )
+		{
+			fputs( "<a>", textfile );
+			for( int i=0; i<4096-7; ++i )
+				fputc( 'x', textfile );
+			fputs( "</a>", textfile );
+			fclose( textfile );
+
+			TiXmlDocument doc;
+			XmlTest( "Mapped page sized load.", true, doc.LoadFile( "test8.xml" ) );
+			const char* text = doc.RootElement() ? doc.RootElement()->GetText() : 0;
+			XmlTest( "Mapped page sized text.", 4096-7, text ? (int) strlen( text ) : 0 );
+		}
+	}
+
+	printf ("\n** Many attributes **\n");
+	{
+		// Past a handful of attributes the set switches to a hashed index;
+		// order, lookups, renames and removals must all still hold.
+		char xml[2048] = "<e";
+		for( int i=0; i<40; ++i )
+			sprintf( xml + strlen( xml ), " a%d='%d'", i, i );
+		strcat( xml, "/>" );
+
+		TiXmlDocument doc;
+		doc.Parse( xml );
+		TiXmlElement* element = doc.RootElement();
+		XmlTest( "Many attributes parsed.", false, doc.Error() );
+
+		int found = 0;
+		for( int i=0; i<40; ++i )
+		{
+			char name[16];
+			sprintf( name, "a%d", i );
+			int value = -1;
+			if ( element->QueryIntAttribute( name, &value ) == TIXML_SUCCESS && value == i )
+				++found;
+		}
+		XmlTest( "Many attributes found.", 40, found );
+		XmlTest( "Many attributes missing.", true, element->Attribute( "a40" ) == 0 );
+
+		element->RemoveAttribute( "a7" );
+		element->FirstAttribute()->SetName( "renamed" );
+		element->SetAttribute( "added", "x" );
+		XmlTest( "Many attributes removed.", true, element->Attribute( "a7" ) == 0 );
+		XmlTest( "Many attributes renamed.", "0", element->Attribute( "renamed" ) );
+		XmlTest( "Many attributes old name.", true, element->Attribute( "a0" ) == 0 );
+		XmlTest( "Many attributes added.", "x", element->Attribute( "added" ) );
+		XmlTest( "Many attributes order.", "added", element->LastAttribute()->Name() );
+		XmlTest( "Many attributes second.", "a1", element->FirstAttribute()->Next()->Name() );
+
+		strcpy( xml + strlen( xml ) - 2, " a3='dup'/>" );
+		TiXmlDocument dupDoc;
+		dupDoc.Parse( xml );
+		XmlTest( "Many attributes duplicate.", TiXmlBase::TIXML_ERROR_PARSING_ELEMENT, dupDoc.ErrorId() );
+	}
+
+#ifdef TIXML_USE_STL
+	printf ("\n** Stream input **\n");
+	{
+		// Streamed a buffer at a time; more than one buffer's worth so
+		// tags and text straddle the refills.
+		string xml = "<?xml version='1.0'?>\n<root>";
+		for( int i=0; i<2000; ++i )
+			xml += "<movie id='1'>Some text &amp; more<!-- a -- comment --><![CDATA[<x>]]></movie>\n";
+		xml += "</root>";
+
+		istringstream in( xml + "<after/>" );
+		TiXmlDocument streamed;
+		in >> streamed;
+		TiXmlDocument parsed;
+		parsed.Parse( xml.c_str() );
+
+		TiXmlPrinter streamedPrinter, parsedPrinter;
+		streamed.Accept( &streamedPrinter );
+		parsed.Accept( &parsedPrinter );
+		XmlTest( "Stream no error.", false, streamed.Error() );
+		XmlTest( "Stream matches parse.", true, streamedPrinter.Str() == parsedPrinter.Str() );
+		string rest;
+		getline( in, rest );
+		XmlTest( "Stream stops after the root.", "<after/>", rest.c_str() );
+
+		// Neither of these should hang.
+		istringstream truncated( "<root>text<e/>more" );
+		TiXmlDocument truncatedDoc;
+		truncated >> truncatedDoc;
+		XmlTest( "Stream truncated.", true, truncatedDoc.Error() );
+
+		istringstream embedded( string( "<root>a\0b</root>", 16 ) );
+		TiXmlDocument embeddedDoc;
+		embedded >> embeddedDoc;
+		XmlTest( "Stream null in text.", "ab", embeddedDoc.RootElement() ? embeddedDoc.RootElement()->GetText() : "" );
+	}
+#endif
+
+	printf ("\n** Lazy locations **\n");
+	{
+		const char* bad = "<?xml version='1.0'?>\n<root>\n\t<a x='1'/>\r\n\t<b>text</c>\n</root>";
+
+		TiXmlDocument eager;
+		eager.Parse( bad );
+		TiXmlDocument lazy;
+		lazy.SetLazyLocations( true );
+		lazy.Parse( bad );
+		XmlTest( "Lazy error.", eager.ErrorId(), lazy.ErrorId() );
+		XmlTest( "Lazy error row.", eager.ErrorRow(), lazy.ErrorRow() );
+		XmlTest( "Lazy error col.", eager.ErrorCol(), lazy.ErrorCol() );
+		XmlTest( "Lazy error row value.", 4, lazy.ErrorRow() );
+
+		TiXmlDocument good;
+		good.SetLazyLocations( true );
+		good.Parse( "<root>\n\t<a x='1'/>\n</root>" );
+		TiXmlElement* a = good.RootElement()->FirstChildElement();
+		XmlTest( "Lazy node has no row.", 0, a->Row() );
+		XmlTest( "Lazy node has no column.", 0, a->Column() );
+		XmlTest( "Lazy attribute has no row.", 0, a->FirstAttribute()->Row() );
+	}
+
+	printf ("\n** Entity decoding **\n");
+	{
+		TiXmlDocument doc;
+		doc.Parse( "<e a='&quot;&apos;&amp;&lt;&gt;'>&#x41;&#x4a;&#66;&#x00e9;&amp&ap;</e>", 0, TIXML_ENCODING_UTF8 );
+		TiXmlElement* element = doc.RootElement();
+		XmlTest( "Named entities.", "\"'&<>", element ? element->Attribute( "a" ) : "" );
+		// An unknown or unterminated name loses its '&'.
+		XmlTest( "Numeric entities.", "AJB\xc3\xa9" "ampap;", element ? element->GetText() : "" );
+
+		TiXmlDocument unterminated;
+		unterminated.Parse( "<e>&#x41 and no semicolon</e>" );
+		XmlTest( "Unterminated reference.", true, unterminated.Error() );
+	}
+
+#ifndef TIXML_USE_STL
+	printf ("\n** Small strings **\n");
+	{
+		TiXmlString small( "short" );
+		TiXmlString large( "a string too long to be kept inline" );
+		small.swap( large );
+		XmlTest( "Swap to local.", "short", large.c_str() );
+		XmlTest( "Swap to heap.", "a string too long to be kept inline", small.c_str() );
+		small.swap( small );
+		XmlTest( "Swap with itself.", "a string too long to be kept inline", small.c_str() );
+
+		TiXmlString grown( "0123456789" );
+		grown += "abcdef";
+		XmlTest( "Append past local.", "0123456789abcdef", grown.c_str() );
+		XmlTest( "Appended length.", 16, (int) grown.length() );
+
+		TiXmlString copy( grown );
+		grown.clear();
+		XmlTest( "Copy is independent.", "0123456789abcdef", copy.c_str() );
+		copy = copy;
+		XmlTest( "Assign to itself.", "0123456789abcdef", copy.c_str() );
+		copy = "tiny";
+		XmlTest( "Assign short.", "tiny", copy.c_str() );
+	}
+#endif
+
+	printf ("\n** Interned names **\n");
+	{
+		TiXmlDocument doc1;
+		doc1.Parse( "<movie id='1'><name/></movie>" );
+		TiXmlDocument doc2;
+		doc2.Parse( "<movies><movie id='2'/></movies>" );
+		TiXmlElement* movie1 = doc1.RootElement();
+		TiXmlElement* movie2 = doc2.RootElement()->FirstChildElement();
+		XmlTest( "Same name, same symbol.", true, movie1->Symbol() == movie2->Symbol() );
+		XmlTest( "Symbol of name.", true, movie1->Symbol() == TiXmlNameTable::Intern( "movie" ) );
+		XmlTest( "Attribute symbol.", true, movie1->FirstAttribute()->Symbol() == movie2->FirstAttribute()->Symbol() );
+		XmlTest( "Unknown name.", true, TiXmlNameTable::Find( "no element has this name" ) == 0 );
+
+		movie1->FirstChildElement()->SetValue( "title" );
+		XmlTest( "Renamed element.", true, movie1->FirstChildElement( "title" ) != 0 );
+		XmlTest( "Old name is gone.", true, movie1->FirstChildElement( "name" ) == 0 );
+
+		movie2->SetAttribute( "rating", "7.5" );
+		movie2->FirstAttribute()->SetName( "key" );
+		XmlTest( "Renamed attribute.", "2", movie2->Attribute( "key" ) );
+		XmlTest( "Old attribute name is gone.", true, movie2->Attribute( "id" ) == 0 );
+		XmlTest( "Added attribute.", "7.5", movie2->Attribute( "rating" ) );
+
+		TiXmlText text( "movie" );
+		XmlTest( "Only elements have symbols.", true, text.Symbol() == 0 );
+
+		// Lookups of names no element has don't add them to the table.
+		size_t names = TiXmlNameTable::Size();
+		XmlTest( "Missing attribute.", true, movie1->Attribute( "unseen-attribute" ) == 0 );
+		XmlTest( "Missing child.", true, movie1->FirstChildElement( "unseen-child" ) == 0 );
+		TiXmlPath unseen( "/unseen-root/unseen-kept" );
+		XmlTest( "Missing path.", true, unseen.First( &doc1 ) == 0 );
+		XmlTest( "Lookups don't grow the table.", true, TiXmlNameTable::Size() == names );
+
+		// The names of a path compiled earlier are found once a document has them.
+		TiXmlDocument late;
+		late.Parse( "<unseen-root><unseen-kept/></unseen-root>" );
+		XmlTest( "Path compiled before the names.", true, unseen.First( &late ) == late.RootElement()->FirstChildElement() );
+
+		TiXmlDocument selected;
+		selected.AddKeepPath( TiXmlPath( "/unseen-selected/unseen-kept-too" ) );
+		selected.Parse( "<unseen-selected><unseen-skipped/><unseen-kept-too>x</unseen-kept-too></unseen-selected>" );
+		TiXmlElement* kept = selected.RootElement() ? selected.RootElement()->FirstChildElement() : 0;
+		XmlTest( "Selective parse of new names.", "x", kept ? kept->GetText() : "" );
+		XmlTest( "Selective parse of new names skips.", true, kept && !kept->NextSibling() && !kept->PreviousSibling() );
+	}
+
+	printf ("\n** Child index **\n");
+	{
+		XmlTest( "Child index off by default.", false, TiXmlNode::IsIndexingChildren() );
+		TiXmlNode::SetIndexChildren( true );
+
+		TiXmlDocument doc;
+		doc.Parse( "<movie><id/><name/><type/><url/><votes/><rating/><released/><runtime/><budget/>"
+		           "<revenue/><homepage/><trailer/><studios/>overview<cast/><overview/></movie>" );
+		TiXmlElement* movie = doc.RootElement();
+		TiXmlElement* overview = movie->FirstChildElement( "overview" );
+		XmlTest( "Indexed element.", true, overview != 0 && overview->PreviousSibling()->ToElement() != 0 );
+		XmlTest( "Indexed element again.", true, movie->FirstChildElement( "overview" ) == overview );
+		XmlTest( "Indexed text comes first.", true, movie->FirstChild( "overview" ) == overview->PreviousSibling()->PreviousSibling() );
+		XmlTest( "Indexed miss.", true, movie->FirstChildElement( "adult" ) == 0 );
+
+		movie->FirstChildElement( "id" )->SetValue( "adult" );
+		XmlTest( "Index after rename.", true, movie->FirstChildElement( "adult" ) == movie->FirstChild() );
+		XmlTest( "Old name after rename.", true, movie->FirstChildElement( "id" ) == 0 );
+
+		movie->RemoveChild( overview );
+		XmlTest( "Index after remove.", true, movie->FirstChildElement( "overview" ) == 0 );
+		movie->InsertBeforeChild( movie->FirstChild(), TiXmlElement( "overview" ) );
+		XmlTest( "Index after insert.", true, movie->FirstChildElement( "overview" ) == movie->FirstChild() );
+		movie->LinkEndChild( new TiXmlElement( "keywords" ) );
+		XmlTest( "Index after link.", true, movie->FirstChildElement( "keywords" ) == movie->LastChild() );
+		movie->Clear();
+		XmlTest( "Index after clear.", true, movie->FirstChild( "keywords" ) == 0 );
+
+		TiXmlNode::SetIndexChildren( false );
+	}
+
+	printf ("\n** Compiled paths **\n");
+	{
+		TiXmlDocument doc;
+		doc.Parse( "<OpenSearchDescription><movies>"
+		           "<movie><name>Alien</name><id>1</id></movie>"
+		           "<person><name>Ridley</name></person>"
+		           "<movie><id>2</id></movie>"
+		           "<movie><name>Heat</name><name>Heat (1995)</name></movie>"
+		           "</movies></OpenSearchDescription>" );
+
+		TiXmlPath names( "/OpenSearchDescription/movies/movie[*]/name" );
+		XmlTest( "Path compiles.", false, names.Error() );
+		XmlTest( "Path steps.", 4, names.Steps() );
+		TIXML_STRING found;
+		for( TiXmlPathIterator it( names, &doc ); it.Element(); it.Next() )
+		{
+			found += it.Element()->GetText();
+			found += ";";
+		}
+		XmlTest( "Path matches.", "Alien;Heat;", found.c_str() );
+
+		found = "";
+		TiXmlPath allNames( "/*/movies/*[*]/name[*]" );
+		for( TiXmlPathIterator it( allNames, &doc ); it.Element(); it.Next() )
+		{
+			found += it.Element()->GetText();
+			found += ";";
+		}
+		XmlTest( "Path wildcards.", "Alien;Ridley;Heat;Heat (1995);", found.c_str() );
+
+		TiXmlElement* movies = doc.RootElement()->FirstChildElement();
+		XmlTest( "Indexed step.", "2", TiXmlPath( "movie[1]/id" ).First( movies )->GetText() );
+		XmlTest( "Relative path.", true, TiXmlPath( "movie[3]" ).First( movies ) == 0 );
+		XmlTest( "Absolute path from a child.", "Alien", TiXmlPath( "/OpenSearchDescription/movies/movie/name" ).First( movies )->GetText() );
+		XmlTest( "Handle path.", "Heat (1995)", TiXmlHandle( &doc ).Path( TiXmlPath( "OpenSearchDescription/movies/movie[2]/name[1]" ) ).ToElement()->GetText() );
+		XmlTest( "Unknown name.", true, TiXmlPath( "/OpenSearchDescription/shows[*]" ).First( &doc ) == 0 );
+
+		TiXmlPath copy( names );
+		XmlTest( "Copied path.", "Alien", copy.First( &doc )->GetText() );
+
+		TiXmlPath bad( "/movies/movie[x]" );
+		XmlTest( "Path error.", true, bad.Error() );
+		XmlTest( "Path error offset.", 14, bad.ErrorOffset() );
+		XmlTest( "Path error selects nothing.", true, bad.First( &doc ) == 0 );
+		XmlTest( "Empty step.", 7, TiXmlPath( "movies//name" ).ErrorOffset() );
+	}
+
+	printf ("\n** Streaming writer **\n");
+	{
+		StringSink sink;
+		{
+			TiXmlWriter writer( &sink, 16 );
+			writer.Declaration( "1.0", "UTF-8", "" );
+			writer.StartElement( "movie" );
+			writer.Attribute( "id", 550 );
+			writer.Attribute( "title", "Say \"hi\"" );
+			writer.StartElement( "name" );
+			writer.Text( "Fight Club & <more>" );
+			writer.EndElement();
+			writer.StartElement( "keywords" );
+			writer.StartElement( "keyword" );
+			writer.DoubleAttribute( "weight", 0.5 );
+			writer.EndElement();
+			writer.Comment( " none " );
+			writer.EndElement();
+			XmlTest( "Writer depth.", 1, writer.Depth() );
+			XmlTest( "Writer end.", true, writer.EndElement() );
+			XmlTest( "Writer end with nothing open.", false, writer.EndElement() );
+		}
+
+		TiXmlDocument doc;
+		doc.Parse( sink.out.c_str() );
+		XmlTest( "Writer output parses.", false, doc.Error() );
+		XmlTest( "Writer text escaped.", "Fight Club & <more>", doc.RootElement()->FirstChildElement( "name" )->GetText() );
+		XmlTest( "Writer attribute quoted.", "Say \"hi\"", doc.RootElement()->Attribute( "title" ) );
+
+		TiXmlPrinter printer;
+		doc.Accept( &printer );
+		XmlTest( "Writer prints as TiXmlPrinter.", printer.CStr(), sink.out.c_str() );
+		XmlTest( "Writer flushed in pieces.", true, sink.writes > 1 && sink.largest <= 16 );
+
+		StringSink dense;
+		{
+			TiXmlWriter writer( &dense );
+			writer.SetStreamPrinting();
+			writer.StartElement( "a" );
+			writer.Text( "x\ty" );
+			XmlTest( "Writer attribute after text.", false, writer.Attribute( "late", "1" ) );
+			writer.StartElement( "b" );
+			writer.EndElement();
+			writer.CData( "<raw>" );
+			writer.EndElement();
+			XmlTest( "Writer text outside elements.", false, writer.Text( "stray" ) );
+			XmlTest( "Writer buffered.", 0, dense.writes );
+		}
+		XmlTest( "Writer stream printing.", "<a>x&#x09;y<b /><![CDATA[<raw>]]></a>", dense.out.c_str() );
+
+		StringSink failing;
+		failing.limit = 1;
+		TiXmlWriter writer( &failing, 8 );
+		writer.StartElement( "movies" );
+		writer.StartElement( "movie" );
+		XmlTest( "Writer sink failure.", true, writer.Error() );
+		XmlTest( "Writer stops after failure.", false, writer.Text( "ignored" ) );
+		XmlTest( "Writer flush after failure.", false, writer.Flush() );
+	}
+
+	printf ("\n** Printer reserve and sinks **\n");
+	{
+		TiXmlDocument doc;
+		doc.Parse( "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"
+		           "<movies><movie id='550' lang=\"en\"><name>Fight Club</name>"
+		           "<keywords><keyword/><!-- none --></keywords></movie>"
+		           "<movie id='551'><name><![CDATA[<raw>]]></name></movie></movies>" );
+
+		TiXmlPrinter printer;
+		size_t estimate = printer.EstimateSize( doc );
+		doc.Accept( &printer );
+		XmlTest( "Estimate covers the output.", true, estimate >= printer.Size() && estimate < 2 * printer.Size() );
+
+		TiXmlPrinter dense;
+		dense.SetStreamPrinting();
+		XmlTest( "Estimate follows the layout.", true, dense.EstimateSize( doc ) < estimate );
+
+		StringSink sink;
+		TiXmlPrinter streamed;
+		streamed.SetSink( &sink, 32 );
+		XmlTest( "Printer to sink.", true, doc.Accept( &streamed ) );
+		XmlTest( "Sink output matches.", printer.CStr(), sink.out.c_str() );
+		XmlTest( "Sink written in pieces.", true, sink.writes > 1 );
+		XmlTest( "Nothing left waiting.", 0, (int) streamed.Size() );
+
+		// An element is not flushed until asked.
+		StringSink elementSink;
+		TiXmlPrinter elementPrinter;
+		elementPrinter.SetSink( &elementSink );
+		doc.RootElement()->FirstChildElement()->Accept( &elementPrinter );
+		XmlTest( "Element waits for Flush.", 0, elementSink.writes );
+		XmlTest( "Element flushed.", true, elementPrinter.Flush() && elementSink.out.length() > 0 );
+
+		StringSink failing;
+		failing.limit = 0;
+		TiXmlPrinter failed;
+		failed.SetSink( &failing, 16 );
+		XmlTest( "Printer stops on sink failure.", false, doc.Accept( &failed ) );
+		XmlTest( "Printer sink error.", true, failed.Error() );
+	}
+
+	printf ("\n** Long runs (vector escaping) **\n");
+	{
+		// Text longer than the 16 and 32 byte blocks, with the characters to
+		// replace on block edges. High bytes and DEL are copied as they are.
+		TiXmlElement movie( "overview" );
+		movie.LinkEndChild( new TiXmlText(	"0123456789abcde<0123456789abcdef>0123456789abcde&0123456789abcdef"
+											"\"\xc3\xa9\x7f 3456789abcdef0123456789abcd\t'\x01" ) );
+		TiXmlPrinter printer;
+		printer.SetStreamPrinting();
+		movie.Accept( &printer );
+		XmlTest( "Long text escaped.",
+				 "<overview>0123456789abcde&lt;0123456789abcdef&gt;0123456789abcde&amp;0123456789abcdef"
+				 "&quot;\xc3\xa9\x7f 3456789abcdef0123456789abcd&#x09;&apos;&#x01;</overview>",
+				 printer.CStr() );
+
+		TIXML_STRING clean( "0123456789abcdef0123456789abcdef0123456789abcdef &#xA9; 0123456789abcdef" );
+		TIXML_STRING encoded;
+		TiXmlBase::EncodeString( clean, &encoded );
+		XmlTest( "Long text unchanged.", clean.c_str(), encoded.c_str() );
+	}
+
+	printf ("\n** Binary snapshots **\n");
+	{
+		TiXmlDocument doc;
+		doc.Parse( "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"
+		           "<!-- reference tables -->"
+		           "<tables>"
+		           "<genre id='18' name='Drama'>Stories &amp; people</genre>"
+		           "<genre id='35' name='Comedy'><![CDATA[<laughs>]]></genre>"
+		           "<certification country='US'><name>PG-13</name></certification>"
+		           "<!DOCTYPE anything>"
+		           "<genre id='27' name='Horror' />"
+		           "</tables>" );
+
+		TIXML_STRING data;
+		XmlTest( "Snapshot written.", true, TiXmlSnapshot::Write( doc, &data ) );
+
+		TiXmlSnapshot snapshot;
+		XmlTest( "Snapshot attached.", true, snapshot.Attach( data.c_str(), data.length() ) );
+		XmlTest( "Snapshot nodes.", 13, snapshot.NodeCount() );
+
+		TiXmlSnapshotNode tables = snapshot.RootElement();
+		XmlTest( "Snapshot root.", "tables", tables.Value() );
+		TiXmlSnapshotNode genre = tables.FirstChildElement( "genre" );
+		XmlTest( "Snapshot attribute.", "Drama", genre.Attribute( "name" ) );
+		XmlTest( "Snapshot text.", "Stories & people", genre.GetText() );
+		genre = genre.NextSiblingElement( "genre" );
+		XmlTest( "Snapshot CDATA.", true, genre.FirstChild().CDATA() );
+		genre = genre.NextSiblingElement( "genre" );
+		XmlTest( "Snapshot skips other elements.", "Horror", genre.Attribute( "name" ) );
+		XmlTest( "Snapshot attribute by index.", "id", genre.AttributeName( 0 ) );
+		XmlTest( "Snapshot no more.", true, genre.NextSiblingElement( "genre" ).IsNull() );
+		XmlTest( "Snapshot parent.", true, genre.Parent() == tables );
+		XmlTest( "Snapshot nested.", "PG-13", tables.FirstChildElement( "certification" ).FirstChildElement( "name" ).GetText() );
+		XmlTest( "Snapshot null chains.", true, tables.FirstChildElement( "person" ).FirstChildElement().Attribute( "id" ) == 0 );
+		XmlTest( "Snapshot declaration.", "UTF-8", snapshot.Root().FirstChild().Attribute( "encoding" ) );
+
+		TiXmlPrinter printer;
+		doc.Accept( &printer );
+		TiXmlDocument copy;
+		XmlTest( "Snapshot to document.", true, snapshot.CopyTo( &copy ) );
+		TiXmlPrinter copyPrinter;
+		copy.Accept( &copyPrinter );
+		XmlTest( "Snapshot prints as the document.", printer.CStr(), copyPrinter.CStr() );
+
+		XmlTest( "Snapshot saved.", true, TiXmlSnapshot::SaveFile( doc, "snapshottest.snap" ) );
+		TiXmlSnapshot loaded;
+		XmlTest( "Snapshot loaded.", true, loaded.LoadFile( "snapshottest.snap" ) );
+		XmlTest( "Snapshot loaded root.", "Comedy", loaded.RootElement().FirstChildElement().NextSiblingElement().Attribute( "name" ) );
+		XmlTest( "Snapshot missing file.", false, loaded.LoadFile( "no/such/file.snap" ) );
+		XmlTest( "Snapshot closed.", true, loaded.Root().IsNull() );
+
+		// A damaged snapshot does not load.
+		XmlTest( "Snapshot truncated.", false, snapshot.Attach( data.c_str(), data.length() - 1 ) );
+		unsigned* damaged = new unsigned[ data.length() / sizeof( unsigned ) + 1 ];
+		memcpy( damaged, data.c_str(), data.length() );
+		TiXmlSnapshot::Node* nodes = (TiXmlSnapshot::Node*)( (char*) damaged + sizeof( TiXmlSnapshot::Header ) );
+		nodes[2].firstChild = 1;
+		XmlTest( "Snapshot cycle.", false, snapshot.Attach( damaged, data.length() ) );
+		nodes[2].firstChild = TiXmlSnapshot::NONE;
+		XmlTest( "Snapshot repaired.", true, snapshot.Attach( damaged, data.length() ) );
+		// <certification> taking the text of its <name> as its own child.
+		nodes[8].firstChild = 10;
+		XmlTest( "Snapshot shared child.", false, snapshot.Attach( damaged, data.length() ) );
+		nodes[8].firstChild = 9;
+		// The first <genre> followed by that text, which is also <name>'s child.
+		nodes[4].nextSibling = 10;
+		XmlTest( "Snapshot shared sibling.", false, snapshot.Attach( damaged, data.length() ) );
+		delete [] damaged;
+		XmlTest( "Snapshot not a snapshot.", false, snapshot.Attach( printer.CStr(), printer.Size() & ~(size_t) 3 ) );
+	}
+
+	printf ("\n** Selective parsing **\n");
+	{
+		const char* search =
+			"<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"
+			"<OpenSearchDescription>\n"
+			"  <opensearch:totalResults>2</opensearch:totalResults>\n"
+			"  <movies>\n"
+			"    <movie><name>Alien</name><id>348</id>\n"
+			"      <images><image type='poster' url=\"http://x/a.jpg?size=<large>\"/><image type='backdrop'></image></images>\n"
+			"      <cast><person name='Sigourney Weaver'><!-- </cast> --><![CDATA[</person>]]></person></cast>\n"
+			"    </movie>\n"
+			"    <movie><name>Aliens</name><id>679</id><images/></movie>\n"
+			"  </movies>\n"
+			"</OpenSearchDescription>\n";
+
+		TiXmlDocument doc;
+		doc.AddKeepPath( TiXmlPath( "/OpenSearchDescription/movies/movie[*]/name" ) );
+		doc.AddKeepPath( TiXmlPath( "OpenSearchDescription/movies/movie[1]/id" ) );
+		XmlTest( "Keep paths.", 2, doc.KeepPaths() );
+		doc.Parse( search );
+		XmlTest( "Selective parse.", false, doc.Error() );
+
+		TiXmlPrinter printer;
+		printer.SetStreamPrinting();
+		doc.Accept( &printer );
+		XmlTest( "Selective parse keeps the paths.",
+				 "<?xml version=\"1.0\" encoding=\"UTF-8\" ?><OpenSearchDescription><movies>"
+				 "<movie><name>Alien</name></movie><movie><name>Aliens</name><id>679</id></movie>"
+				 "</movies></OpenSearchDescription>",
+				 printer.CStr() );
+		XmlTest( "Selective parse locations.", 9, doc.RootElement()->FirstChildElement()->LastChild()->Row() );
+
+		// A kept element is read whole, comments and all.
+		TiXmlDocument whole;
+		whole.AddKeepPath( TiXmlPath( "/OpenSearchDescription/movies/movie/cast" ) );
+		whole.Parse( search );
+		TiXmlElement* person = TiXmlHandle( &whole ).Path( TiXmlPath( "/OpenSearchDescription/movies/movie/cast/person" ) ).ToElement();
+		XmlTest( "Selective parse keeps subtrees.", "Sigourney Weaver", person ? person->Attribute( "name" ) : "" );
+		XmlTest( "Selective parse keeps comments.", " </cast> ", person ? person->FirstChild()->Value() : "" );
+		XmlTest( "Selective parse skips the rest.", true, TiXmlHandle( &whole ).Path( TiXmlPath( "/*/movies/movie[1]" ) ).ToNode() == 0 );
+
+		TiXmlDocument any;
+		any.SetUseArena( true );
+		any.AddKeepPath( TiXmlPath( "/*/movies/*[0]/*[*]" ) );
+		any.Parse( search );
+		int count = 0;
+		TiXmlPath children( "/*/movies/movie[*]/*[*]" );
+		for( TiXmlPathIterator it( children, &any ); it.Element(); it.Next() )
+			++count;
+		XmlTest( "Selective parse with '*'.", 4, count );
+
+		// The copy parses the same way.
+		TiXmlDocument copy( doc );
+		XmlTest( "Keep paths copied.", 2, copy.KeepPaths() );
+		copy.ClearKeepPaths();
+		XmlTest( "Keep paths cleared.", 0, copy.KeepPaths() );
+		copy.Clear();
+		copy.Parse( search );
+		XmlTest( "Full parse again.", "348", TiXmlHandle( &copy ).Path( TiXmlPath( "/*/movies/movie/id" ) ).ToElement()->GetText() );
+
+		TiXmlDocument none;
+		none.AddKeepPath( TiXmlPath( "/search" ) );
+		none.Parse( search );
+		XmlTest( "Everything skipped.", false, none.Error() );
+		XmlTest( "Everything skipped, no root.", true, none.RootElement() == 0 );
+		TiXmlDocument nothing;
+		nothing.AddKeepPath( TiXmlPath( "/movies/movie/crew" ) );
+		nothing.Parse( "<movies><movie><name>Alien</name></movie></movies>" );
+		XmlTest( "Nothing kept.", false, nothing.Error() );
+		XmlTest( "Nothing kept, no root.", true, nothing.RootElement() == 0 );
+
+		TiXmlDocument truncated;
+		truncated.AddKeepPath( TiXmlPath( "/movies/movie/name" ) );
+		truncated.Parse( "<movies>\n<movie><name>Alien</name><images><image>" );
+		XmlTest( "Truncated skip.", TiXmlBase::TIXML_ERROR_READING_END_TAG, truncated.ErrorId() );
+		XmlTest( "Truncated skip row.", 2, truncated.ErrorRow() );
+	}
+
 	/*  1417717 experiment
 	{
 		TiXmlDocument xml;